@@ -0,0 +1,198 @@
+/*
+ * AsyncStderrWriter.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#include "AsyncStderrWriter.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+#include "LogStats.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// How long a normal exit waits for buffered messages to reach stderr.
+static const int kExitDrainTimeoutMs = 1000;
+
+AsyncStderrWriter* AsyncStderrWriter::writer_ = NULL;
+
+static pthread_once_t async_stderr_once = PTHREAD_ONCE_INIT;
+
+// Whether DrainAtExit() is registered; a forked child inherits it.
+static bool drain_at_exit_registered = false;
+
+// At load time, so that no writer is started before the handler exists.
+int AsyncStderrWriter::fork_handler_registered_ =
+    AsyncStderrWriter::RegisterForkHandler();
+
+int AsyncStderrWriter::RegisterForkHandler() {
+  return pthread_atfork(NULL, NULL, &ForgetWriter) == 0;
+}
+
+void AsyncStderrWriter::ForgetWriter() {
+  // Leaked: its lock may have been held by a thread of the parent.
+  writer_ = NULL;
+  async_stderr_once = PTHREAD_ONCE_INIT;
+}
+
+AsyncStderrWriter* AsyncStderrWriter::Get() {
+  pthread_once(&async_stderr_once, &Start);
+  return writer_;
+}
+
+void AsyncStderrWriter::Start() {
+  AsyncStderrWriter* writer = new AsyncStderrWriter;
+  if (pthread_create(&writer->thread_, NULL, &ThreadMain, writer) != 0) {
+    delete[] writer->buffer_;
+    delete writer;
+    return;
+  }
+  pthread_detach(writer->thread_);
+  writer_ = writer;
+  if (!drain_at_exit_registered) {
+    atexit(&DrainAtExit);
+    drain_at_exit_registered = true;
+  }
+}
+
+void AsyncStderrWriter::DrainAtExit() {
+  if (writer_ != NULL) writer_->Drain(kExitDrainTimeoutMs);
+}
+
+AsyncStderrWriter::AsyncStderrWriter()
+  : buffer_(new char[kBufferSize]), head_(0), tail_(0), has_drops_(false) {
+  memset(dropped_, 0, sizeof(dropped_));
+}
+
+void AsyncStderrWriter::Write(LogSeverity severity, const char* message,
+                              size_t len) {
+  CondVarLock l(&cv_);
+  const uint64 used = tail_ - head_;
+  const uint64 limit = severity >= GLOG_ERROR ? kBufferSize
+                                              : kBufferSize / 4 * 3;
+  if (used + len > limit) {
+    LogStats::Add(LogStats::kDroppedStderr);
+    ++dropped_[severity];
+    has_drops_ = true;
+    return;
+  }
+  const size_t offset = tail_ % kBufferSize;
+  const size_t first = len < kBufferSize - offset ? len : kBufferSize - offset;
+  memcpy(buffer_ + offset, message, first);
+  memcpy(buffer_, message + first, len - first);
+  tail_ += len;
+  if (used == 0) cv_.SignalAll();
+}
+
+bool AsyncStderrWriter::Drain(int timeout_ms) {
+  CondVarLock l(&cv_);
+  struct timespec start, now;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  while (head_ != tail_) {
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const int elapsed_ms = (now.tv_sec - start.tv_sec) * 1000 +
+                           (now.tv_nsec - start.tv_nsec) / 1000000;
+    if (elapsed_ms >= timeout_ms) return false;
+    cv_.WaitWithTimeout(timeout_ms - elapsed_ms);
+  }
+  return true;
+}
+
+size_t AsyncStderrWriter::WriteQueuedUnsafe(int fd) {
+  const uint64 head = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+  const uint64 tail = __atomic_load_n(&tail_, __ATOMIC_RELAXED);
+  if (tail <= head || tail - head > kBufferSize) return 0;
+  const size_t offset = head % kBufferSize;
+  const size_t len = tail - head;
+  const size_t first = len < kBufferSize - offset ? len : kBufferSize - offset;
+  struct iovec iov[2];
+  iov[0].iov_base = buffer_ + offset;
+  iov[0].iov_len = first;
+  iov[1].iov_base = buffer_;
+  iov[1].iov_len = len - first;
+  if (writev(fd, iov, len > first ? 2 : 1) < 0) return 0;
+  return len;
+}
+
+void* AsyncStderrWriter::ThreadMain(void* arg) {
+  static_cast<AsyncStderrWriter*>(arg)->Loop();
+  return NULL;
+}
+
+// Write all of "iov" to stderr, however many calls it takes.  Errors
+// drop the rest, like fwrite() to a broken stderr would.
+static void WriteAll(struct iovec* iov, int iovcnt) {
+  while (iovcnt > 0) {
+    ssize_t n = writev(STDERR_FILENO, iov, iovcnt);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return;
+    }
+    while (iovcnt > 0 && static_cast<size_t>(n) >= iov->iov_len) {
+      n -= iov->iov_len;
+      ++iov;
+      --iovcnt;
+    }
+    if (iovcnt > 0) {
+      iov->iov_base = static_cast<char*>(iov->iov_base) + n;
+      iov->iov_len -= n;
+    }
+  }
+}
+
+void AsyncStderrWriter::Loop() {
+  cv_.Lock();
+  while (true) {
+    while (head_ == tail_ && !has_drops_) cv_.Wait();
+
+    // Producers only fill in bytes past tail_, so [head_, tail_) can be
+    // written out without holding the lock.
+    const uint64 head = head_;
+    const uint64 tail = tail_;
+    uint64 dropped[NUM_SEVERITIES];
+    const bool has_drops = has_drops_;
+    memcpy(dropped, dropped_, sizeof(dropped));
+    memset(dropped_, 0, sizeof(dropped_));
+    has_drops_ = false;
+    cv_.Unlock();
+
+    struct iovec iov[3];
+    int iovcnt = 0;
+    const size_t offset = head % kBufferSize;
+    const size_t len = tail - head;
+    const size_t first = len < kBufferSize - offset ? len : kBufferSize - offset;
+    if (first > 0) {
+      iov[iovcnt].iov_base = buffer_ + offset;
+      iov[iovcnt++].iov_len = first;
+    }
+    if (len > first) {
+      iov[iovcnt].iov_base = buffer_;
+      iov[iovcnt++].iov_len = len - first;
+    }
+    char notice[256];
+    if (has_drops) {
+      int n = snprintf(notice, sizeof(notice),
+                       "stderr was blocked: dropped %llu INFO, %llu WARNING, "
+                       "%llu ERROR, %llu FATAL log messages\n",
+                       static_cast<unsigned long long>(dropped[GLOG_INFO]),
+                       static_cast<unsigned long long>(dropped[GLOG_WARNING]),
+                       static_cast<unsigned long long>(dropped[GLOG_ERROR]),
+                       static_cast<unsigned long long>(dropped[GLOG_FATAL]));
+      iov[iovcnt].iov_base = notice;
+      iov[iovcnt++].iov_len = n;
+    }
+    WriteAll(iov, iovcnt);
+
+    cv_.Lock();
+    head_ = tail;
+    cv_.SignalAll();
+  }
+}
+
+_END_GOOGLE_NAMESPACE_
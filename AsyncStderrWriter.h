@@ -0,0 +1,93 @@
+/*
+ * AsyncStderrWriter.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#ifndef ASYNCSTDERRWRITER_H_
+#define ASYNCSTDERRWRITER_H_
+
+#include <pthread.h>
+#include <stddef.h>
+#include "logging.h"
+#include "mutex.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// Writes log messages to stderr from a dedicated thread
+// (--log_async_stderr).
+//
+// In containers stderr is usually a pipe to a log shipper.  When the
+// shipper stalls, a synchronous fwrite() blocks the logging thread with
+// log_mutex held, and with it every other thread that logs.  Here the
+// logging thread only copies the message into a bounded ring buffer; the
+// writer thread empties it with one writev() for everything buffered.
+//
+// When the buffer fills up, messages are dropped instead of waiting:
+// INFO and WARNING once it is 3/4 full, so that the last quarter is kept
+// for ERROR and FATAL, which are only dropped when it is completely
+// full.  Drops are counted and reported on stderr once it drains.
+//
+// fd 2 itself is left blocking: O_NONBLOCK would apply to the pipe as
+// shared with other processes.  Only the writer thread ever blocks on it.
+//
+// The child of a fork() doesn't have the writer thread: a
+// pthread_atfork() handler, registered when the library is loaded,
+// forgets the parent's writer (whose queue the parent writes out), so
+// that the child starts one of its own on its next message.  Until it
+// has one, messages go to stderr directly.
+class AsyncStderrWriter {
+public:
+  static const size_t kBufferSize = 1 << 20;
+
+  // The writer, started on first use.
+  static AsyncStderrWriter* Get();
+
+  // The writer if it has been started, else NULL.
+  static AsyncStderrWriter* GetIfStarted() { return writer_; }
+
+  // Queue "message[0,len-1]" or drop it.  Never blocks on stderr.
+  void Write(LogSeverity severity, const char* message, size_t len);
+
+  // Wait up to "timeout_ms" for everything queued to be written.
+  // Returns false on timeout.
+  bool Drain(int timeout_ms);
+
+  // Write what is queued straight to "fd", without locking, for the
+  // failure signal handler.  Whatever the writer thread is writing at
+  // that moment may come out twice.  Returns the number of bytes.
+  size_t WriteQueuedUnsafe(int fd);
+
+private:
+  AsyncStderrWriter();
+
+  static void Start();
+  static void DrainAtExit();
+
+  // pthread_atfork() child handler.
+  static void ForgetWriter();
+  static int RegisterForkHandler();
+
+  static void* ThreadMain(void* arg);
+  void Loop();
+
+  static AsyncStderrWriter* writer_;
+  static int fork_handler_registered_;
+
+  CondVar cv_;
+  char* buffer_;
+  uint64 head_;                   // under cv_: next byte to write out
+  uint64 tail_;                   // under cv_: next byte to fill in
+  uint64 dropped_[NUM_SEVERITIES];  // under cv_
+  bool has_drops_;                // under cv_
+  pthread_t thread_;
+
+  // Disallow
+  AsyncStderrWriter(const AsyncStderrWriter&);
+  void operator=(const AsyncStderrWriter&);
+};
+
+_END_GOOGLE_NAMESPACE_
+
+#endif /* ASYNCSTDERRWRITER_H_ */
@@ -0,0 +1,688 @@
+/*
+ * CfiUnwinder.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#include "CfiUnwinder.h"
+#include <stdint.h>
+#include <string.h>
+#include <ucontext.h>
+#include "LoadedModules.h"
+#include "StackBounds.h"
+#include "stacktrace.h"
+#include "utilities.h"
+
+_START_GOOGLE_NAMESPACE_
+
+#ifdef __x86_64__
+
+namespace {
+
+// DWARF register numbers.
+const int kRegRbp = 6;
+const int kRegRsp = 7;
+
+// Frames larger than this are taken for garbage.
+const uintptr_t kMaxFrameSize = 1 << 20;
+
+// How many DW_CFA_remember_state can be nested.
+const int kMaxRememberedStates = 8;
+
+// Entries of the cache of unwinding rules; a power of 2.
+const int kRulesCacheSize = 1024;
+
+// Pointer encodings (DW_EH_PE_*).
+enum {
+  kPeAbsptr = 0x00,
+  kPeUleb128 = 0x01,
+  kPeUdata2 = 0x02,
+  kPeUdata4 = 0x03,
+  kPeUdata8 = 0x04,
+  kPeSleb128 = 0x09,
+  kPeSdata2 = 0x0a,
+  kPeSdata4 = 0x0b,
+  kPeSdata8 = 0x0c,
+  kPePcrel = 0x10,
+  kPeDatarel = 0x30,
+  kPeIndirect = 0x80,
+  kPeOmit = 0xff,
+};
+
+// Call frame instructions (DW_CFA_*).
+enum {
+  kCfaAdvanceLoc = 0x40,
+  kCfaOffset = 0x80,
+  kCfaRestore = 0xc0,
+  kCfaNop = 0x00,
+  kCfaSetLoc = 0x01,
+  kCfaAdvanceLoc1 = 0x02,
+  kCfaAdvanceLoc2 = 0x03,
+  kCfaAdvanceLoc4 = 0x04,
+  kCfaOffsetExtended = 0x05,
+  kCfaRestoreExtended = 0x06,
+  kCfaUndefined = 0x07,
+  kCfaSameValue = 0x08,
+  kCfaRegister = 0x09,
+  kCfaRememberState = 0x0a,
+  kCfaRestoreState = 0x0b,
+  kCfaDefCfa = 0x0c,
+  kCfaDefCfaRegister = 0x0d,
+  kCfaDefCfaOffset = 0x0e,
+  kCfaDefCfaExpression = 0x0f,
+  kCfaExpression = 0x10,
+  kCfaOffsetExtendedSf = 0x11,
+  kCfaDefCfaSf = 0x12,
+  kCfaDefCfaOffsetSf = 0x13,
+  kCfaValOffset = 0x14,
+  kCfaValOffsetSf = 0x15,
+  kCfaValExpression = 0x16,
+  kCfaGnuArgsSize = 0x2e,
+  kCfaGnuNegativeOffsetExtended = 0x2f,
+};
+
+typedef LoadedModules::Module Module;
+typedef LoadedModules::Snapshot Snapshot;
+
+// Every read of a module's CFI is bounded to the segments it had: if it
+// was unloaded since, garbage there makes the lookup fail (and the frame
+// be unwound through %rbp) instead of sending the unwinder to arbitrary
+// addresses.
+bool InSegment(const Module& module, const void* p, size_t size) {
+  return LoadedModules::InSegment(module, p, size);
+}
+
+// A frame being unwound.
+struct Frame {
+  uintptr_t pc;
+  uintptr_t sp;
+  uintptr_t fp;
+  bool exact;   // pc was interrupted, rather than being a return address
+};
+
+// How to recover a register of the caller.
+struct Rule {
+  enum Kind { kSame, kUndefined, kAtCfa, kCfaPlus, kInRegister, kUnknown };
+  Kind kind;
+  int64 value;   // offset from the CFA, or register number
+};
+
+struct Rules {
+  int cfa_register;
+  int64 cfa_offset;
+  bool cfa_is_expression;
+  Rule fp;
+  Rule ra;
+};
+
+// Stack traces mostly go through the same call sites again, so the rules
+// found for a pc are cached.  Each entry is guarded by a sequence number
+// (odd while it is written): readers, which may be signal handlers, never
+// wait, and writers that would have to just don't cache.
+struct CachedRules {
+  uint64 sequence;
+  uint64 generation;   // of the snapshot the pc was found in
+  uintptr_t pc;
+  Rules rules;
+};
+
+CachedRules rules_cache[kRulesCacheSize];
+
+CachedRules* RulesCacheEntry(uintptr_t pc) {
+  return &rules_cache[(pc * 0x9e3779b97f4a7c15ULL) >> 54 &
+                      (kRulesCacheSize - 1)];
+}
+
+bool LookupCachedRules(const Snapshot* snapshot, uintptr_t pc, Rules* rules) {
+  CachedRules* entry = RulesCacheEntry(pc);
+  const uint64 sequence = __atomic_load_n(&entry->sequence, __ATOMIC_ACQUIRE);
+  if (sequence & 1) return false;
+  const bool hit =
+      entry->generation == snapshot->generation && entry->pc == pc;
+  if (hit) *rules = entry->rules;
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return hit &&
+         __atomic_load_n(&entry->sequence, __ATOMIC_RELAXED) == sequence;
+}
+
+void CacheRules(const Snapshot* snapshot, uintptr_t pc, const Rules& rules) {
+  CachedRules* entry = RulesCacheEntry(pc);
+  uint64 sequence = __atomic_load_n(&entry->sequence, __ATOMIC_RELAXED);
+  if ((sequence & 1) ||
+      !__atomic_compare_exchange_n(&entry->sequence, &sequence, sequence + 1,
+                                   false, __ATOMIC_ACQUIRE,
+                                   __ATOMIC_RELAXED)) {
+    return;
+  }
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  entry->generation = snapshot->generation;
+  entry->pc = pc;
+  entry->rules = rules;
+  __atomic_store_n(&entry->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+struct Cie {
+  uint64 code_align;
+  int64 data_align;
+  uint64 ra_register;
+  uint8_t fde_encoding;
+  const uint8_t* instructions;
+  const uint8_t* end;
+  bool has_augmentation_data;
+};
+
+uint64 ReadUleb128(const uint8_t** p, const uint8_t* end) {
+  uint64 value = 0;
+  int shift = 0;
+  while (*p < end) {
+    const uint8_t byte = *(*p)++;
+    if (shift < 64) value |= static_cast<uint64>(byte & 0x7f) << shift;
+    shift += 7;
+    if ((byte & 0x80) == 0) break;
+  }
+  return value;
+}
+
+int64 ReadSleb128(const uint8_t** p, const uint8_t* end) {
+  int64 value = 0;
+  int shift = 0;
+  uint8_t byte = 0;
+  while (*p < end) {
+    byte = *(*p)++;
+    if (shift < 64) value |= static_cast<int64>(byte & 0x7f) << shift;
+    shift += 7;
+    if ((byte & 0x80) == 0) break;
+  }
+  if (shift < 64 && (byte & 0x40)) value |= -(static_cast<int64>(1) << shift);
+  return value;
+}
+
+template <typename T>
+T ReadFixed(const uint8_t** p) {
+  T value;
+  memcpy(&value, *p, sizeof(value));
+  *p += sizeof(value);
+  return value;
+}
+
+// Read a pointer encoded as "encoding".  Only the encodings that
+// compilers emit in .eh_frame on x86-64 are supported.
+bool ReadEncoded(const uint8_t** p, const uint8_t* end, uint8_t encoding,
+                 uintptr_t data_base, uintptr_t* value) {
+  if (encoding == kPeOmit) return false;
+  const uint8_t* start = *p;
+  static const int kSizes[16] = { 8, 0, 2, 4, 8, 0, 0, 0,
+                                  0, 0, 2, 4, 8, 0, 0, 0 };
+  const int size = kSizes[encoding & 0x0f];
+  if (size > 0 && *p + size > end) return false;
+  uintptr_t v;
+  switch (encoding & 0x0f) {
+    case kPeAbsptr: v = ReadFixed<uint64_t>(p); break;
+    case kPeUleb128: v = ReadUleb128(p, end); break;
+    case kPeUdata2: v = ReadFixed<uint16_t>(p); break;
+    case kPeUdata4: v = ReadFixed<uint32_t>(p); break;
+    case kPeUdata8: v = ReadFixed<uint64_t>(p); break;
+    case kPeSleb128: v = ReadSleb128(p, end); break;
+    case kPeSdata2: v = ReadFixed<int16_t>(p); break;
+    case kPeSdata4: v = ReadFixed<int32_t>(p); break;
+    case kPeSdata8: v = ReadFixed<int64_t>(p); break;
+    default: return false;
+  }
+  switch (encoding & 0x70) {
+    case 0: break;
+    case kPePcrel: v += reinterpret_cast<uintptr_t>(start); break;
+    case kPeDatarel: v += data_base; break;
+    default: return false;
+  }
+  if ((encoding & kPeIndirect) && v != 0) {
+    v = *reinterpret_cast<const uintptr_t*>(v);
+  }
+  *value = v;
+  return true;
+}
+
+// The length of the CIE or FDE at *p, which is moved past it; 0 for the
+// terminator, the (unsupported) 64-bit format, or an entry that isn't
+// within one segment of "module".
+uint32_t ReadEntryLength(const Module& module, const uint8_t** p) {
+  if (!InSegment(module, *p, sizeof(uint32_t))) return 0;
+  const uint32_t length = ReadFixed<uint32_t>(p);
+  if (length == 0xffffffff || !InSegment(module, *p, length)) return 0;
+  return length;
+}
+
+bool ParseCie(const Module& module, const uint8_t* p, Cie* cie) {
+  const uint32_t length = ReadEntryLength(module, &p);
+  if (length < sizeof(uint32_t) + 2) return false;
+  const uint8_t* end = p + length;
+  if (ReadFixed<uint32_t>(&p) != 0) return false;   // not a CIE
+  const uint8_t version = *p++;
+  if (version != 1 && version != 3) return false;
+  const char* augmentation = reinterpret_cast<const char*>(p);
+  const void* nul = memchr(p, '\0', end - p);
+  if (nul == NULL) return false;
+  p = static_cast<const uint8_t*>(nul) + 1;
+  if (augmentation[0] != '\0' && augmentation[0] != 'z') return false;
+  cie->code_align = ReadUleb128(&p, end);
+  cie->data_align = ReadSleb128(&p, end);
+  if (version == 1 && p >= end) return false;
+  cie->ra_register = version == 1 ? *p++ : ReadUleb128(&p, end);
+  cie->fde_encoding = kPeAbsptr;
+  cie->has_augmentation_data = augmentation[0] == 'z';
+  if (cie->has_augmentation_data) {
+    const uint64 data_length = ReadUleb128(&p, end);
+    if (data_length > static_cast<uint64>(end - p)) return false;
+    const uint8_t* data_end = p + data_length;
+    for (const char* a = augmentation + 1; *a != '\0' && p < data_end; ++a) {
+      if (*a == 'R') {
+        cie->fde_encoding = *p++;
+      } else if (*a == 'P') {
+        // The personality routine: skip it, without following it.
+        const uint8_t encoding = *p++ & ~kPeIndirect;
+        uintptr_t ignored;
+        if (!ReadEncoded(&p, data_end, encoding, 0, &ignored)) return false;
+      } else if (*a == 'L') {
+        ++p;
+      } else if (*a != 'S') {
+        break;   // Unknown, but the length tells where the data ends.
+      }
+    }
+    p = data_end;
+  }
+  if (p > end) return false;
+  cie->instructions = p;
+  cie->end = end;
+  return true;
+}
+
+Rule* RuleOf(Rules* rules, uint64 reg, const Cie& cie) {
+  if (reg == kRegRbp) return &rules->fp;
+  if (reg == cie.ra_register) return &rules->ra;
+  return NULL;
+}
+
+void RestoreRule(Rules* rules, const Rules& initial, uint64 reg,
+                 const Cie& cie) {
+  if (reg == kRegRbp) rules->fp = initial.fp;
+  if (reg == cie.ra_register) rules->ra = initial.ra;
+}
+
+void SetRule(Rule* rule, Rule::Kind kind, int64 value) {
+  if (rule != NULL) {
+    rule->kind = kind;
+    rule->value = value;
+  }
+}
+
+// Run the CFA program [p, end) until it passes "target"; "loc" is the
+// address the program starts at.  "initial" holds the rules after the
+// CIE's program, for DW_CFA_restore.
+bool Execute(const uint8_t* p, const uint8_t* end, const Cie& cie,
+             uintptr_t loc, uintptr_t target, const Rules& initial,
+             Rules* rules) {
+  Rules remembered[kMaxRememberedStates];
+  int num_remembered = 0;
+  while (p < end) {
+    const uint8_t op = *p++;
+    uint64 reg;
+    uintptr_t delta = 0;
+    switch (op & 0xc0) {
+      case kCfaAdvanceLoc:
+        delta = (op & 0x3f) * cie.code_align;
+        break;
+      case kCfaOffset:
+        SetRule(RuleOf(rules, op & 0x3f, cie), Rule::kAtCfa,
+                ReadUleb128(&p, end) * cie.data_align);
+        continue;
+      case kCfaRestore:
+        RestoreRule(rules, initial, op & 0x3f, cie);
+        continue;
+      default:
+        switch (op) {
+          case kCfaNop:
+            continue;
+          case kCfaGnuArgsSize:
+            ReadUleb128(&p, end);
+            continue;
+          case kCfaSetLoc: {
+            uintptr_t new_loc;
+            if (!ReadEncoded(&p, end, cie.fde_encoding, 0, &new_loc)) {
+              return false;
+            }
+            if (new_loc > target) return true;
+            loc = new_loc;
+            continue;
+          }
+          case kCfaAdvanceLoc1:
+            if (p + 1 > end) return false;
+            delta = ReadFixed<uint8_t>(&p) * cie.code_align;
+            break;
+          case kCfaAdvanceLoc2:
+            if (p + 2 > end) return false;
+            delta = ReadFixed<uint16_t>(&p) * cie.code_align;
+            break;
+          case kCfaAdvanceLoc4:
+            if (p + 4 > end) return false;
+            delta = ReadFixed<uint32_t>(&p) * cie.code_align;
+            break;
+          case kCfaOffsetExtended:
+            reg = ReadUleb128(&p, end);
+            SetRule(RuleOf(rules, reg, cie), Rule::kAtCfa,
+                    ReadUleb128(&p, end) * cie.data_align);
+            continue;
+          case kCfaOffsetExtendedSf:
+            reg = ReadUleb128(&p, end);
+            SetRule(RuleOf(rules, reg, cie), Rule::kAtCfa,
+                    ReadSleb128(&p, end) * cie.data_align);
+            continue;
+          case kCfaGnuNegativeOffsetExtended:
+            reg = ReadUleb128(&p, end);
+            SetRule(RuleOf(rules, reg, cie), Rule::kAtCfa,
+                    -static_cast<int64>(ReadUleb128(&p, end)) *
+                    cie.data_align);
+            continue;
+          case kCfaValOffset:
+            reg = ReadUleb128(&p, end);
+            SetRule(RuleOf(rules, reg, cie), Rule::kCfaPlus,
+                    ReadUleb128(&p, end) * cie.data_align);
+            continue;
+          case kCfaValOffsetSf:
+            reg = ReadUleb128(&p, end);
+            SetRule(RuleOf(rules, reg, cie), Rule::kCfaPlus,
+                    ReadSleb128(&p, end) * cie.data_align);
+            continue;
+          case kCfaRestoreExtended:
+            RestoreRule(rules, initial, ReadUleb128(&p, end), cie);
+            continue;
+          case kCfaUndefined:
+            SetRule(RuleOf(rules, ReadUleb128(&p, end), cie),
+                    Rule::kUndefined, 0);
+            continue;
+          case kCfaSameValue:
+            SetRule(RuleOf(rules, ReadUleb128(&p, end), cie), Rule::kSame, 0);
+            continue;
+          case kCfaRegister:
+            reg = ReadUleb128(&p, end);
+            SetRule(RuleOf(rules, reg, cie), Rule::kInRegister,
+                    ReadUleb128(&p, end));
+            continue;
+          case kCfaRememberState:
+            if (num_remembered == kMaxRememberedStates) return false;
+            remembered[num_remembered++] = *rules;
+            continue;
+          case kCfaRestoreState:
+            if (num_remembered == 0) return false;
+            *rules = remembered[--num_remembered];
+            continue;
+          case kCfaDefCfa:
+            rules->cfa_register = ReadUleb128(&p, end);
+            rules->cfa_offset = ReadUleb128(&p, end);
+            rules->cfa_is_expression = false;
+            continue;
+          case kCfaDefCfaSf:
+            rules->cfa_register = ReadUleb128(&p, end);
+            rules->cfa_offset = ReadSleb128(&p, end) * cie.data_align;
+            rules->cfa_is_expression = false;
+            continue;
+          case kCfaDefCfaRegister:
+            rules->cfa_register = ReadUleb128(&p, end);
+            rules->cfa_is_expression = false;
+            continue;
+          case kCfaDefCfaOffset:
+            rules->cfa_offset = ReadUleb128(&p, end);
+            continue;
+          case kCfaDefCfaOffsetSf:
+            rules->cfa_offset = ReadSleb128(&p, end) * cie.data_align;
+            continue;
+          case kCfaDefCfaExpression:
+            rules->cfa_is_expression = true;
+            p += ReadUleb128(&p, end);
+            continue;
+          case kCfaExpression:
+          case kCfaValExpression:
+            reg = ReadUleb128(&p, end);
+            SetRule(RuleOf(rules, reg, cie), Rule::kUnknown, 0);
+            p += ReadUleb128(&p, end);
+            continue;
+          default:
+            return false;
+        }
+    }
+    if (loc + delta > target) return true;
+    loc += delta;
+  }
+  return true;
+}
+
+// The (pc, FDE) pairs of the .eh_frame_hdr binary search table of
+// "module", relative to eh_frame_hdr.  False if it has none.
+bool FindFdeTable(const Module& module, const int32_t** table,
+                  size_t* count) {
+  // version, eh_frame_ptr encoding, fde_count encoding, table encoding
+  const uint8_t* hdr = module.eh_frame_hdr;
+  const uint8_t kTableEncoding = kPeDatarel | kPeSdata4;
+  const size_t kHdrSize = 4 + 16;
+  if (hdr == NULL || !InSegment(module, hdr, kHdrSize) || hdr[0] != 1 ||
+      hdr[3] != kTableEncoding) {
+    return false;
+  }
+  const uint8_t* p = hdr + 4;
+  const uint8_t* end = p + 16;
+  uintptr_t eh_frame, n;
+  const uintptr_t base = reinterpret_cast<uintptr_t>(hdr);
+  if (!ReadEncoded(&p, end, hdr[1], base, &eh_frame) ||
+      !ReadEncoded(&p, end, hdr[2], base, &n) ||
+      n > (module.end - module.start) / (2 * sizeof(int32_t)) ||
+      !InSegment(module, p, n * 2 * sizeof(int32_t))) {
+    return false;
+  }
+  *table = reinterpret_cast<const int32_t*>(p);
+  *count = n;
+  return true;
+}
+
+// Find the rules that unwind "pc" in "module".  False if they can't be
+// found, or the CFI doesn't add up.
+bool FindRules(const Module& module, uintptr_t pc, Rules* rules) {
+  const int32_t* table;
+  size_t count;
+  if (!FindFdeTable(module, &table, &count)) return false;
+  const intptr_t relative =
+      pc - reinterpret_cast<uintptr_t>(module.eh_frame_hdr);
+  if (relative != static_cast<int32_t>(relative)) return false;
+  // The last entry that starts at or before pc.
+  size_t low = 0, high = count;
+  while (low < high) {
+    const size_t mid = low + (high - low) / 2;
+    if (table[2 * mid] <= relative) low = mid + 1;
+    else high = mid;
+  }
+  if (low == 0) return false;
+  const uint8_t* fde = module.eh_frame_hdr + table[2 * (low - 1) + 1];
+
+  const uint8_t* p = fde;
+  const uint32_t length = ReadEntryLength(module, &p);
+  if (length < sizeof(uint32_t)) return false;
+  const uint8_t* end = p + length;
+  const uint8_t* cie_pointer = p;
+  const uint32_t cie_offset = ReadFixed<uint32_t>(&p);
+  if (cie_offset == 0) return false;   // a CIE, not an FDE
+  Cie cie;
+  if (!ParseCie(module, cie_pointer - cie_offset, &cie)) return false;
+  // Not followed: the pointer itself could be anywhere.
+  if (cie.fde_encoding & kPeIndirect) return false;
+  uintptr_t pc_begin, pc_range;
+  if (!ReadEncoded(&p, end, cie.fde_encoding, 0, &pc_begin) ||
+      !ReadEncoded(&p, end, cie.fde_encoding & 0x0f, 0, &pc_range)) {
+    return false;
+  }
+  if (pc < pc_begin || pc >= pc_begin + pc_range) return false;
+  if (cie.has_augmentation_data) p += ReadUleb128(&p, end);
+  if (p > end) return false;
+
+  rules->cfa_register = kRegRsp;
+  rules->cfa_offset = 0;
+  rules->cfa_is_expression = false;
+  rules->fp.kind = Rule::kSame;
+  rules->ra.kind = Rule::kUnknown;
+  if (!Execute(cie.instructions, cie.end, cie, pc_begin, ~0UL, *rules,
+               rules)) {
+    return false;
+  }
+  const Rules initial = *rules;
+  return Execute(p, end, cie, pc_begin, pc, initial, rules);
+}
+
+// Recover the value of a register of the caller.
+bool ApplyRule(const Rule& rule, uintptr_t cfa, const Frame& frame,
+               uintptr_t current, uintptr_t* value) {
+  switch (rule.kind) {
+    case Rule::kSame: *value = current; return true;
+    case Rule::kUndefined: *value = 0; return true;
+    case Rule::kAtCfa:
+      if (StackBounds::known() &&
+          !StackBounds::Contains(cfa + rule.value, sizeof(uintptr_t))) {
+        return false;
+      }
+      *value = *reinterpret_cast<const uintptr_t*>(cfa + rule.value);
+      return true;
+    case Rule::kCfaPlus: *value = cfa + rule.value; return true;
+    case Rule::kInRegister:
+      if (rule.value == kRegRsp) *value = frame.sp;
+      else if (rule.value == kRegRbp) *value = frame.fp;
+      else return false;
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool StepWithRules(const Rules& rules, Frame* frame) {
+  if (rules.cfa_is_expression) return false;
+  uintptr_t cfa;
+  if (rules.cfa_register == kRegRsp) cfa = frame->sp;
+  else if (rules.cfa_register == kRegRbp) cfa = frame->fp;
+  else return false;
+  cfa += rules.cfa_offset;
+  if (cfa <= frame->sp || cfa - frame->sp > kMaxFrameSize ||
+      (cfa & (sizeof(void*) - 1)) != 0) {
+    return false;
+  }
+  uintptr_t pc, fp;
+  if (!ApplyRule(rules.ra, cfa, *frame, 0, &pc) ||
+      !ApplyRule(rules.fp, cfa, *frame, frame->fp, &fp)) {
+    return false;
+  }
+  frame->pc = pc;
+  frame->sp = cfa;
+  frame->fp = fp;
+  frame->exact = false;
+  return true;
+}
+
+// For code without CFI: assume it keeps the frame pointer chain.
+bool StepWithFramePointer(Frame* frame) {
+  const uintptr_t fp = frame->fp;
+  if (fp <= frame->sp || fp - frame->sp > kMaxFrameSize ||
+      (fp & (sizeof(void*) - 1)) != 0 ||
+      (StackBounds::known() &&
+       !StackBounds::Contains(fp, 2 * sizeof(void*)))) {
+    return false;
+  }
+  const uintptr_t* saved = reinterpret_cast<const uintptr_t*>(fp);
+  frame->pc = saved[1];
+  frame->sp = fp + 2 * sizeof(void*);
+  frame->fp = saved[0];
+  frame->exact = false;
+  return true;
+}
+
+// Whether "pc" is the signal return trampoline (__restore_rt) of glibc
+// and musl: mov $__NR_rt_sigreturn, %rax; syscall.
+bool IsSigreturn(const Module* module, uintptr_t pc) {
+  static const uint8_t kSigreturn[] = {
+    0x48, 0xc7, 0xc0, 0x0f, 0x00, 0x00, 0x00, 0x0f, 0x05
+  };
+  const void* code = reinterpret_cast<const void*>(pc);
+  return module != NULL && InSegment(*module, code, sizeof(kSigreturn)) &&
+         memcmp(code, kSigreturn, sizeof(kSigreturn)) == 0;
+}
+
+// The handler returned to the trampoline with the ucontext_t at %rsp.
+bool StepThroughSignalFrame(Frame* frame) {
+  if (StackBounds::known() &&
+      !StackBounds::Contains(frame->sp, sizeof(ucontext_t))) {
+    return false;
+  }
+  const ucontext_t* context = reinterpret_cast<const ucontext_t*>(frame->sp);
+  frame->pc = context->uc_mcontext.gregs[REG_RIP];
+  frame->sp = context->uc_mcontext.gregs[REG_RSP];
+  frame->fp = context->uc_mcontext.gregs[REG_RBP];
+  frame->exact = true;
+  return frame->sp != 0;
+}
+
+bool Step(const Snapshot* snapshot, Frame* frame) {
+  if (!frame->exact &&
+      IsSigreturn(LoadedModules::Find(snapshot, frame->pc), frame->pc)) {
+    return StepThroughSignalFrame(frame);
+  }
+  // The call of a return address is the byte before it.
+  const uintptr_t pc = frame->exact ? frame->pc : frame->pc - 1;
+  Rules rules;
+  if (LookupCachedRules(snapshot, pc, &rules)) {
+    return StepWithRules(rules, frame);
+  }
+  const Module* module = LoadedModules::Find(snapshot, pc);
+  if (module != NULL && FindRules(*module, pc, &rules)) {
+    CacheRules(snapshot, pc, rules);
+    return StepWithRules(rules, frame);
+  }
+  return StepWithFramePointer(frame);
+}
+
+}  // namespace
+
+int CfiUnwinder::GetStackTrace(void** result, int max_depth, int skip_count) {
+  LoadedModules::Reader reader;
+  const Snapshot* snapshot = reader.snapshot();
+  if (snapshot == NULL) {
+    // Not refreshed yet.  Skip this frame too; the asm keeps it from
+    // being a tail call, which would take this frame away.
+    const int depth = GetStackTraceFromFramePointers(result, max_depth,
+                                                     skip_count + 1);
+    __asm__ volatile("" : : "r"(depth));
+    return depth;
+  }
+  StackBounds::CheckCurrentStack();
+  Frame frame;
+  __asm__ volatile("lea 0(%%rip), %0\n\t"
+                   "mov %%rsp, %1\n\t"
+                   "mov %%rbp, %2"
+                   : "=r"(frame.pc), "=r"(frame.sp), "=r"(frame.fp));
+  frame.exact = true;
+  int n = 0;
+  // The first step leaves this function, which is not reported.
+  while (n < max_depth && Step(snapshot, &frame) && frame.pc != 0) {
+    if (skip_count > 0) {
+      --skip_count;
+    } else {
+      result[n++] = reinterpret_cast<void*>(frame.pc);
+    }
+  }
+  return n;
+}
+
+#else  // !__x86_64__
+
+int CfiUnwinder::GetStackTrace(void** result, int max_depth, int skip_count) {
+  const int depth = GetStackTraceFromFramePointers(result, max_depth,
+                                                   skip_count + 1);
+  __asm__ volatile("" : : "r"(depth));
+  return depth;
+}
+
+#endif  // __x86_64__
+
+_END_GOOGLE_NAMESPACE_
@@ -0,0 +1,37 @@
+/*
+ * CfiUnwinder.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#ifndef CFIUNWINDER_H_
+#define CFIUNWINDER_H_
+
+#include "config.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// An x86-64 stack unwinder driven by the call frame information (CFI) of
+// .eh_frame, which is GetStackTrace() on x86-64.  Unlike following %rbp,
+// it works for code built with -fomit-frame-pointer.
+//
+// Each loaded module's .eh_frame_hdr already has a table of its FDEs
+// sorted by address.  Unwinding a frame is a binary search for the
+// module in the LoadedModules snapshot, one for the FDE, and running its
+// CFA program up to the pc; the result is cached by pc, so a call site
+// seen before costs a hash lookup.
+//
+// GetStackTrace() doesn't allocate, lock or make system calls, so it can
+// be used from signal handlers.  It steps through signal frames.  Frames
+// without CFI (e.g. generated code) are unwound through %rbp, and before
+// the first LoadedModules::Refresh() all of them are.
+class CfiUnwinder {
+public:
+  // Like GetStackTrace().  The frame of this function is not counted.
+  static int GetStackTrace(void** result, int max_depth, int skip_count);
+};
+
+_END_GOOGLE_NAMESPACE_
+
+#endif /* CFIUNWINDER_H_ */
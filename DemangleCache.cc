@@ -0,0 +1,115 @@
+/*
+ * DemangleCache.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#include "DemangleCache.h"
+#include <string.h>
+#include "basic_type.h"
+#include "demangle.h"
+
+_START_GOOGLE_NAMESPACE_
+
+namespace {
+
+enum {
+  kEmpty,
+  kFilling,
+  kDemangled,
+  kFailed,     // not a C++ name
+  kUncached,   // a C++ name Demangle() failed on: try it every time
+};
+
+struct Entry {
+  int state;         // kEmpty, then kFilling, then one of the others
+  uint64 hash;
+  char mangled[DemangleCache::kMaxLength];
+  char demangled[DemangleCache::kMaxLength];
+};
+
+// Twice kMaxNames slots keeps the probe sequences short; past
+// kMaxProbes, a name is not cached.
+const uint32 kNumSlots = 2 * DemangleCache::kMaxNames;
+const uint32 kMaxProbes = 16;
+
+Entry entries[kNumSlots];
+int num_names = 0;
+
+// Hashes "name" and sets "*length" to its length.  Not strlen(): it isn't
+// guaranteed to be async-signal-safe.
+uint64 HashName(const char* name, int* length) {
+  uint64 hash = 0xcbf29ce484222325ULL;   // FNV-1a
+  const char* p = name;
+  for (; *p != '\0'; ++p) {
+    hash = (hash ^ static_cast<unsigned char>(*p)) * 0x100000001b3ULL;
+  }
+  *length = p - name;
+  return hash;
+}
+
+// What Demangle() would return for "mangled", the name of "entry".
+bool Lookup(const Entry& entry, const char* mangled, char* out,
+            int out_size) {
+  if (entry.state == kFailed) return false;
+  if (entry.state == kUncached) {
+    return GOOGLE_NAMESPACE::Demangle(mangled, out, out_size);
+  }
+  int length = 0;
+  while (entry.demangled[length] != '\0') ++length;
+  // Demangle() would have overflowed "out".
+  if (length >= out_size) return false;
+  memcpy(out, entry.demangled, length + 1);
+  return true;
+}
+
+}  // namespace
+
+bool DemangleCache::Demangle(const char* mangled, char* out, int out_size) {
+  int length;
+  const uint64 hash = HashName(mangled, &length);
+  if (length >= kMaxLength) {
+    return GOOGLE_NAMESPACE::Demangle(mangled, out, out_size);
+  }
+  Entry* free_entry = NULL;
+  for (uint32 probe = 0; probe < kMaxProbes; ++probe) {
+    Entry* entry = &entries[(hash + probe) % kNumSlots];
+    const int state = __atomic_load_n(&entry->state, __ATOMIC_ACQUIRE);
+    if (state == kEmpty) {
+      free_entry = entry;
+      break;
+    }
+    // Being filled in (maybe by the code this signal interrupted): skip.
+    if (state == kFilling) continue;
+    if (entry->hash == hash &&
+        memcmp(entry->mangled, mangled, length + 1) == 0) {
+      return Lookup(*entry, mangled, out, out_size);
+    }
+  }
+
+  int state = kEmpty;
+  if (free_entry == NULL ||
+      __atomic_load_n(&num_names, __ATOMIC_RELAXED) >= kMaxNames ||
+      !__atomic_compare_exchange_n(&free_entry->state, &state, kFilling,
+                                   false, __ATOMIC_ACQUIRE,
+                                   __ATOMIC_RELAXED)) {
+    // Full, or another thread took the entry: don't cache this one.
+    return GOOGLE_NAMESPACE::Demangle(mangled, out, out_size);
+  }
+  __atomic_add_fetch(&num_names, 1, __ATOMIC_RELAXED);
+  free_entry->hash = hash;
+  memcpy(free_entry->mangled, mangled, length + 1);
+  int result = kFailed;
+  if (GOOGLE_NAMESPACE::Demangle(mangled, free_entry->demangled,
+                                 sizeof(free_entry->demangled))) {
+    result = kDemangled;
+  } else if (mangled[0] == '_' && mangled[1] == 'Z') {
+    // Maybe only too long for the entry: Demangle() doesn't say.
+    result = kUncached;
+  }
+  __atomic_store_n(&free_entry->state, result, __ATOMIC_RELEASE);
+  return Lookup(*free_entry, mangled, out, out_size);
+}
+
+_END_GOOGLE_NAMESPACE_
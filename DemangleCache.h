@@ -0,0 +1,35 @@
+/*
+ * DemangleCache.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#ifndef DEMANGLECACHE_H_
+#define DEMANGLECACHE_H_
+
+#include "config.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// Remembers what Demangle() made of the names it was given, so that the
+// frames of repeated stack traces are not demangled again: deep template
+// names take the recursive descent parser of demangle.cc a long while.
+//
+// The table is a fixed array of kMaxNames entries, filled in with
+// compare-and-swap and never emptied; names longer than kMaxLength, or
+// demangling to longer than that, are demangled every time.  It doesn't
+// allocate or lock, so it can be used where Demangle() can: in signal
+// handlers, and while crashing.
+class DemangleCache {
+public:
+  static const int kMaxNames = 2048;
+  static const int kMaxLength = 256;   // with the '\0'
+
+  // Like Demangle().  Failures are remembered too.
+  static bool Demangle(const char* mangled, char* out, int out_size);
+};
+
+_END_GOOGLE_NAMESPACE_
+
+#endif /* DEMANGLECACHE_H_ */
@@ -0,0 +1,217 @@
+/*
+ * DirectFileWriter.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#include "DirectFileWriter.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+_START_GOOGLE_NAMESPACE_
+
+const size_t DirectFileWriter::kBlockSize;
+const size_t DirectFileWriter::kBufferSize;
+
+static inline off_t RoundDownToBlock(off_t n) {
+  return n & ~static_cast<off_t>(DirectFileWriter::kBlockSize - 1);
+}
+
+static inline size_t RoundUpToBlock(size_t n) {
+  return (n + DirectFileWriter::kBlockSize - 1) &
+         ~(DirectFileWriter::kBlockSize - 1);
+}
+
+DirectFileWriter::DirectFileWriter()
+  : fd_(-1),
+    pid_(0),
+    error_(0),
+    logical_length_(0),
+    active_(0),
+    in_flight_(NULL),
+    stop_(false),
+    thread_started_(false) {
+  for (int i = 0; i < 2; ++i) {
+    void* p = NULL;
+    if (posix_memalign(&p, kBlockSize, kBufferSize) != 0) abort();
+    buffers_[i].data = static_cast<char*>(p);
+    buffers_[i].used = 0;
+    buffers_[i].file_offset = 0;
+  }
+}
+
+DirectFileWriter::~DirectFileWriter() {
+  Close();
+  free(buffers_[0].data);
+  free(buffers_[1].data);
+}
+
+bool DirectFileWriter::Attach(int fd) {
+  int flags = fcntl(fd, F_GETFL);
+  if (flags == -1 || fcntl(fd, F_SETFL, flags | O_DIRECT) == -1) {
+    return false;
+  }
+  fd_ = fd;
+  pid_ = getpid();
+  error_ = 0;
+  logical_length_ = lseek(fd, 0, SEEK_END);
+  if (logical_length_ < 0) logical_length_ = 0;
+  // Start on the block that contains the current end of file.  A fresh
+  // log file is empty, so in practice there is nothing to read back.
+  active_ = 0;
+  buffers_[0].file_offset = RoundDownToBlock(logical_length_);
+  buffers_[0].used = logical_length_ - buffers_[0].file_offset;
+  if (buffers_[0].used > 0 &&
+      pread(fd_, buffers_[0].data, kBlockSize, buffers_[0].file_offset) < 0) {
+    error_ = errno;
+  }
+
+  stop_ = false;
+  thread_started_ =
+      pthread_create(&thread_, NULL, &DirectFileWriter::WriterThreadMain,
+                     this) == 0;
+  return true;
+}
+
+void* DirectFileWriter::WriterThreadMain(void* arg) {
+  static_cast<DirectFileWriter*>(arg)->WriterLoop();
+  return NULL;
+}
+
+void DirectFileWriter::WriterLoop() {
+  cv_.Lock();
+  while (true) {
+    while (in_flight_ == NULL && !stop_) cv_.Wait();
+    if (in_flight_ == NULL) break;  // stop_ and nothing left to write
+    Buffer* buffer = in_flight_;
+    cv_.Unlock();
+    // Full buffers are always a whole number of blocks.
+    WriteBuffer(buffer, buffer->used);
+    cv_.Lock();
+    in_flight_ = NULL;
+    cv_.SignalAll();
+  }
+  cv_.Unlock();
+}
+
+void DirectFileWriter::WriteBuffer(const Buffer* buffer, size_t len) {
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = pwrite(fd_, buffer->data + done, len - done,
+                       buffer->file_offset + done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      if (error_ == 0) error_ = (n < 0) ? errno : EIO;
+      return;
+    }
+    done += n;
+  }
+}
+
+void DirectFileWriter::WaitForInFlightLocked() {
+  while (in_flight_ != NULL) cv_.Wait();
+}
+
+void DirectFileWriter::SubmitActive() {
+  Buffer* full = &buffers_[active_];
+  Buffer* next = &buffers_[1 - active_];
+  {
+    CondVarLock l(&cv_);
+    WaitForInFlightLocked();
+    if (thread_started_) {
+      in_flight_ = full;
+      cv_.SignalAll();
+    }
+  }
+  if (!thread_started_) WriteBuffer(full, full->used);
+  next->file_offset = full->file_offset + full->used;
+  next->used = 0;
+  active_ = 1 - active_;
+}
+
+void DirectFileWriter::Append(const char* data, size_t len) {
+  if (fd_ < 0) return;
+  logical_length_ += len;
+  while (len > 0) {
+    Buffer* buffer = &buffers_[active_];
+    size_t n = kBufferSize - buffer->used;
+    if (n > len) n = len;
+    memcpy(buffer->data + buffer->used, data, n);
+    buffer->used += n;
+    data += n;
+    len -= n;
+    if (buffer->used == kBufferSize) SubmitActive();
+  }
+}
+
+void DirectFileWriter::FlushUnsafe() {
+  if (fd_ < 0 || !OwnedByThisProcess()) return;
+  Buffer* buffer = &buffers_[active_];
+  if (buffer->used == 0) return;
+  const size_t padded = RoundUpToBlock(buffer->used);
+  memset(buffer->data + buffer->used, 0, padded - buffer->used);
+  WriteBuffer(buffer, padded);
+  if (padded != buffer->used && ftruncate(fd_, logical_length_) != 0) {
+    // Nothing more to do while crashing.
+  }
+}
+
+void DirectFileWriter::Flush() {
+  if (fd_ < 0 || !OwnedByThisProcess()) return;
+  {
+    CondVarLock l(&cv_);
+    WaitForInFlightLocked();
+  }
+  Buffer* buffer = &buffers_[active_];
+  if (buffer->used == 0) return;
+
+  // Pad the partial tail block; O_DIRECT can only write whole blocks.
+  const size_t padded = RoundUpToBlock(buffer->used);
+  memset(buffer->data + buffer->used, 0, padded - buffer->used);
+  WriteBuffer(buffer, padded);
+  if (padded != buffer->used) {
+    // Drop the padding again.  The next write starts over at the
+    // beginning of the tail block.
+    if (ftruncate(fd_, logical_length_) != 0 && error_ == 0) error_ = errno;
+  }
+
+  // Keep only the partial tail block, moved to the front of the buffer.
+  const size_t full_blocks = buffer->used & ~(kBlockSize - 1);
+  if (full_blocks > 0) {
+    memmove(buffer->data, buffer->data + full_blocks,
+            buffer->used - full_blocks);
+    buffer->used -= full_blocks;
+    buffer->file_offset += full_blocks;
+  }
+}
+
+void DirectFileWriter::Close() {
+  if (fd_ < 0) return;
+  if (!OwnedByThisProcess()) {
+    // Inherited: the writer thread and whatever is buffered belong to
+    // the parent, and cv_ may have been held by that thread at fork().
+    thread_started_ = false;
+    in_flight_ = NULL;
+  }
+  Flush();
+  if (thread_started_) {
+    {
+      CondVarLock l(&cv_);
+      stop_ = true;
+      cv_.SignalAll();
+    }
+    pthread_join(thread_, NULL);
+    thread_started_ = false;
+  }
+  close(fd_);
+  fd_ = -1;
+  pid_ = 0;
+  buffers_[0].used = buffers_[1].used = 0;
+  logical_length_ = 0;
+}
+
+_END_GOOGLE_NAMESPACE_
@@ -0,0 +1,118 @@
+/*
+ * DirectFileWriter.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#ifndef DIRECTFILEWRITER_H_
+#define DIRECTFILEWRITER_H_
+
+#include <stddef.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include "config.h"
+#include "mutex.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// Writes a log file with O_DIRECT so that log data never goes through
+// (and never evicts anything from) the page cache.
+//
+// O_DIRECT requires the memory buffer, the file offset and the length of
+// every write to be multiples of the logical block size, so records are
+// accumulated into two block-aligned buffers.  When the active buffer is
+// full it is handed to a background thread and the other buffer becomes
+// active, so the caller only blocks when both buffers are full.
+//
+// Flush() writes whatever is buffered, padding the last partial block
+// with zeros, and then truncates the file back to its logical length.
+// The partial block stays in memory and is rewritten in place by the
+// next write, so the file never contains the padding once Flush() or
+// Close() returns.
+//
+// The child of a fork() inherits the writer without its thread: it must
+// only Close() it (see OwnedByThisProcess()), and not delete it.  That
+// drops what is buffered, which the parent writes, and closes the
+// child's descriptor without touching the parent's thread or its lock.
+//
+// Not thread-safe: LogFileObject serializes all calls under its lock_.
+class DirectFileWriter {
+public:
+  static const size_t kBlockSize = 4096;
+  static const size_t kBufferSize = 64 * kBlockSize;
+
+  DirectFileWriter();
+  ~DirectFileWriter();
+
+  // Take ownership of "fd" and switch it to O_DIRECT.  Returns false
+  // (leaving "fd" untouched and owned by the caller) if the file system
+  // doesn't support direct I/O.
+  bool Attach(int fd);
+
+  // Buffer "len" bytes, writing out full buffers as needed.
+  void Append(const char* data, size_t len);
+
+  // Write everything buffered so far and wait for it to complete.
+  void Flush();
+
+  // Write out the active buffer without locking or waiting for the
+  // writer thread, for the failure signal handler.  A buffer still in
+  // flight is left to the writer thread.
+  void FlushUnsafe();
+
+  // Flush() and close the file.
+  void Close();
+
+  int fd() const { return fd_; }
+
+  // Was the writer attached by this process, not inherited through fork()?
+  bool OwnedByThisProcess() const { return pid_ == getpid(); }
+
+  // errno of the first failed write, or 0.
+  int error() const { return error_; }
+
+private:
+  struct Buffer {
+    char* data;
+    size_t used;            // valid bytes in data
+    off_t file_offset;      // block-aligned offset of data[0] in the file
+  };
+
+  static void* WriterThreadMain(void* arg);
+  void WriterLoop();
+
+  // Hand buffers_[active_] to the writer thread and make the other
+  // buffer active.  Blocks while the other buffer is still in flight.
+  void SubmitActive();
+
+  // Wait until the writer thread has nothing in flight.
+  // REQUIRES: cv_ is held.
+  void WaitForInFlightLocked();
+
+  // Write "len" bytes of "buffer" at its file offset, retrying on EINTR
+  // and short writes.  Records the first error in error_.
+  void WriteBuffer(const Buffer* buffer, size_t len);
+
+  int fd_;
+  pid_t pid_;               // process that called Attach()
+  int error_;
+  off_t logical_length_;    // bytes appended so far
+  Buffer buffers_[2];
+  int active_;
+
+  CondVar cv_;
+  Buffer* in_flight_;       // under cv_: buffer being written, or NULL
+  bool stop_;               // under cv_: ask the writer thread to exit
+  bool thread_started_;
+  pthread_t thread_;
+
+  // Disallow
+  DirectFileWriter(const DirectFileWriter&);
+  void operator=(const DirectFileWriter&);
+};
+
+_END_GOOGLE_NAMESPACE_
+
+#endif /* DIRECTFILEWRITER_H_ */
@@ -0,0 +1,250 @@
+/*
+ * EmailNotifier.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#include "EmailNotifier.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include "LogDestination.h"
+#include "LogStats.h"
+#include "utilities.h"
+
+extern char** environ;
+
+using std::string;
+using std::vector;
+
+_START_GOOGLE_NAMESPACE_
+
+// Alerts beyond this many per interval are only counted.
+static const size_t kMaxQueuedAlerts = 100;
+
+EmailNotifier* EmailNotifier::notifier_ = NULL;
+
+// At load time, so that no notifier is started before the handler exists.
+int EmailNotifier::fork_handler_registered_ =
+    EmailNotifier::RegisterForkHandler();
+
+int EmailNotifier::RegisterForkHandler() {
+  return pthread_atfork(NULL, NULL, &ForgetNotifier) == 0;
+}
+
+void EmailNotifier::ForgetNotifier() {
+  // Leaked: its lock may have been held by a thread of the parent.
+  notifier_ = NULL;
+}
+
+EmailNotifier* EmailNotifier::Get() {
+  if (notifier_ == NULL) {
+    // hostname() caches its result without locking: fill it in now,
+    // while log_mutex is held, rather than from the notifier thread.
+    LogDestination::hostname();
+    EmailNotifier* notifier = new EmailNotifier;
+    if (pthread_create(&notifier->thread_, NULL, &ThreadMain, notifier) != 0) {
+      delete notifier;
+      return NULL;
+    }
+    pthread_detach(notifier->thread_);
+    notifier_ = notifier;
+  }
+  return notifier_;
+}
+
+EmailNotifier::EmailNotifier()
+  : dropped_(0), next_send_time_(0), flush_requested_(false), busy_(false) {
+}
+
+void EmailNotifier::Enqueue(LogSeverity severity, const string& to,
+                            const char* message, size_t len) {
+  CondVarLock l(&cv_);
+  if (queue_.size() >= kMaxQueuedAlerts) {
+    LogStats::Add(LogStats::kDroppedEmail);
+    ++dropped_;
+    return;
+  }
+  queue_.push_back(Alert());
+  Alert& alert = queue_.back();
+  alert.severity = severity;
+  alert.to = to;
+  alert.message.assign(message, len);
+  cv_.Signal();
+}
+
+void EmailNotifier::Flush(int timeout_ms) {
+  CondVarLock l(&cv_);
+  flush_requested_ = true;
+  cv_.SignalAll();
+  struct timespec start, now;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  while (!queue_.empty() || busy_) {
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const int elapsed_ms = (now.tv_sec - start.tv_sec) * 1000 +
+                           (now.tv_nsec - start.tv_nsec) / 1000000;
+    if (elapsed_ms >= timeout_ms) break;
+    cv_.WaitWithTimeout(timeout_ms - elapsed_ms);
+  }
+}
+
+void* EmailNotifier::ThreadMain(void* arg) {
+  // A mailer that exits without reading its input must not kill the
+  // process with SIGPIPE; the signal stays pending on this thread.
+  sigset_t sigpipe;
+  sigemptyset(&sigpipe);
+  sigaddset(&sigpipe, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &sigpipe, NULL);
+  static_cast<EmailNotifier*>(arg)->Loop();
+  return NULL;
+}
+
+void EmailNotifier::Loop() {
+  cv_.Lock();
+  while (true) {
+    if (queue_.empty()) {
+      flush_requested_ = false;
+      cv_.SignalAll();
+      cv_.Wait();
+      continue;
+    }
+    const time_t now = time(NULL);
+    if (!flush_requested_ && now < next_send_time_) {
+      // Rate limited: let the burst accumulate into one digest.
+      cv_.WaitWithTimeout((next_send_time_ - now) * 1000);
+      continue;
+    }
+    vector<Alert> alerts;
+    alerts.swap(queue_);
+    size_t dropped = dropped_;
+    dropped_ = 0;
+    busy_ = true;
+    next_send_time_ = now + std::max(FLAGS_logemail_interval_secs, 0);
+    cv_.Unlock();
+
+    // One digest per recipient list, in the order they first appeared.
+    vector<Alert> sorted;
+    sorted.reserve(alerts.size());
+    for (size_t i = 0; i < alerts.size(); ++i) {
+      if (alerts[i].to.empty()) continue;  // already taken
+      const string to = alerts[i].to;
+      for (size_t j = i; j < alerts.size(); ++j) {
+        if (alerts[j].to == to) {
+          sorted.push_back(alerts[j]);
+          alerts[j].to.clear();
+        }
+      }
+    }
+    size_t begin = 0;
+    while (begin < sorted.size()) {
+      size_t end = begin + 1;
+      while (end < sorted.size() && sorted[end].to == sorted[begin].to) ++end;
+      SendDigest(sorted, begin, end, dropped);
+      dropped = 0;
+      begin = end;
+    }
+
+    cv_.Lock();
+    busy_ = false;
+    cv_.SignalAll();
+  }
+}
+
+// Run the mailer with "body" on its standard input.  No shell is
+// involved, so the subject and the addresses need no quoting.
+static bool SpawnMailer(const string& to, const string& subject,
+                        const string& body) {
+  int fds[2];
+  if (pipe2(fds, O_CLOEXEC) != 0) return false;
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, fds[0], STDIN_FILENO);
+  char* const argv[] = {
+    const_cast<char*>(FLAGS_logmailer.c_str()),
+    const_cast<char*>("-s"),
+    const_cast<char*>(subject.c_str()),
+    const_cast<char*>(to.c_str()),
+    NULL
+  };
+  pid_t pid;
+  const int error = posix_spawnp(&pid, FLAGS_logmailer.c_str(), &actions,
+                                 NULL, argv, environ);
+  posix_spawn_file_actions_destroy(&actions);
+  close(fds[0]);
+  if (error != 0) {
+    close(fds[1]);
+    errno = error;
+    return false;
+  }
+
+  const char* data = body.data();
+  size_t left = body.size();
+  while (left > 0) {
+    ssize_t n = write(fds[1], data, left);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EPIPE) {
+        // Consume the SIGPIPE blocked in ThreadMain().
+        sigset_t sigpipe;
+        sigemptyset(&sigpipe);
+        sigaddset(&sigpipe, SIGPIPE);
+        struct timespec zero = { 0, 0 };
+        sigtimedwait(&sigpipe, NULL, &zero);
+      }
+      break;
+    }
+    data += n;
+    left -= n;
+  }
+  close(fds[1]);
+
+  int status;
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) return false;
+  }
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+void EmailNotifier::SendDigest(const vector<Alert>& alerts, size_t begin,
+                               size_t end, size_t dropped) {
+  LogSeverity severity = alerts[begin].severity;
+  for (size_t i = begin; i < end; ++i) {
+    severity = std::max(severity, alerts[i].severity);
+  }
+  string subject = string("[LOG] ") + LogSeverityNames[severity] + ": " +
+                   glog_internal_namespace_::ProgramInvocationShortName();
+  const size_t count = end - begin + dropped;
+  if (count > 1) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), " (%lu messages)",
+             static_cast<unsigned long>(count));
+    subject += buf;
+  }
+  string body(LogDestination::hostname());
+  body += "\n\n";
+  for (size_t i = begin; i < end; ++i) {
+    body += alerts[i].message;
+  }
+  if (dropped > 0) {
+    char buf[128];
+    snprintf(buf, sizeof(buf), "\n... and %lu more messages not shown\n",
+             static_cast<unsigned long>(dropped));
+    body += buf;
+  }
+
+  const string& to = alerts[begin].to;
+  if (!SpawnMailer(to, subject, body)) {
+    // Can't LOG() here: the alert could end up back in this queue.
+    fprintf(stderr, "Problems sending mail to %s\n", to.c_str());
+  }
+}
+
+_END_GOOGLE_NAMESPACE_
@@ -0,0 +1,90 @@
+/*
+ * EmailNotifier.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#ifndef EMAILNOTIFIER_H_
+#define EMAILNOTIFIER_H_
+
+#include <pthread.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include "logging.h"
+#include "mutex.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// Sends the email alerts of --logemaillevel / --alsologtoemail from a
+// background thread, so that no LOG() caller ever waits for the mailer.
+//
+// LogDestination::MaybeLogToEmail() only copies the message into a
+// bounded queue (it runs with log_mutex held).  The notifier thread
+// sends at most one digest per recipient list every
+// --logemail_interval_secs: the first alert after a quiet period goes
+// out right away, and everything logged during the following interval
+// is coalesced into the next digest.  The mailer is started with
+// posix_spawn() and fed the digest through a pipe.
+//
+// The child of a fork() doesn't have the notifier thread: a
+// pthread_atfork() handler, registered when the library is loaded,
+// forgets the parent's notifier (and its queue, which the parent sends)
+// so that the child starts one of its own.
+class EmailNotifier {
+public:
+  // The notifier, started on first use.  REQUIRES: log_mutex is held.
+  static EmailNotifier* Get();
+
+  // The notifier if it has been started, else NULL.
+  static EmailNotifier* GetIfStarted() { return notifier_; }
+
+  // Queue "message[0,len-1]" for "to" (a comma separated list).
+  // Never blocks on the mailer.
+  void Enqueue(LogSeverity severity, const std::string& to,
+               const char* message, size_t len);
+
+  // Send everything queued now, ignoring the rate limit, and wait up to
+  // "timeout_ms" for the mailer to finish.  Used before a FATAL abort.
+  void Flush(int timeout_ms);
+
+private:
+  struct Alert {
+    LogSeverity severity;
+    std::string to;
+    std::string message;
+  };
+
+  EmailNotifier();
+
+  static void* ThreadMain(void* arg);
+  void Loop();
+
+  // Send one digest of "alerts" (all for the same recipients).
+  void SendDigest(const std::vector<Alert>& alerts, size_t begin,
+                  size_t end, size_t dropped);
+
+  // pthread_atfork() child handler.
+  static void ForgetNotifier();
+  static int RegisterForkHandler();
+
+  static EmailNotifier* notifier_;
+  static int fork_handler_registered_;
+
+  CondVar cv_;
+  std::vector<Alert> queue_;      // under cv_
+  size_t dropped_;                // under cv_: alerts the queue had no room for
+  time_t next_send_time_;         // under cv_: rate limit
+  bool flush_requested_;          // under cv_
+  bool busy_;                     // under cv_: a digest is being sent
+  pthread_t thread_;
+
+  // Disallow
+  EmailNotifier(const EmailNotifier&);
+  void operator=(const EmailNotifier&);
+};
+
+_END_GOOGLE_NAMESPACE_
+
+#endif /* EMAILNOTIFIER_H_ */
@@ -0,0 +1,228 @@
+/*
+ * FailureSignalHandler.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#include "FailureSignalHandler.h"
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include "AsyncStderrWriter.h"
+#include "LogDestination.h"
+#include "MinimalFormatter.h"
+#include "logging.h"
+#include "stacktrace.h"
+#include "symbolize.h"
+#include "utilities.h"
+
+_START_GOOGLE_NAMESPACE_
+
+namespace {
+
+const struct {
+  int number;
+  const char* name;
+} kFailureSignals[] = {
+  { SIGSEGV, "SIGSEGV" },
+  { SIGILL, "SIGILL" },
+  { SIGFPE, "SIGFPE" },
+  { SIGABRT, "SIGABRT" },
+  { SIGBUS, "SIGBUS" },
+};
+
+#if defined(__x86_64__)
+const struct {
+  int index;
+  const char* name;
+} kRegisters[] = {
+  { REG_RIP, "rip" }, { REG_RSP, "rsp" }, { REG_RBP, "rbp" },
+  { REG_EFL, "eflags" }, { REG_RAX, "rax" }, { REG_RBX, "rbx" },
+  { REG_RCX, "rcx" }, { REG_RDX, "rdx" }, { REG_RSI, "rsi" },
+  { REG_RDI, "rdi" }, { REG_R8, "r8" }, { REG_R9, "r9" },
+  { REG_R10, "r10" }, { REG_R11, "r11" }, { REG_R12, "r12" },
+  { REG_R13, "r13" }, { REG_R14, "r14" }, { REG_R15, "r15" },
+};
+const int kRegistersPerLine = 3;
+#endif
+
+// The alternate signal stack of the thread that called Init().
+char main_alternate_stack[FailureSignalHandler::kAlternateStackSize];
+
+// The thread reporting a crash, or 0.
+int crashing_tid = 0;
+
+// The handler's buffers: only the crashing thread gets to use them.
+char line[1024];
+char symbol[1024];
+
+// Write what "out" has to stderr, and clear it.
+void Flush(MinimalFormatter* out) {
+  const char* p = out->data();
+  const char* const end = p + out->size();
+  while (p < end) {
+    const ssize_t n = write(STDERR_FILENO, p, end - p);
+    if (n <= 0) break;
+    p += n;
+  }
+  out->Clear();
+}
+
+const char* SignalName(int signal) {
+  for (size_t i = 0; i < ARRAYSIZE(kFailureSignals); ++i) {
+    if (kFailureSignals[i].number == signal) return kFailureSignals[i].name;
+  }
+  return "signal";
+}
+
+void WriteSignalInfo(MinimalFormatter* out, int signal, siginfo_t* info) {
+  out->AppendString("*** Aborted at ");
+  out->AppendInt64(time(NULL));
+  out->AppendString(" (unix time) ***\n*** ");
+  out->AppendString(SignalName(signal));
+  out->AppendString(" (@");
+  out->AppendHex(reinterpret_cast<uintptr_t>(info->si_addr));
+  out->AppendString(") received by PID ");
+  out->AppendInt64(getpid());
+  out->AppendString(" (TID ");
+  out->AppendInt64(crashing_tid);
+  out->AppendString(")");
+  if (info->si_code <= 0) {
+    // Sent by kill() and the like: there is a sender.
+    out->AppendString(" from PID ");
+    out->AppendInt64(info->si_pid);
+  }
+  out->AppendString(", code ");
+  out->AppendInt64(info->si_code);
+  out->AppendString(" ***\n");
+  Flush(out);
+}
+
+void WriteRegisters(MinimalFormatter* out, void* ucontext) {
+#if defined(__x86_64__)
+  const greg_t* gregs =
+      static_cast<ucontext_t*>(ucontext)->uc_mcontext.gregs;
+  for (size_t i = 0; i < ARRAYSIZE(kRegisters); ++i) {
+    out->AppendString(i % kRegistersPerLine == 0 ? "" : "  ");
+    out->AppendString(kRegisters[i].name);
+    out->AppendString(" ");
+    out->AppendHex(gregs[kRegisters[i].index]);
+    if (i % kRegistersPerLine == kRegistersPerLine - 1 ||
+        i + 1 == ARRAYSIZE(kRegisters)) {
+      out->AppendString("\n");
+      Flush(out);
+    }
+  }
+#endif
+}
+
+void* FaultingPc(void* ucontext) {
+#if defined(__x86_64__)
+  return reinterpret_cast<void*>(
+      static_cast<ucontext_t*>(ucontext)->uc_mcontext.gregs[REG_RIP]);
+#else
+  return NULL;
+#endif
+}
+
+// "prefix@ pc  symbol".  "symbol_pc" is the address to look up.
+void WritePc(MinimalFormatter* out, const char* prefix, void* pc,
+             void* symbol_pc) {
+  out->AppendString(prefix);
+  out->AppendString("@ ");
+  out->AppendHex(reinterpret_cast<uintptr_t>(pc));
+  if (FLAGS_symbolize_stacktrace) {
+    out->AppendString("  ");
+    out->AppendString(Symbolize(symbol_pc, symbol, sizeof(symbol))
+                      ? symbol : "(unknown)");
+  }
+  out->AppendString("\n");
+  Flush(out);
+}
+
+bool SetAlternateStack(char* memory) {
+  stack_t current;
+  if (sigaltstack(NULL, &current) != 0 || !(current.ss_flags & SS_DISABLE)) {
+    return false;
+  }
+  stack_t stack;
+  memset(&stack, 0, sizeof(stack));
+  stack.ss_sp = memory;
+  stack.ss_size = FailureSignalHandler::kAlternateStackSize;
+  return sigaltstack(&stack, NULL) == 0;
+}
+
+// Let the default action of "signal" take its course once the handler
+// returns.
+void InvokeDefaultHandler(int signal) {
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  sigemptyset(&action.sa_mask);
+  action.sa_handler = SIG_DFL;
+  sigaction(signal, &action, NULL);
+  kill(getpid(), signal);
+}
+
+}  // namespace
+
+void FailureSignalHandler::Init() {
+  if (!FLAGS_failure_signal_handler) return;
+  SetAlternateStack(main_alternate_stack);
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  sigemptyset(&action.sa_mask);
+  action.sa_sigaction = &HandleSignal;
+  action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+  for (size_t i = 0; i < ARRAYSIZE(kFailureSignals); ++i) {
+    sigaction(kFailureSignals[i].number, &action, NULL);
+  }
+}
+
+void FailureSignalHandler::InstallAlternateStack() {
+  char* memory = new char[kAlternateStackSize];
+  if (!SetAlternateStack(memory)) delete[] memory;
+}
+
+void FailureSignalHandler::HandleSignal(int signal, siginfo_t* info,
+                                        void* ucontext) {
+  const int tid = syscall(SYS_gettid);
+  int reporting = 0;
+  if (!__atomic_compare_exchange_n(&crashing_tid, &reporting, tid, false,
+                                   __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+    if (reporting == tid) {
+      // Crashed while reporting: give up on the report.
+      InvokeDefaultHandler(signal);
+      return;
+    }
+    // Another thread is reporting, and will kill the process.
+    while (true) sleep(1);
+  }
+
+  MinimalFormatter out(line, sizeof(line));
+  AsyncStderrWriter* stderr_writer = AsyncStderrWriter::GetIfStarted();
+  if (stderr_writer != NULL) {
+    // Older than the crash: first.
+    stderr_writer->WriteQueuedUnsafe(STDERR_FILENO);
+  }
+  WriteSignalInfo(&out, signal, info);
+  WriteRegisters(&out, ucontext);
+  void* const pc = FaultingPc(ucontext);
+  if (pc != NULL) WritePc(&out, "PC: ", pc, pc);
+
+  out.AppendString("*** Stack trace: ***\n");
+  Flush(&out);
+  void* stack[32];
+  const int depth = GetStackTrace(stack, ARRAYSIZE(stack), 1);
+  for (int i = 0; i < depth; ++i) {
+    // Return addresses: the call is the byte before.
+    WritePc(&out, "    ", stack[i], static_cast<char*>(stack[i]) - 1);
+  }
+
+  LogDestination::FlushLogFilesUnsafe();
+  InvokeDefaultHandler(signal);
+}
+
+_END_GOOGLE_NAMESPACE_
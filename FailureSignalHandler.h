@@ -0,0 +1,61 @@
+/*
+ * FailureSignalHandler.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#ifndef FAILURESIGNALHANDLER_H_
+#define FAILURESIGNALHANDLER_H_
+
+#include <signal.h>
+#include "config.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// Reports SIGSEGV, SIGILL, SIGFPE, SIGABRT and SIGBUS on stderr before
+// the process dies of them (--failure_signal_handler):
+//
+//   *** Aborted at 1792396800 (unix time) ***
+//   *** SIGSEGV (@0x0) received by PID 1234 (TID 1240), code 1 ***
+//   rip 0x... rsp 0x... ...
+//   PC: @ 0x...  Foo::Bar()
+//   *** Stack trace: ***
+//       @ 0x...  Foo::Bar()
+//       ...
+//
+// after the messages still queued for --log_async_stderr.  Then
+// the log files are flushed and the signal is raised again with its
+// default action, so the exit status and core dump are as without it.
+//
+// The handler can run in any state the process crashed in, so it only
+// uses preallocated memory, formats without snprintf() and writes with
+// write(); it never takes log_mutex or a LogFileObject's lock (the
+// crashing thread may hold them) and reads their state racily.  It runs
+// on an alternate signal stack, so that stack overflows are reported,
+// in the thread that called Init() (normally the main thread); other
+// threads get one by calling InstallAlternateStack().
+//
+// When a second thread crashes while the first is reporting, it waits
+// for the first one to kill the process.  A crash in the handler itself
+// goes straight to the default action.
+class FailureSignalHandler {
+public:
+  // Install the handler if --failure_signal_handler is set.  Called by
+  // InitGoogleLogging().
+  static void Init();
+
+  // Give the calling thread an alternate signal stack of
+  // kAlternateStackSize bytes, unless it has one.  Allocates; the
+  // stack of the thread that called Init() is preallocated.
+  static void InstallAlternateStack();
+
+  static const int kAlternateStackSize = 64 * 1024;
+
+private:
+  static void HandleSignal(int signal, siginfo_t* info, void* ucontext);
+};
+
+_END_GOOGLE_NAMESPACE_
+
+#endif /* FAILURESIGNALHANDLER_H_ */
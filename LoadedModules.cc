@@ -0,0 +1,249 @@
+/*
+ * LoadedModules.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#include "LoadedModules.h"
+#include <elf.h>
+#include <link.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+#include "mutex.h"
+
+using std::vector;
+
+_START_GOOGLE_NAMESPACE_
+
+namespace {
+
+Mutex refresh_mutex;
+// Replaced snapshots that may still have readers.  Under refresh_mutex.
+vector<const LoadedModules::Snapshot*>* retired_snapshots = NULL;
+
+size_t Align(size_t n, size_t align) {
+  return (n + align - 1) & ~(align - 1);
+}
+
+int GetGeneration(struct dl_phdr_info* info, size_t, void* data) {
+  *static_cast<uint64*>(data) = info->dlpi_adds + info->dlpi_subs;
+  return 1;  // The first module is enough.
+}
+
+int CountModule(struct dl_phdr_info*, size_t, void* data) {
+  ++*static_cast<size_t*>(data);
+  return 0;
+}
+
+struct ModuleList {
+  LoadedModules::Module* modules;
+  size_t count;
+  size_t capacity;
+};
+
+int AddModule(struct dl_phdr_info* info, size_t, void* data) {
+  ModuleList* list = static_cast<ModuleList*>(data);
+  if (list->count == list->capacity) return 0;
+  LoadedModules::Module& module = list->modules[list->count];
+  module.start = ~static_cast<uintptr_t>(0);
+  module.end = 0;
+  module.bias = info->dlpi_addr;
+  module.eh_frame_hdr = NULL;
+  strcpy(module.build_id, "-");
+  size_t num_loads = 0;
+  for (int i = 0; i < info->dlpi_phnum; ++i) {
+    if (info->dlpi_phdr[i].p_type == PT_LOAD) ++num_loads;
+  }
+  LoadedModules::Segment* segments = new LoadedModules::Segment[num_loads];
+  module.segments = segments;
+  module.num_segments = 0;
+  for (int i = 0; i < info->dlpi_phnum; ++i) {
+    const ElfW(Phdr)& phdr = info->dlpi_phdr[i];
+    const uintptr_t address = info->dlpi_addr + phdr.p_vaddr;
+    if (phdr.p_type == PT_LOAD) {
+      module.start = std::min(module.start, address);
+      module.end = std::max<uintptr_t>(module.end, address + phdr.p_memsz);
+      segments[module.num_segments].start = address;
+      segments[module.num_segments].end = address + phdr.p_memsz;
+      ++module.num_segments;
+    } else if (phdr.p_type == PT_GNU_EH_FRAME) {
+      module.eh_frame_hdr = reinterpret_cast<const uint8_t*>(address);
+    } else if (phdr.p_type == PT_NOTE && strcmp(module.build_id, "-") == 0) {
+      if (!LoadedModules::FindBuildId(reinterpret_cast<const char*>(address),
+                                      phdr.p_memsz, phdr.p_align == 8 ? 8 : 4,
+                                      module.build_id,
+                                      sizeof(module.build_id))) {
+        strcpy(module.build_id, "-");
+      }
+    }
+  }
+  if (module.start >= module.end) {
+    delete[] segments;
+    return 0;
+  }
+
+  // The main program has no name here.
+  char exe[1024];
+  const char* path = info->dlpi_name;
+  module.main_program = path == NULL || path[0] == '\0';
+  if (module.main_program) {
+    const ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    exe[n > 0 ? n : 0] = '\0';
+    path = n > 0 ? exe : "/proc/self/exe";
+  }
+  module.path = strdup(path);
+  if (module.path == NULL) {
+    delete[] segments;
+    return 0;
+  }
+  ++list->count;
+  return 0;
+}
+
+bool ModuleStartsBefore(const LoadedModules::Module& a,
+                        const LoadedModules::Module& b) {
+  return a.start < b.start;
+}
+
+void FreeSnapshot(const LoadedModules::Snapshot* snapshot) {
+  for (size_t i = 0; i < snapshot->count; ++i) {
+    delete[] snapshot->modules[i].segments;
+    free(const_cast<char*>(snapshot->modules[i].path));
+  }
+  delete[] snapshot->modules;
+  delete snapshot;
+}
+
+}  // namespace
+
+const LoadedModules::Snapshot* LoadedModules::current_ = NULL;
+int LoadedModules::readers_ = 0;
+
+// At load time, so that no Reader is forked before the handler exists.
+int LoadedModules::fork_handler_registered_ =
+    LoadedModules::RegisterForkHandler();
+
+int LoadedModules::RegisterForkHandler() {
+  return pthread_atfork(NULL, NULL, &ForgetReaders) == 0;
+}
+
+void LoadedModules::ForgetReaders() {
+  // The other threads, and their Readers, stayed in the parent.
+  readers_ = 0;
+}
+
+LoadedModules::Reader::Reader() {
+  // Sequentially consistent, against those in Refresh(): either it sees
+  // this reader, or this reader sees the snapshot that replaced the one
+  // it would free.
+  __atomic_add_fetch(&readers_, 1, __ATOMIC_SEQ_CST);
+  snapshot_ = __atomic_load_n(&current_, __ATOMIC_SEQ_CST);
+}
+
+LoadedModules::Reader::~Reader() {
+  __atomic_sub_fetch(&readers_, 1, __ATOMIC_SEQ_CST);
+}
+
+uint64 LoadedModules::CurrentGeneration() {
+  uint64 generation = 0;
+  dl_iterate_phdr(&GetGeneration, &generation);
+  return generation;
+}
+
+void LoadedModules::Refresh() {
+  const uint64 generation = CurrentGeneration();
+  MutexLock l(&refresh_mutex);
+  if (retired_snapshots == NULL) {
+    retired_snapshots = new vector<const Snapshot*>;
+  }
+  const Snapshot* current = __atomic_load_n(&current_, __ATOMIC_ACQUIRE);
+  if (current == NULL || current->generation != generation) {
+    ModuleList list = { NULL, 0, 0 };
+    dl_iterate_phdr(&CountModule, &list.capacity);
+    list.modules = new Module[list.capacity];
+    dl_iterate_phdr(&AddModule, &list);
+    std::sort(list.modules, list.modules + list.count, &ModuleStartsBefore);
+    Snapshot* snapshot = new Snapshot;
+    snapshot->generation = generation;
+    snapshot->count = list.count;
+    snapshot->modules = list.modules;
+    __atomic_store_n(&current_, snapshot, __ATOMIC_SEQ_CST);
+    if (current != NULL) retired_snapshots->push_back(current);
+  }
+  // Readers are short (a stack trace), so there is rarely one here; if
+  // there is, the next call frees what this one couldn't.
+  if (!retired_snapshots->empty() &&
+      __atomic_load_n(&readers_, __ATOMIC_SEQ_CST) == 0) {
+    for (size_t i = 0; i < retired_snapshots->size(); ++i) {
+      FreeSnapshot((*retired_snapshots)[i]);
+    }
+    retired_snapshots->clear();
+  }
+}
+
+const LoadedModules::Module* LoadedModules::Find(const Snapshot* snapshot,
+                                                 uintptr_t pc) {
+  if (snapshot == NULL) return NULL;
+  size_t low = 0, high = snapshot->count;
+  while (low < high) {
+    const size_t mid = low + (high - low) / 2;
+    if (snapshot->modules[mid].start <= pc) low = mid + 1;
+    else high = mid;
+  }
+  if (low == 0) return NULL;
+  const Module* module = &snapshot->modules[low - 1];
+  return pc < module->end ? module : NULL;
+}
+
+bool LoadedModules::InSegment(const Module& module, const void* p,
+                              size_t size) {
+  const uintptr_t start = reinterpret_cast<uintptr_t>(p);
+  for (size_t i = 0; i < module.num_segments; ++i) {
+    const Segment& segment = module.segments[i];
+    if (segment.start <= start && start < segment.end &&
+        size <= segment.end - start) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool LoadedModules::FindBuildId(const char* notes, size_t size, size_t align,
+                                char* out, size_t out_size) {
+  static const char kHex[] = "0123456789abcdef";
+  size_t offset = 0;
+  while (offset + sizeof(ElfW(Nhdr)) <= size) {
+    const ElfW(Nhdr)* note =
+        reinterpret_cast<const ElfW(Nhdr)*>(notes + offset);
+    const size_t name = offset + sizeof(ElfW(Nhdr));
+    const size_t desc = name + Align(note->n_namesz, align);
+    const size_t next = desc + Align(note->n_descsz, align);
+    if (next > size || next <= offset) return false;
+    if (note->n_type == NT_GNU_BUILD_ID && note->n_namesz == 4 &&
+        memcmp(notes + name, "GNU", 4) == 0) {
+      if (2 * note->n_descsz + 1 > out_size) return false;
+      const unsigned char* id =
+          reinterpret_cast<const unsigned char*>(notes + desc);
+      for (size_t i = 0; i < note->n_descsz; ++i) {
+        out[2 * i] = kHex[id[i] >> 4];
+        out[2 * i + 1] = kHex[id[i] & 0xf];
+      }
+      out[2 * note->n_descsz] = '\0';
+      return note->n_descsz > 0;
+    }
+    offset = next;
+  }
+  return false;
+}
+
+size_t LoadedModules::retired() {
+  MutexLock l(&refresh_mutex);
+  return retired_snapshots == NULL ? 0 : retired_snapshots->size();
+}
+
+_END_GOOGLE_NAMESPACE_
@@ -0,0 +1,111 @@
+/*
+ * LoadedModules.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#ifndef LOADEDMODULES_H_
+#define LOADEDMODULES_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "basic_type.h"
+#include "config.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// One snapshot of the loaded modules (one dl_iterate_phdr() walk), shared
+// by CfiUnwinder, ModuleMap and SymbolCache.
+//
+// Refresh() builds a new snapshot only when dlopen() or dlclose() ran
+// since the last one.  Readers, which may be signal handlers, take no
+// lock: they announce themselves with a Reader, and a replaced snapshot
+// is freed by a later Refresh() once no Reader is left.
+class LoadedModules {
+public:
+  // Build-ids are 20 bytes (sha1) in practice; allow up to 64.
+  static const size_t kMaxBuildIdHex = 2 * 64 + 1;
+
+  // A PT_LOAD segment: [start, end).
+  struct Segment {
+    uintptr_t start;
+    uintptr_t end;
+  };
+
+  // The crash paths don't Refresh(), so the module may have been unloaded
+  // since, and something else mapped at its address: bound reads of its
+  // contents to its segments, with InSegment().
+  struct Module {
+    uintptr_t start;               // of the lowest PT_LOAD segment
+    uintptr_t end;                 // of the highest PT_LOAD segment
+    uintptr_t bias;
+    const Segment* segments;
+    size_t num_segments;
+    const uint8_t* eh_frame_hdr;   // NULL if none
+    char build_id[kMaxBuildIdHex];   // "-" if none
+    const char* path;
+    bool main_program;             // path is where /proc/self/exe pointed
+  };
+
+  struct Snapshot {
+    uint64 generation;             // see CurrentGeneration()
+    size_t count;
+    const Module* modules;         // sorted by start
+  };
+
+  // Keeps the snapshot current at construction from being freed until
+  // destruction.  Doesn't allocate, lock or make system calls.
+  class Reader {
+  public:
+    Reader();
+    ~Reader();
+
+    // NULL before the first Refresh().
+    const Snapshot* snapshot() const { return snapshot_; }
+
+  private:
+    const Snapshot* snapshot_;
+
+    // Disallow
+    Reader(const Reader&);
+    Reader& operator=(const Reader&);
+  };
+
+  // dlpi_adds + dlpi_subs: changes whenever a module is loaded or
+  // unloaded.  Not async-signal-safe (dl_iterate_phdr() takes the loader
+  // lock).
+  static uint64 CurrentGeneration();
+
+  // Pick up modules loaded or unloaded since the last call, and free the
+  // snapshots it replaced that nobody reads any more.  Cheap when nothing
+  // changed.  Not async-signal-safe: InitGoogleLogging() and
+  // DumpStackTraceToString() call it, the crash paths don't.
+  static void Refresh();
+
+  // The module of "snapshot" that contains "pc", or NULL.
+  static const Module* Find(const Snapshot* snapshot, uintptr_t pc);
+
+  // Whether [p, p + size) lies within one PT_LOAD segment of "module".
+  static bool InSegment(const Module& module, const void* p, size_t size);
+
+  // Write the NT_GNU_BUILD_ID note in notes[0, size) as hex to "out".
+  static bool FindBuildId(const char* notes, size_t size, size_t align,
+                          char* out, size_t out_size);
+
+  // How many replaced snapshots are still waiting for their readers.
+  static size_t retired();
+
+private:
+  // pthread_atfork() child handler.
+  static void ForgetReaders();
+  static int RegisterForkHandler();
+
+  static const Snapshot* current_;
+  static int readers_;
+  static int fork_handler_registered_;
+};
+
+_END_GOOGLE_NAMESPACE_
+
+#endif /* LOADEDMODULES_H_ */
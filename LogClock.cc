@@ -0,0 +1,200 @@
+/*
+ * LogClock.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#include "LogClock.h"
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+#include "logging.h"
+
+_START_GOOGLE_NAMESPACE_
+
+int LogClock::source_ = LogClock::kRealtime;
+
+namespace {
+
+// The TSC scaled to wall time:
+//   nanos + (tsc_now - tsc) * mult / 2^32
+// Written by the calibration thread only, under the seqlock "sequence":
+// odd while being written, 0 until the first calibration.
+struct Calibration {
+  uint64 tsc;
+  int64 nanos;
+  uint64 mult;
+};
+
+unsigned sequence = 0;
+Calibration calibration;
+
+pthread_once_t calibration_once = PTHREAD_ONCE_INIT;
+
+// The first calibration is over this short an interval, so that the TSC
+// is usable soon after Init(); the following ones take
+// kCalibrationIntervalMs for precision.
+const int kFirstCalibrationMs = 10;
+
+// How many times to try to read the TSC and CLOCK_REALTIME close together.
+const int kSampleTries = 5;
+
+inline uint64 ReadTsc() {
+#if defined(__x86_64__) || defined(__i386__)
+  uint32 low, high;
+  __asm__ volatile("rdtsc" : "=a"(low), "=d"(high));
+  return static_cast<uint64>(high) << 32 | low;
+#else
+  return 0;
+#endif
+}
+
+// Does the TSC tick at a constant rate, through frequency changes and
+// sleep states?
+bool HasInvariantTsc() {
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned eax, ebx, ecx, edx;
+  if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) ||
+      eax < 0x80000007) {
+    return false;
+  }
+  __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+  return (edx & (1 << 8)) != 0;
+#else
+  return false;
+#endif
+}
+
+int64 RealtimeNanos() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return static_cast<int64>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// A TSC value and CLOCK_REALTIME taken at (nearly) the same time: the
+// TSC read halfway through the clock_gettime() that took the least
+// cycles of a few tries.
+void Sample(uint64* tsc, int64* nanos) {
+  uint64 best = ~0ULL;
+  for (int i = 0; i < kSampleTries; ++i) {
+    const uint64 before = ReadTsc();
+    const int64 now = RealtimeNanos();
+    const uint64 after = ReadTsc();
+    if (after - before < best) {
+      best = after - before;
+      *tsc = before + (after - before) / 2;
+      *nanos = now;
+    }
+  }
+}
+
+void Publish(uint64 tsc, int64 nanos, uint64 mult) {
+  const unsigned next = sequence + 2;
+  __atomic_store_n(&sequence, sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  __atomic_store_n(&calibration.tsc, tsc, __ATOMIC_RELAXED);
+  __atomic_store_n(&calibration.nanos, nanos, __ATOMIC_RELAXED);
+  __atomic_store_n(&calibration.mult, mult, __ATOMIC_RELAXED);
+  __atomic_store_n(&sequence, next, __ATOMIC_RELEASE);
+}
+
+}  // namespace
+
+// At load time, so that no calibration is started before the handler
+// exists.
+int LogClock::fork_handler_registered_ = LogClock::RegisterForkHandler();
+
+int LogClock::RegisterForkHandler() {
+  return pthread_atfork(NULL, NULL, &ForgetCalibration) == 0;
+}
+
+void LogClock::ForgetCalibration() {
+  // The calibration thread stayed in the parent: go back to realtime
+  // until a new one has calibrated.
+  sequence = 0;
+  calibration_once = PTHREAD_ONCE_INIT;
+}
+
+bool LogClock::calibrated() {
+  return __atomic_load_n(&sequence, __ATOMIC_ACQUIRE) != 0;
+}
+
+void LogClock::Init() {
+  Source source = kRealtime;
+  if (FLAGS_log_clock == "coarse") {
+    source = kCoarse;
+  } else if (FLAGS_log_clock == "tsc" && HasInvariantTsc()) {
+    pthread_once(&calibration_once, &StartCalibration);
+    source = kTsc;
+  }
+  __atomic_store_n(&source_, source, __ATOMIC_RELAXED);
+}
+
+void LogClock::StartCalibration() {
+  pthread_t thread;
+  if (pthread_create(&thread, NULL, &CalibrationThread, NULL) == 0) {
+    pthread_detach(thread);
+  }
+}
+
+int64 LogClock::NowNanos(Source source) {
+  return source == kTsc ? TscNowNanos() : ClockNanos(source);
+}
+
+int64 LogClock::ClockNanos(Source source) {
+  if (source != kCoarse) return RealtimeNanos();
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+  return static_cast<int64>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+int64 LogClock::TscNowNanos() {
+  while (true) {
+    const unsigned begin = __atomic_load_n(&sequence, __ATOMIC_ACQUIRE);
+    if (begin == 0) {
+      // Not calibrated yet.  Starts the thread in the child of a fork().
+      pthread_once(&calibration_once, &StartCalibration);
+      return RealtimeNanos();
+    }
+    if (begin & 1) continue;
+    const uint64 tsc = __atomic_load_n(&calibration.tsc, __ATOMIC_RELAXED);
+    const int64 nanos = __atomic_load_n(&calibration.nanos, __ATOMIC_RELAXED);
+    const uint64 mult = __atomic_load_n(&calibration.mult, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&sequence, __ATOMIC_RELAXED) != begin) continue;
+    // Signed: a TSC read just before the calibration.
+    const int64 ticks = static_cast<int64>(ReadTsc() - tsc);
+    return nanos + static_cast<int64>(
+        (static_cast<__int128>(ticks) * mult) >> 32);
+  }
+}
+
+void* LogClock::CalibrationThread(void*) {
+  uint64 last_tsc;
+  int64 last_nanos;
+  Sample(&last_tsc, &last_nanos);
+  int interval_ms = kFirstCalibrationMs;
+  while (true) {
+    usleep(interval_ms * 1000);
+    interval_ms = kCalibrationIntervalMs;
+    uint64 tsc;
+    int64 nanos;
+    Sample(&tsc, &nanos);
+    // Skip an interval in which the wall clock was stepped back.
+    if (tsc > last_tsc && nanos > last_nanos) {
+      const uint64 mult = static_cast<uint64>(
+          (static_cast<unsigned __int128>(nanos - last_nanos) << 32) /
+          (tsc - last_tsc));
+      Publish(tsc, nanos, mult);
+    }
+    last_tsc = tsc;
+    last_nanos = nanos;
+  }
+  return NULL;
+}
+
+_END_GOOGLE_NAMESPACE_
@@ -0,0 +1,85 @@
+/*
+ * LogClock.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#ifndef LOGCLOCK_H_
+#define LOGCLOCK_H_
+
+#include "config.h"
+#include "basic_type.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// The clock that timestamps log messages, chosen by --log_clock:
+//
+//   realtime  clock_gettime(CLOCK_REALTIME): a vDSO call, like the
+//             gettimeofday() it replaces, but with nanoseconds.
+//   coarse    CLOCK_REALTIME_COARSE: cheaper, but only as precise as the
+//             kernel tick (1-4 ms).
+//   tsc       The x86 time stamp counter, scaled to wall time: one
+//             rdtsc per read.  A background thread calibrates it
+//             against CLOCK_REALTIME every kCalibrationIntervalMs, so it
+//             follows NTP adjustments and steps with that delay.  It
+//             stays within a few microseconds of CLOCK_REALTIME, and can
+//             step by that much when recalibrated.  Needs an invariant TSC;
+//             without one, or until the first calibration, it is
+//             realtime.  The child of a fork() doesn't have the thread:
+//             a pthread_atfork() handler drops the parent's calibration,
+//             and the child's first read starts a calibration thread of
+//             its own.  The child is on realtime until that has
+//             calibrated.
+//
+// Times are int64 nanoseconds since the epoch, so no precision is lost
+// to doubles.
+class LogClock {
+public:
+  enum Source { kRealtime, kCoarse, kTsc };
+
+  static const int kCalibrationIntervalMs = 1000;
+
+  // Apply --log_clock, starting the calibration thread for tsc.  Called
+  // by InitGoogleLogging(); before that, the clock is realtime.
+  static void Init();
+
+  // The source in use.
+  static Source source() {
+    return static_cast<Source>(__atomic_load_n(&source_, __ATOMIC_RELAXED));
+  }
+
+  // Nanoseconds since the epoch.
+  static int64 NowNanos() {
+    switch (source()) {
+      case kTsc: return TscNowNanos();
+      case kCoarse: return ClockNanos(kCoarse);
+      default: return ClockNanos(kRealtime);
+    }
+  }
+
+  // Nanoseconds since the epoch from "source", bypassing --log_clock
+  // (for tests and benchmarks).  kTsc starts calibrating on first use,
+  // and is realtime until it has.
+  static int64 NowNanos(Source source);
+
+  // Has the TSC been calibrated in this process?
+  static bool calibrated();
+
+private:
+  static int64 ClockNanos(Source source);
+  static int64 TscNowNanos();
+  static void StartCalibration();
+  static void* CalibrationThread(void* arg);
+
+  // pthread_atfork() child handler.
+  static void ForgetCalibration();
+  static int RegisterForkHandler();
+
+  static int source_;
+  static int fork_handler_registered_;
+};
+
+_END_GOOGLE_NAMESPACE_
+
+#endif /* LOGCLOCK_H_ */
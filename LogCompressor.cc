@@ -0,0 +1,82 @@
+/*
+ * LogCompressor.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#include "LogCompressor.h"
+#include <string.h>
+
+_START_GOOGLE_NAMESPACE_
+
+// Logs compress very well even at the fastest level, and compression
+// runs with lock_ of the LogFileObject held.
+static const int kCompressionLevel = Z_BEST_SPEED;
+
+// windowBits + 16 asks zlib for a gzip header and trailer.
+static const int kGzipWindowBits = 15 + 16;
+
+LogCompressor::LogCompressor() : initialized_(false) {
+  memset(&stream_, 0, sizeof(stream_));
+  initialized_ = deflateInit2(&stream_, kCompressionLevel, Z_DEFLATED,
+                              kGzipWindowBits, 8,
+                              Z_DEFAULT_STRATEGY) == Z_OK;
+}
+
+LogCompressor::~LogCompressor() {
+  if (initialized_) deflateEnd(&stream_);
+}
+
+bool LogCompressor::CompressBlock(const char* data, size_t len,
+                                  std::string* out) {
+  if (!initialized_ || deflateReset(&stream_) != Z_OK) return false;
+
+  const size_t old_size = out->size();
+  const size_t bound = deflateBound(&stream_, len);
+  out->resize(old_size + bound);
+
+  stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  stream_.avail_in = len;
+  stream_.next_out = reinterpret_cast<Bytef*>(&(*out)[old_size]);
+  stream_.avail_out = bound;
+  // deflateBound() guarantees a single Z_FINISH call is enough.
+  if (deflate(&stream_, Z_FINISH) != Z_STREAM_END) {
+    out->resize(old_size);
+    return false;
+  }
+  out->resize(old_size + bound - stream_.avail_out);
+  return true;
+}
+
+static void AppendLittleEndian32(uint32_t n, std::string* out) {
+  for (int i = 0; i < 4; ++i) out->push_back(static_cast<char>(n >> (8 * i)));
+}
+
+void LogCompressor::StoreBlock(const char* data, size_t len,
+                               std::string* out) {
+  // Magic, deflate, no flags, no mtime, no extra flags, Unix.
+  static const char kGzipHeader[] = "\x1f\x8b\x08\0\0\0\0\0\0\x03";
+  out->append(kGzipHeader, sizeof(kGzipHeader) - 1);
+  // Stored blocks hold at most 65535 bytes each; the last one is marked
+  // final, even if it is empty.
+  static const size_t kMaxStoredBlock = 65535;
+  size_t done = 0;
+  do {
+    const size_t n = len - done < kMaxStoredBlock ? len - done
+                                                  : kMaxStoredBlock;
+    out->push_back(done + n == len ? 1 : 0);  // BFINAL, BTYPE 00
+    out->push_back(static_cast<char>(n));
+    out->push_back(static_cast<char>(n >> 8));
+    out->push_back(static_cast<char>(~n));
+    out->push_back(static_cast<char>(~n >> 8));
+    out->append(data + done, n);
+    done += n;
+  } while (done < len);
+  AppendLittleEndian32(
+      crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef*>(data), len),
+      out);
+  AppendLittleEndian32(static_cast<uint32_t>(len), out);
+}
+
+_END_GOOGLE_NAMESPACE_
@@ -0,0 +1,50 @@
+/*
+ * LogCompressor.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#ifndef LOGCOMPRESSOR_H_
+#define LOGCOMPRESSOR_H_
+
+#include <stddef.h>
+#include <string>
+#include <zlib.h>
+#include "config.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// Compresses the active log file in independent blocks (--log_compress).
+//
+// Every block is a complete gzip member, so a compressed log file is an
+// ordinary multi-member .gz file: zcat can read it, a tail-style reader
+// can decode each block as soon as it has been written, and after a
+// crash everything up to the last complete block can be recovered.
+// The z_stream is reused between blocks to avoid reallocating its state.
+class LogCompressor {
+public:
+  LogCompressor();
+  ~LogCompressor();
+
+  // Append "len" bytes of "data", compressed as one self-contained gzip
+  // member, to "*out".  Returns false if zlib fails.
+  bool CompressBlock(const char* data, size_t len, std::string* out);
+
+  // Append "len" bytes of "data" to "*out" as a gzip member of stored
+  // (uncompressed) deflate blocks, for when CompressBlock() fails.  Needs
+  // no zlib state, so it can't fail itself.
+  static void StoreBlock(const char* data, size_t len, std::string* out);
+
+private:
+  z_stream stream_;
+  bool initialized_;
+
+  // Disallow
+  LogCompressor(const LogCompressor&);
+  void operator=(const LogCompressor&);
+};
+
+_END_GOOGLE_NAMESPACE_
+
+#endif /* LOGCOMPRESSOR_H_ */
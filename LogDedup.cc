@@ -0,0 +1,167 @@
+/*
+ * LogDedup.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#include "LogDedup.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "LogMessage.h"
+
+_START_GOOGLE_NAMESPACE_
+
+namespace {
+
+struct Slot {
+  int lock;
+  const char* file;       // call site owning the slot, NULL if none
+  int line;
+  LogSeverity severity;
+  uint64 hash;            // of the last message logged from the site
+  int64 logged_time;      // when it was logged
+  int64 last_repeat_time;
+  int64 repeats;          // suppressed since it was logged
+};
+
+// Repeats taken out of a slot, to be logged once it is unlocked.
+struct Pending {
+  const char* file;
+  int line;
+  LogSeverity severity;
+  int64 span_ns;
+  int64 repeats;
+};
+
+Slot slots[LogDedup::kNumSlots];
+
+// When to next look for repeats whose window is over.
+int64 next_sweep = 0;
+
+// Set while a summary is logged, so that it is never suppressed itself.
+__thread bool logging_summary = false;
+
+pthread_once_t atexit_once = PTHREAD_ONCE_INIT;
+
+void LockSlot(Slot* slot) {
+  while (__atomic_test_and_set(&slot->lock, __ATOMIC_ACQUIRE)) sched_yield();
+}
+
+void UnlockSlot(Slot* slot) {
+  __atomic_clear(&slot->lock, __ATOMIC_RELEASE);
+}
+
+// Take the pending repeats out of a locked slot, if its window ended
+// before "end".
+bool TakePending(Slot* slot, int64 end, Pending* pending) {
+  if (slot->repeats == 0 || slot->logged_time >= end) return false;
+  pending->file = slot->file;
+  pending->line = slot->line;
+  pending->severity = slot->severity;
+  pending->span_ns = slot->last_repeat_time - slot->logged_time;
+  pending->repeats = slot->repeats;
+  slot->repeats = 0;
+  return true;
+}
+
+void LogPending(const Pending& pending) {
+  char span[32];
+  snprintf(span, sizeof(span), "%.3fs", pending.span_ns / 1e9);
+  logging_summary = true;
+  LogMessage(pending.file, pending.line, pending.severity).stream()
+      << "Last message repeated " << pending.repeats << " times over "
+      << span;
+  logging_summary = false;
+}
+
+// FNV-1a.
+uint64 HashBody(const char* body, size_t len) {
+  uint64 hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= static_cast<unsigned char>(body[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+size_t SiteIndex(const char* file, int line) {
+  uint64 h = reinterpret_cast<uintptr_t>(file) ^
+             (static_cast<uint64>(line) * 0x9e3779b97f4a7c15ULL);
+  h ^= h >> 29;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 32;
+  return h % LogDedup::kNumSlots;
+}
+
+// Log the repeats of all the slots whose window ended before "end".
+void LogPendingBefore(int64 end) {
+  for (int i = 0; i < LogDedup::kNumSlots; ++i) {
+    Slot* slot = &slots[i];
+    Pending pending;
+    LockSlot(slot);
+    const bool has_pending = TakePending(slot, end, &pending);
+    UnlockSlot(slot);
+    if (has_pending) LogPending(pending);
+  }
+}
+
+void FlushAtExit() {
+  LogDedup::FlushAll();
+}
+
+void RegisterFlushAtExit() {
+  atexit(&FlushAtExit);
+}
+
+}  // namespace
+
+bool LogDedup::Admit(const char* file, int line, LogSeverity severity,
+                     const char* body, size_t len) {
+  if (!enabled() || logging_summary || severity >= GLOG_FATAL) return true;
+  pthread_once(&atexit_once, &RegisterFlushAtExit);
+
+  const int64 now = LogEveryTNowNanos();
+  const int64 window = static_cast<int64>(FLAGS_log_dedup_window_ms) * 1000000;
+  const uint64 hash = HashBody(body, len);
+  Slot* slot = &slots[SiteIndex(file, line)];
+  Pending pending;
+
+  LockSlot(slot);
+  if (slot->file == file && slot->line == line &&
+      slot->severity == severity && slot->hash == hash &&
+      now - slot->logged_time < window) {
+    ++slot->repeats;
+    slot->last_repeat_time = now;
+    UnlockSlot(slot);
+    return false;
+  }
+  const bool has_pending = TakePending(slot, INT64_MAX, &pending);
+  slot->file = file;
+  slot->line = line;
+  slot->severity = severity;
+  slot->hash = hash;
+  slot->logged_time = now;
+  UnlockSlot(slot);
+
+  if (has_pending) LogPending(pending);
+
+  // Once per window, one thread logs the repeats of sites that have gone
+  // quiet since.
+  int64 sweep = __atomic_load_n(&next_sweep, __ATOMIC_RELAXED);
+  if (now >= sweep &&
+      __atomic_compare_exchange_n(&next_sweep, &sweep, now + window, false,
+                                  __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    LogPendingBefore(now - window);
+  }
+  return true;
+}
+
+void LogDedup::FlushAll() {
+  LogPendingBefore(INT64_MAX);
+}
+
+_END_GOOGLE_NAMESPACE_
@@ -0,0 +1,51 @@
+/*
+ * LogDedup.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#ifndef LOGDEDUP_H_
+#define LOGDEDUP_H_
+
+#include <stddef.h>
+#include "logging.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// Coalesces repeated messages from one call site (--log_dedup_window_ms).
+//
+// An error storm typically logs the very same line from the same LOG()
+// statement thousands of times per second.  Each call site hashes into a
+// slot that remembers the last message it logged.  A message whose text
+// (the part after the prefix) and severity match it, within the window
+// after it was logged, is suppressed and only counted.  The next message
+// that does get logged from that site -- a different one, or the same one
+// once the window is over -- is preceded by
+//
+//   Last message repeated 1234 times over 0.998s
+//
+// logged from the same file and line.  If the site goes quiet instead,
+// the count is logged along with some other message once the window is
+// over, or at exit.
+//
+// Slots are locked individually, so threads logging from different sites
+// don't contend.  FATAL messages are never suppressed.
+class LogDedup {
+public:
+  static const int kNumSlots = 1024;
+
+  static bool enabled() { return FLAGS_log_dedup_window_ms > 0; }
+
+  // Should the message "body[0,len-1]" logged at "file:line" be logged,
+  // or is it a repeat?  "file" is compared by address.
+  static bool Admit(const char* file, int line, LogSeverity severity,
+                    const char* body, size_t len);
+
+  // Log the counts of all pending repeats.
+  static void FlushAll();
+};
+
+_END_GOOGLE_NAMESPACE_
+
+#endif /* LOGDEDUP_H_ */
@@ -8,6 +8,9 @@
 #include <assert.h>
 #include "LogDestination.h"
 #include "LogSink.h"
+#include "EmailNotifier.h"
+#include "AsyncStderrWriter.h"
+#include "LogStats.h"
 
 _START_GOOGLE_NAMESPACE_
 
@@ -64,6 +67,18 @@ void LogDestination::MaybeLogToStderr(const LogSeverity severity,
                                              const char* message,
                                              const size_t len) {
   if ((severity >= FLAGS_stderrthreshold) || FLAGS_alsologtostderr) {
+    LogToStderr(severity, message, len);
+  }
+}
+
+void LogDestination::LogToStderr(LogSeverity severity,
+                                 const char* message,
+                                 size_t len) {
+  AsyncStderrWriter* writer =
+      FLAGS_log_async_stderr ? AsyncStderrWriter::Get() : NULL;
+  if (writer != NULL) {
+    writer->Write(severity, message, len);
+  } else {
     WriteToStderr(message, len);
   }
 }
@@ -129,24 +144,36 @@ void LogDestination::MaybeLogToEmail(const LogSeverity severity,
       }
       to += addresses_;
     }
-    const string subject(string("[LOG] ") + LogSeverityNames[severity] + ": " +
-                         glog_internal_namespace_::ProgramInvocationShortName());
-    string body(hostname());
-    body += "\n\n";
-    body.append(message, len);
-
-    // should NOT use SendEmail().  The caller of this function holds the
-    // log_mutex and SendEmail() calls LOG/VLOG which will block trying to
-    // acquire the log_mutex object.  Use SendEmailInternal() and set
-    // use_logging to false.
-    SendEmailInternal(to.c_str(), subject.c_str(), body.c_str(), false);
+    // The caller holds log_mutex, so don't wait for the mailer here:
+    // the notifier thread sends the message, coalesced with any others
+    // of the same burst.
+    EmailNotifier* notifier = to.empty() ? NULL : EmailNotifier::Get();
+    if (notifier != NULL) notifier->Enqueue(severity, to, message, len);
+  }
+}
+
+void LogDestination::WriteRawToLogfiles(LogSeverity severity,
+                                        const char* message, size_t len) {
+  for (int i = severity; i >= 0; --i) {
+    LogDestination* destination =
+        __atomic_load_n(&log_destinations_[i], __ATOMIC_ACQUIRE);
+    if (destination != NULL) destination->fileobject_.WriteRaw(message, len);
+  }
+}
+
+void LogDestination::FlushLogFilesUnsafe() {
+  for (int i = 0; i < NUM_SEVERITIES; ++i) {
+    LogDestination* destination = log_destinations_[i];
+    if (destination != NULL) destination->fileobject_.FlushUnsafe();
   }
 }
 
 LogDestination* LogDestination::log_destination(LogSeverity severity) {
   assert(severity >=0 && severity < NUM_SEVERITIES);
   if (!log_destinations_[severity]) {
-    log_destinations_[severity] = new LogDestination(severity, NULL);
+    // Published for WriteRawToLogfiles(), which doesn't take log_mutex.
+    __atomic_store_n(&log_destinations_[severity],
+                     new LogDestination(severity, NULL), __ATOMIC_RELEASE);
   }
   return log_destinations_[severity];
 }
@@ -155,11 +182,19 @@ void LogDestination::MaybeLogToLogfile(LogSeverity severity,
                                        time_t timestamp,
                                        const char* message,
                                        size_t len) {
-  const bool should_flush = severity > FLAGS_logbuflevel;
+  const bool should_flush = severity > FLAGS_logbuflevel ||
+                            severity >= FLAGS_logsynclevel;
   LogDestination* destination = log_destination(severity);
   destination->logger_->Write(should_flush, timestamp, message, len);
 }
 
+void LogDestination::MaybeSyncLogfile(LogSeverity severity) {
+  if (severity < FLAGS_logsynclevel || FLAGS_logtostderr) return;
+  // Only sync a file that has been written; don't create one.
+  LogDestination* destination = log_destinations_[severity];
+  if (destination != NULL) destination->fileobject_.Sync();
+}
+
 void LogDestination::LogToAllLogfiles(LogSeverity severity,
                                       time_t timestamp,
                                       const char* message,
@@ -180,11 +215,14 @@ void LogDestination::LogToSinks(LogSeverity severity,
                                 const char* message,
                                 size_t message_len) {
   ReaderMutexLock l(&sink_mutex_);
-  if (sinks_) {
+  if (sinks_ && !sinks_->empty()) {
+    const int64 start = LogStats::enabled() ? MonotonicNanos() : 0;
     for (int i = sinks_->size() - 1; i >= 0; i--) {
       (*sinks_)[i]->send(severity, full_filename, base_filename,
                          line, tm_time, message, message_len);
     }
+    if (start != 0) LogStats::Record(LogStats::kSinkSend,
+                                     MonotonicNanos() - start);
   }
 }
 
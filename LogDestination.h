@@ -29,6 +29,20 @@ public:
   static void AddLogSink(LogSink *destination);
   static void RemoveLogSink(LogSink *destination);
 
+  // Append a RAW_LOG() record to the log files of "severity" and below
+  // that have been opened, without locking or allocating (see
+  // LogFileObject::WriteRaw()).  This reads log_destinations_ without
+  // log_mutex, which is only safe because destinations are never deleted
+  // once published.  Whatever comes to delete them (a shutdown) has to
+  // unpublish them first and wait for the raw writers to drain, the way
+  // LogFileObject::SetRawDescriptor() does for its descriptor.
+  static void WriteRawToLogfiles(LogSeverity severity, const char* message,
+                                 size_t len);
+
+  // Flush the log files without locking or allocating, for the failure
+  // signal handler (see LogFileObject::FlushUnsafe()).
+  static void FlushLogFilesUnsafe();
+
 private:
   LogDestination(LogSeverity severity, const char* base_filename);
   ~LogDestination() { }
@@ -39,6 +53,12 @@ private:
                                const char* message,
                                size_t len);
 
+  // Write a log message to stderr, through the writer thread if
+  // --log_async_stderr is set.
+  static void LogToStderr(LogSeverity severity,
+                          const char* message,
+                          size_t len);
+
   // Take a log message of a particular severity and log it to email
   // if it's of a high enough severity to deserve it.
   static void MaybeLogToEmail(const LogSeverity severity,
@@ -52,6 +72,11 @@ private:
                                 const char* message,
                                 size_t len);
 
+  // Wait until the log file for "severity" is on disk, if messages of
+  // that severity are to be synced (--logsynclevel).  Must be called
+  // without log_mutex held so that concurrent writers can share a sync.
+  static void MaybeSyncLogfile(LogSeverity severity);
+
   // Take a log message of a particular severity and log it to the file
   // for that severity and also for all files with severity less than
   // this severity.
@@ -77,6 +102,7 @@ private:
 
   LogFileObject fileobject_;
   base::Logger* logger_;      // Either &fileobject_, or wrapper around it
+  // Never deleted: see WriteRawToLogfiles().
   static LogDestination* log_destinations_[NUM_SEVERITIES];
   static LogSeverity email_logging_severity_;
   static string addresses_;
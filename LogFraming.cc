@@ -0,0 +1,205 @@
+/*
+ * LogFraming.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#include "LogFraming.h"
+#include <string.h>
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+_START_GOOGLE_NAMESPACE_
+
+// Reflected CRC32C polynomial.
+static const uint32 kCrc32cPoly = 0x82f63b78;
+
+static uint32 crc32c_table[256];
+static bool crc32c_table_ready = false;
+
+static void InitCrc32cTable() {
+  // Racing threads compute the same values, so no lock is needed.
+  for (uint32 i = 0; i < 256; ++i) {
+    uint32 crc = i;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ (kCrc32cPoly & (0 - (crc & 1)));
+    }
+    crc32c_table[i] = crc;
+  }
+  __sync_synchronize();
+  crc32c_table_ready = true;
+}
+
+static uint32 Crc32cSoftware(uint32 crc, const char* data, size_t len) {
+  if (!crc32c_table_ready) InitCrc32cTable();
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < len; ++i) {
+    crc = crc32c_table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+#if defined(__x86_64__)
+// Eight bytes per crc32 instruction; the scanner is bound by memory
+// bandwidth rather than by the checksum.
+__attribute__((target("sse4.2")))
+static uint32 Crc32cHardware(uint32 crc, const char* data, size_t len) {
+  uint64 crc64 = crc;
+  while (len >= 8) {
+    uint64 word;
+    memcpy(&word, data, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+    data += 8;
+    len -= 8;
+  }
+  crc = static_cast<uint32>(crc64);
+  while (len > 0) {
+    crc = _mm_crc32_u8(crc, *data++);
+    --len;
+  }
+  return crc;
+}
+
+static bool HasSse42() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse4.2");
+}
+static const bool has_sse42 = HasSse42();
+#endif
+
+uint32 Crc32c(uint32 crc, const char* data, size_t len) {
+  crc = ~crc;
+#if defined(__x86_64__)
+  if (has_sse42) return ~Crc32cHardware(crc, data, len);
+#endif
+  return ~Crc32cSoftware(crc, data, len);
+}
+
+static uint32 LoadUint32(const char* p) {
+  uint32 value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static uint64 LoadUint64(const char* p) {
+  uint64 value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static uint32 FrameCrc(const char* length_field, const char* payload,
+                       uint32 len) {
+  return Crc32c(Crc32c(0, length_field, sizeof(uint32)), payload, len);
+}
+
+void EncodeLogFrameHeader(const char* payload, uint32 len,
+                          char header[kLogFrameHeaderSize]) {
+  memcpy(header, &len, sizeof(len));
+  const uint32 crc = FrameCrc(header, payload, len);
+  memcpy(header + 4, &crc, sizeof(crc));
+}
+
+void EncodeLogSyncMarker(uint64 offset, char marker[kLogSyncMarkerSize]) {
+  memcpy(marker, &kLogSyncMarkerTag, sizeof(kLogSyncMarkerTag));
+  memcpy(marker + 8, &offset, sizeof(offset));
+  const uint32 crc = Crc32c(0, marker + 8, sizeof(offset));
+  memcpy(marker + 4, &crc, sizeof(crc));
+}
+
+bool IsLogSyncMarker(const char* data, size_t len, size_t pos) {
+  if (len < kLogSyncMarkerSize || pos > len - kLogSyncMarkerSize) {
+    return false;
+  }
+  const char* p = data + pos;
+  return LoadUint32(p) == kLogSyncMarkerTag &&
+         LoadUint64(p + 8) == pos &&
+         LoadUint32(p + 4) == Crc32c(0, p + 8, sizeof(uint64));
+}
+
+size_t ValidLogFrameSize(const char* data, size_t len, size_t pos) {
+  if (len < kLogFrameHeaderSize || pos > len - kLogFrameHeaderSize) {
+    return 0;
+  }
+  const char* p = data + pos;
+  const uint32 length = LoadUint32(p);
+  if (length > kLogMaxFrameLength ||
+      length > len - pos - kLogFrameHeaderSize) {
+    return 0;
+  }
+  if (LoadUint32(p + 4) != FrameCrc(p, p + kLogFrameHeaderSize, length)) {
+    return 0;
+  }
+  return kLogFrameHeaderSize + length;
+}
+
+// Position of the first valid sync marker at or after "pos", or "len".
+static size_t NextLogSyncMarker(const char* data, size_t len, size_t pos) {
+  while (pos < len) {
+    const void* p = memchr(data + pos, 0xff, len - pos);
+    if (p == NULL) break;
+    pos = static_cast<const char*>(p) - data;
+    if (IsLogSyncMarker(data, len, pos)) return pos;
+    ++pos;
+  }
+  return len;
+}
+
+LogFrameReader::LogFrameReader(const char* data, size_t len)
+  : data_(data), len_(len), pos_(0), end_of_record_(0),
+    skipped_bytes_(0), corrupt_regions_(0) {
+}
+
+bool LogFrameReader::Next(const char** payload, uint32* len) {
+  while (pos_ < len_) {
+    if (IsLogSyncMarker(data_, len_, pos_)) {
+      pos_ += kLogSyncMarkerSize;
+      continue;
+    }
+    const size_t size = ValidLogFrameSize(data_, len_, pos_);
+    if (size > 0) {
+      *payload = data_ + pos_ + kLogFrameHeaderSize;
+      *len = size - kLogFrameHeaderSize;
+      pos_ += size;
+      end_of_record_ = pos_;
+      return true;
+    }
+    // Torn or corrupt: nothing before the next sync marker can be
+    // trusted to start a record.
+    const size_t next = NextLogSyncMarker(data_, len_, pos_ + 1);
+    skipped_bytes_ += next - pos_;
+    ++corrupt_regions_;
+    pos_ = next;
+  }
+  return false;
+}
+
+uint64 FindLogFrameEnd(const char* data, size_t len) {
+  // Find the last valid sync marker, searching backwards.
+  size_t pos = 0;
+  size_t limit = len;
+  while (limit > 0) {
+    const void* p = memrchr(data, 0xff, limit);
+    if (p == NULL) break;
+    const size_t candidate = static_cast<const char*>(p) - data;
+    if (IsLogSyncMarker(data, len, candidate)) {
+      pos = candidate;
+      break;
+    }
+    limit = candidate;
+  }
+  // Then walk the records after it for as long as they are valid.
+  while (pos < len) {
+    if (IsLogSyncMarker(data, len, pos)) {
+      pos += kLogSyncMarkerSize;
+      continue;
+    }
+    const size_t size = ValidLogFrameSize(data, len, pos);
+    if (size == 0) break;
+    pos += size;
+  }
+  return pos;
+}
+
+_END_GOOGLE_NAMESPACE_
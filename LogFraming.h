@@ -0,0 +1,97 @@
+/*
+ * LogFraming.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#ifndef LOGFRAMING_H_
+#define LOGFRAMING_H_
+
+#include <stddef.h>
+#include "config.h"
+#include "basic_type.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// Framed log files (--log_framing).
+//
+// Every Write() to the log file becomes one record:
+//
+//   uint32 length      payload bytes
+//   uint32 crc         CRC32C of the length field and the payload
+//   char   payload[length]
+//
+// and at least every kLogSyncInterval bytes a 16 byte sync marker is
+// inserted between two records:
+//
+//   uint32 0xffffffff  can't be a length (and 0xff never occurs in text)
+//   uint32 crc         CRC32C of the offset field
+//   uint64 offset      the position of the marker itself in the file
+//
+// All fields are in native (little endian) byte order.  A framed file
+// starts with a sync marker.  Readers can tell a torn last record from a
+// good one, and after corruption resume at the next sync marker instead
+// of guessing where the next line starts.  With --log_compress the
+// framing applies to the uncompressed data.
+
+static const uint32 kLogFrameHeaderSize = 8;
+static const uint32 kLogSyncMarkerSize = 16;
+static const uint32 kLogSyncMarkerTag = 0xffffffff;
+static const uint32 kLogSyncInterval = 64 * 1024;
+// Longer "records" are taken as garbage without computing their CRC.
+static const uint32 kLogMaxFrameLength = 64 << 20;
+
+// CRC32C (Castagnoli) of "data", continuing from "crc" (0 to start).
+// Uses the SSE4.2 crc32 instruction when the CPU has it.
+uint32 Crc32c(uint32 crc, const char* data, size_t len);
+
+// Fill in the header of a record holding "payload[0,len-1]".
+void EncodeLogFrameHeader(const char* payload, uint32 len,
+                          char header[kLogFrameHeaderSize]);
+
+// Fill in a sync marker that will be written at "offset".
+void EncodeLogSyncMarker(uint64 offset, char marker[kLogSyncMarkerSize]);
+
+// Walks the records of a framed log held in memory (typically mmapped).
+// Corrupt regions are skipped up to the next valid sync marker.
+class LogFrameReader {
+public:
+  LogFrameReader(const char* data, size_t len);
+
+  // Returns the next valid record, or false at the end of the data.
+  bool Next(const char** payload, uint32* len);
+
+  // Offset of the first byte after the last record returned.
+  uint64 offset() const { return end_of_record_; }
+
+  // Bytes skipped so far because they didn't form valid records.
+  uint64 skipped_bytes() const { return skipped_bytes_; }
+
+  // Number of separate corrupt regions skipped so far.
+  uint64 corrupt_regions() const { return corrupt_regions_; }
+
+private:
+  const char* const data_;
+  const size_t len_;
+  size_t pos_;
+  uint64 end_of_record_;
+  uint64 skipped_bytes_;
+  uint64 corrupt_regions_;
+};
+
+// Length of the valid prefix of a framed log of "len" bytes: everything
+// up to the end of the last good record.  Only the data after the last
+// valid sync marker is checked, so this is cheap even for huge files.
+uint64 FindLogFrameEnd(const char* data, size_t len);
+
+// Is there a valid sync marker at "data[pos]"?
+bool IsLogSyncMarker(const char* data, size_t len, size_t pos);
+
+// If "data[pos]" holds a complete valid record, return its total size
+// (header included), else 0.
+size_t ValidLogFrameSize(const char* data, size_t len, size_t pos);
+
+_END_GOOGLE_NAMESPACE_
+
+#endif /* LOGFRAMING_H_ */
@@ -0,0 +1,113 @@
+/*
+ * LogGovernor.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#include "LogGovernor.h"
+#include "LogMessage.h"
+
+_START_GOOGLE_NAMESPACE_
+
+static const int64 kWindowNanos = 1000000000LL;
+static const int64 kSummaryIntervalNanos = 10 * kWindowNanos;
+// At the sampling levels, 1 message in this many gets through.
+static const uint32 kSampleRate = 10;
+
+// All state is updated with relaxed atomics: the governor only needs
+// approximate numbers, and must not add a lock to the logging path.
+static int64 window_start = 0;
+static int64 window_bytes = 0;         // logged in this window
+static int64 window_offered = 0;       // logged or suppressed in this window
+static int64 window_wait_ns = 0;       // waited for log_mutex in this window
+static int shedding_level = 0;
+static uint32 sample_counter[GLOG_ERROR];
+static int64 suppressed[GLOG_ERROR];   // since the last summary
+static int64 next_summary = 0;
+
+// Set while the governor logs its own summary, which must get through.
+static __thread bool logging_summary = false;
+
+int LogGovernor::level() {
+  return __atomic_load_n(&shedding_level, __ATOMIC_RELAXED);
+}
+
+void LogGovernor::MaybeEndWindow(int64 now) {
+  int64 start = __atomic_load_n(&window_start, __ATOMIC_RELAXED);
+  if (now - start < kWindowNanos) return;
+  // One thread ends the window; the others carry on.
+  if (!__atomic_compare_exchange_n(&window_start, &start, now, false,
+                                   __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    return;
+  }
+  const double elapsed = static_cast<double>(now - start) / kWindowNanos;
+  const double bytes =
+      __atomic_exchange_n(&window_bytes, 0, __ATOMIC_RELAXED) / elapsed;
+  const double offered =
+      __atomic_exchange_n(&window_offered, 0, __ATOMIC_RELAXED) / elapsed;
+  const double wait_ms =
+      __atomic_exchange_n(&window_wait_ns, 0, __ATOMIC_RELAXED) / 1e6 /
+      elapsed;
+  if (start == 0) return;  // first call: no complete window yet
+
+  const double byte_budget = FLAGS_log_budget_bytes_per_sec;
+  const double wait_budget = FLAGS_log_budget_lock_wait_ms_per_sec;
+  const bool over = (byte_budget > 0 && bytes > byte_budget) ||
+                    (wait_budget > 0 && wait_ms > wait_budget);
+  const bool calm = (byte_budget <= 0 || offered < byte_budget / 2) &&
+                    (wait_budget <= 0 || wait_ms < wait_budget / 2);
+  int level = LogGovernor::level();
+  if (over) {
+    if (level < LogGovernor::kMaxLevel) ++level;
+  } else if (calm && level > 0) {
+    --level;
+  }
+  __atomic_store_n(&shedding_level, level, __ATOMIC_RELAXED);
+
+  if (now < next_summary) return;
+  const int64 infos = __atomic_exchange_n(&suppressed[GLOG_INFO], 0,
+                                          __ATOMIC_RELAXED);
+  const int64 warnings = __atomic_exchange_n(&suppressed[GLOG_WARNING], 0,
+                                             __ATOMIC_RELAXED);
+  if (infos == 0 && warnings == 0) return;
+  next_summary = now + kSummaryIntervalNanos;
+  logging_summary = true;
+  LogMessage(__FILE__, __LINE__, GLOG_WARNING).stream()
+      << "Logging is over budget: suppressed " << infos << " INFO and "
+      << warnings << " WARNING messages (shedding level " << level << ")";
+  logging_summary = false;
+}
+
+bool LogGovernor::Admit(LogSeverity severity, size_t len) {
+  if (!enabled() || logging_summary) return true;
+  return Admit(severity, len, LogEveryTNowNanos());
+}
+
+bool LogGovernor::Admit(LogSeverity severity, size_t len, int64 now) {
+  if (!enabled() || logging_summary) return true;
+  MaybeEndWindow(now);
+  __atomic_add_fetch(&window_offered, len, __ATOMIC_RELAXED);
+  if (severity >= GLOG_ERROR) return true;
+
+  const int level = LogGovernor::level();
+  // The level at which this severity starts being sampled.
+  const int first_level = severity == GLOG_INFO ? 1 : 3;
+  if (level < first_level) return true;
+  if (level == first_level &&
+      __atomic_fetch_add(&sample_counter[severity], 1, __ATOMIC_RELAXED) %
+          kSampleRate == 0) {
+    return true;
+  }
+  __atomic_add_fetch(&suppressed[severity], 1, __ATOMIC_RELAXED);
+  return false;
+}
+
+void LogGovernor::Account(size_t len, int64 wait_ns) {
+  __atomic_add_fetch(&window_bytes, len, __ATOMIC_RELAXED);
+  if (wait_ns > 0) {
+    __atomic_add_fetch(&window_wait_ns, wait_ns, __ATOMIC_RELAXED);
+  }
+}
+
+_END_GOOGLE_NAMESPACE_
@@ -0,0 +1,64 @@
+/*
+ * LogGovernor.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#ifndef LOGGOVERNOR_H_
+#define LOGGOVERNOR_H_
+
+#include <stddef.h>
+#include "logging.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// Sheds low-severity logging when logging itself becomes a load
+// (--log_budget_bytes_per_sec, --log_budget_lock_wait_ms_per_sec).
+//
+// Overload makes services log more (timeouts, retries) exactly when CPU
+// and disk are scarce.  The governor measures, over one second windows,
+// the bytes logged and the time callers spent waiting for log_mutex.
+// Each window over budget raises the shedding level by one:
+//
+//   0  log everything
+//   1  log 1 in 10 INFO messages
+//   2  drop INFO
+//   3  drop INFO, log 1 in 10 WARNING messages
+//   4  drop INFO and WARNING
+//
+// and each window in which the load offered (suppressed messages
+// included) is under half the budget lowers it by one.  ERROR and FATAL
+// are never affected.  While messages are being suppressed, a WARNING
+// summary of how many were is logged every 10 seconds.
+class LogGovernor {
+public:
+  static const int kMaxLevel = 4;
+
+  static bool enabled() {
+    return FLAGS_log_budget_bytes_per_sec > 0 ||
+           FLAGS_log_budget_lock_wait_ms_per_sec > 0;
+  }
+
+  // Should a message of "severity" and "len" bytes be logged?
+  static bool Admit(LogSeverity severity, size_t len);
+
+  // The same, at "now" on the LogEveryTNowNanos() clock.  Lets tests
+  // drive the windows.
+  static bool Admit(LogSeverity severity, size_t len, int64 now);
+
+  // Account for a message of "len" bytes that was logged after waiting
+  // "wait_ns" for log_mutex.
+  static void Account(size_t len, int64 wait_ns);
+
+  // The current shedding level.
+  static int level();
+
+private:
+  // Start a new window if the current one is over, and adjust the level.
+  static void MaybeEndWindow(int64 now);
+};
+
+_END_GOOGLE_NAMESPACE_
+
+#endif /* LOGGOVERNOR_H_ */
@@ -0,0 +1,430 @@
+/*
+ * LogIndex.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#include "LogIndex.h"
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include <algorithm>
+#include "LogFraming.h"
+
+using std::string;
+using std::vector;
+
+_START_GOOGLE_NAMESPACE_
+
+static void StartInterval(LogIndexEntry* entry, uint64 offset,
+                          time_t timestamp) {
+  memset(entry, 0, sizeof(*entry));
+  entry->offset = offset;
+  entry->first_time = entry->last_time = timestamp;
+}
+
+LogIndexWriter::LogIndexWriter()
+  : file_(NULL), interval_bytes_(0), in_interval_(false) {
+}
+
+LogIndexWriter::~LogIndexWriter() {
+  Close();
+}
+
+bool LogIndexWriter::Open(const string& index_filename,
+                          uint32 interval_bytes) {
+  file_ = fopen(index_filename.c_str(), "w");
+  if (file_ == NULL) return false;
+  interval_bytes_ = interval_bytes;
+  in_interval_ = false;
+  fwrite(kLogIndexMagic, 1, sizeof(kLogIndexMagic), file_);
+  return true;
+}
+
+void LogIndexWriter::AddLine(uint64 offset, time_t timestamp,
+                             LogSeverity severity) {
+  if (file_ == NULL) return;
+  if (!in_interval_) {
+    StartInterval(&current_, offset, timestamp);
+    in_interval_ = true;
+  }
+  if (timestamp > current_.last_time) current_.last_time = timestamp;
+  ++current_.counts[severity];
+}
+
+void LogIndexWriter::EndInterval() {
+  fwrite(&current_, sizeof(current_), 1, file_);
+  in_interval_ = false;
+}
+
+void LogIndexWriter::Flush() {
+  if (file_ != NULL) fflush(file_);
+}
+
+void LogIndexWriter::Close() {
+  if (file_ == NULL) return;
+  if (in_interval_) EndInterval();
+  fclose(file_);
+  file_ = NULL;
+}
+
+LogSeverity LogLineSeverity(const char* line, size_t len,
+                            LogSeverity default_severity) {
+  if (len > 0) {
+    for (int i = 0; i < NUM_SEVERITIES; ++i) {
+      if (line[0] == LogSeverityNames[i][0]) return i;
+    }
+  }
+  return default_severity;
+}
+
+bool ReadLogIndex(const string& index_filename,
+                  vector<LogIndexEntry>* entries) {
+  entries->clear();
+  FILE* file = fopen(index_filename.c_str(), "r");
+  if (file == NULL) return false;
+  char magic[sizeof(kLogIndexMagic)];
+  bool ok = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+            memcmp(magic, kLogIndexMagic, sizeof(magic)) == 0;
+  LogIndexEntry entry;
+  while (ok && fread(&entry, sizeof(entry), 1, file) == 1) {
+    entries->push_back(entry);
+  }
+  fclose(file);
+  return ok;
+}
+
+bool WriteLogIndex(const string& index_filename,
+                   const vector<LogIndexEntry>& entries) {
+  FILE* file = fopen(index_filename.c_str(), "w");
+  if (file == NULL) return false;
+  bool ok = fwrite(kLogIndexMagic, 1, sizeof(kLogIndexMagic), file) ==
+            sizeof(kLogIndexMagic);
+  if (ok && !entries.empty()) {
+    ok = fwrite(&entries[0], sizeof(entries[0]), entries.size(), file) ==
+         entries.size();
+  }
+  return fclose(file) == 0 && ok;
+}
+
+size_t FindLogIndexEntry(const vector<LogIndexEntry>& entries, int64 t) {
+  // Intervals are in file order, so their end times are sorted.
+  size_t lo = 0, hi = entries.size();
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (entries[mid].last_time < t) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+namespace {
+
+static bool IsDigits(const char* p, int n) {
+  for (int i = 0; i < n; ++i) {
+    if (p[i] < '0' || p[i] > '9') return false;
+  }
+  return true;
+}
+
+static int TwoDigits(const char* p) {
+  return (p[0] - '0') * 10 + (p[1] - '0');
+}
+
+// Rebuilds index entries from the lines of a log file, the same way
+// LogIndexWriter builds them while the log is written.
+class IndexBuilder {
+public:
+  IndexBuilder(uint32 interval_bytes, vector<LogIndexEntry>* entries)
+    : interval_bytes_(interval_bytes), entries_(entries),
+      in_interval_(false), year_(1970), month_(0), last_time_(0) {
+    entries_->clear();
+  }
+
+  // A complete line (without '\n') that can be found by seeking to
+  // "offset".
+  void Line(uint64 offset, const char* line, size_t len) {
+    static const char kHeader[] = "Log file created at: ";
+    const size_t header_len = sizeof(kHeader) - 1;
+    if (len >= header_len + 19 &&
+        memcmp(line, kHeader, header_len) == 0) {
+      // "Log file created at: yyyy/mm/dd hh:mm:ss"
+      const char* p = line + header_len;
+      if (IsDigits(p, 4)) {
+        year_ = (p[0] - '0') * 1000 + (p[1] - '0') * 100 + TwoDigits(p + 2);
+        month_ = TwoDigits(p + 5);
+      }
+      return;
+    }
+    // "Immdd hh:mm:ss.uuuuuu ..."
+    if (len < 15 || !IsDigits(line + 1, 4) || line[5] != ' ' ||
+        !IsDigits(line + 6, 2) || line[8] != ':' ||
+        !IsDigits(line + 9, 2) || line[11] != ':' ||
+        !IsDigits(line + 12, 2)) {
+      return;  // Continuation of a multi-line message, or no prefix.
+    }
+    const LogSeverity severity = LogLineSeverity(line, len, -1);
+    if (severity < 0) return;
+
+    struct tm tm_time;
+    memset(&tm_time, 0, sizeof(tm_time));
+    const int month = TwoDigits(line + 1);
+    if (month < month_) ++year_;  // The log went past new year's eve.
+    month_ = month;
+    tm_time.tm_year = year_ - 1900;
+    tm_time.tm_mon = month - 1;
+    tm_time.tm_mday = TwoDigits(line + 3);
+    tm_time.tm_hour = TwoDigits(line + 6);
+    tm_time.tm_min = TwoDigits(line + 9);
+    tm_time.tm_sec = TwoDigits(line + 12);
+    tm_time.tm_isdst = -1;
+    last_time_ = mktime(&tm_time);
+
+    if (!in_interval_) {
+      StartInterval(&current_, offset, last_time_);
+      in_interval_ = true;
+    }
+    if (last_time_ > current_.last_time) current_.last_time = last_time_;
+    ++current_.counts[severity];
+  }
+
+  void MaybeEndInterval(uint64 file_length) {
+    if (in_interval_ && file_length - current_.offset >= interval_bytes_) {
+      Finish();
+    }
+  }
+
+  void Finish() {
+    if (in_interval_) entries_->push_back(current_);
+    in_interval_ = false;
+  }
+
+private:
+  const uint32 interval_bytes_;
+  vector<LogIndexEntry>* const entries_;
+  bool in_interval_;
+  LogIndexEntry current_;
+  int year_;
+  int month_;
+  time_t last_time_;
+};
+
+// Feed the lines of "data" to "builder".  Lines are reported as found at
+// "seek_offset" if it isn't -1, else at their own offset.  Whatever
+// follows the last '\n' is left in "*partial".
+static void SplitLines(const char* data, size_t len, uint64 data_offset,
+                       int64 seek_offset, string* partial,
+                       uint64* partial_offset, IndexBuilder* builder) {
+  const char* end = data + len;
+  while (data < end) {
+    const char* eol = static_cast<const char*>(memchr(data, '\n', end - data));
+    if (eol == NULL) {
+      if (partial->empty()) {
+        *partial_offset = seek_offset >= 0 ? seek_offset : data_offset;
+      }
+      partial->append(data, end - data);
+      return;
+    }
+    const uint64 line_offset = seek_offset >= 0 ? seek_offset : data_offset;
+    if (!partial->empty()) {
+      partial->append(data, eol - data);
+      builder->Line(*partial_offset, partial->data(), partial->size());
+      partial->clear();
+    } else {
+      builder->Line(line_offset, data, eol - data);
+    }
+    data_offset += eol + 1 - data;
+    data = eol + 1;
+    if (seek_offset < 0) builder->MaybeEndInterval(data_offset);
+  }
+}
+
+// Does "file" hold a framed log (--log_framing), compressed or not?  It
+// then starts with a sync marker.
+static bool IsFramedLog(FILE* file) {
+  unsigned char in[4096];
+  char out[kLogSyncMarkerSize];
+  const size_t n = fread(in, 1, sizeof(in), file);
+  rewind(file);
+  if (n < 2 || in[0] != 0x1f || in[1] != 0x8b) {
+    return IsLogSyncMarker(reinterpret_cast<char*>(in), n, 0);
+  }
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (inflateInit2(&stream, 15 + 32) != Z_OK) return false;
+  stream.next_in = in;
+  stream.avail_in = n;
+  stream.next_out = reinterpret_cast<Bytef*>(out);
+  stream.avail_out = sizeof(out);
+  inflate(&stream, Z_NO_FLUSH);
+  inflateEnd(&stream);
+  return IsLogSyncMarker(out, sizeof(out) - stream.avail_out, 0);
+}
+
+// Decompress the complete gzip members of "file" into "*out".  Member i
+// starts at "(*block_offsets)[i]" in the file and "(*block_starts)[i]"
+// in "*out".
+static void InflateBlocks(FILE* file, string* out,
+                          vector<uint64>* block_offsets,
+                          vector<uint64>* block_starts) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (inflateInit2(&stream, 15 + 32) != Z_OK) return;
+  unsigned char in[64 * 1024];
+  char buf[256 * 1024];
+  uint64 offset = 0;
+  bool ok = true;
+  block_offsets->push_back(0);
+  block_starts->push_back(0);
+  size_t n;
+  while (ok && (n = fread(in, 1, sizeof(in), file)) > 0) {
+    stream.next_in = in;
+    stream.avail_in = n;
+    while (ok && stream.avail_in > 0) {
+      stream.next_out = reinterpret_cast<Bytef*>(buf);
+      stream.avail_out = sizeof(buf);
+      const size_t before = stream.avail_in;
+      int ret = inflate(&stream, Z_NO_FLUSH);
+      offset += before - stream.avail_in;
+      out->append(buf, sizeof(buf) - stream.avail_out);
+      if (ret == Z_STREAM_END) {
+        inflateReset(&stream);
+        block_offsets->push_back(offset);
+        block_starts->push_back(out->size());
+      } else if (ret == Z_BUF_ERROR) {
+        break;
+      } else if (ret != Z_OK) {
+        ok = false;  // Keep what we have up to the corrupt block.
+      }
+    }
+  }
+  inflateEnd(&stream);
+}
+
+// Feed the lines of the records of a framed log to "builder".  Like
+// LogIndexWriter, a record is found where the record before it ends:
+// at the sync marker in between, if there is one.  Offsets into
+// compressed logs are those of the gzip block that contains that point.
+static bool IndexFramedLog(FILE* file, IndexBuilder* builder) {
+  struct stat st;
+  if (fstat(fileno(file), &st) != 0) return false;
+  if (st.st_size == 0) return true;
+  unsigned char magic[2];
+  const bool compressed = fread(magic, 1, 2, file) == 2 &&
+                          magic[0] == 0x1f && magic[1] == 0x8b;
+  rewind(file);
+
+  string inflated;
+  vector<uint64> block_offsets, block_starts;
+  const char* data;
+  size_t len;
+  void* mapped = MAP_FAILED;
+  if (compressed) {
+    InflateBlocks(file, &inflated, &block_offsets, &block_starts);
+    data = inflated.data();
+    len = inflated.size();
+  } else {
+    mapped = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+    if (mapped == MAP_FAILED) return false;
+    data = static_cast<const char*>(mapped);
+    len = st.st_size;
+  }
+
+  LogFrameReader reader(data, len);
+  const char* payload;
+  uint32 payload_len;
+  uint64 record_offset = 0;     // in the file
+  string partial;
+  uint64 partial_offset = 0;
+  while (reader.Next(&payload, &payload_len)) {
+    SplitLines(payload, payload_len, 0, record_offset, &partial,
+               &partial_offset, builder);
+    if (!partial.empty()) {     // The record didn't end with '\n'.
+      builder->Line(partial_offset, partial.data(), partial.size());
+      partial.clear();
+    }
+    record_offset = reader.offset();
+    if (compressed) {
+      const size_t block = std::upper_bound(block_starts.begin(),
+                                            block_starts.end(),
+                                            record_offset) -
+                           block_starts.begin() - 1;
+      record_offset = block_offsets[block];
+    }
+    builder->MaybeEndInterval(record_offset);
+  }
+  if (mapped != MAP_FAILED) munmap(mapped, st.st_size);
+  return true;
+}
+
+}  // namespace
+
+bool BuildLogIndex(const string& log_filename, uint32 interval_bytes,
+                   vector<LogIndexEntry>* entries) {
+  FILE* file = fopen(log_filename.c_str(), "rb");
+  if (file == NULL) return false;
+
+  IndexBuilder builder(interval_bytes, entries);
+  if (IsFramedLog(file)) {
+    const bool framed_ok = IndexFramedLog(file, &builder);
+    fclose(file);
+    builder.Finish();
+    return framed_ok;
+  }
+  unsigned char in[64 * 1024];
+  unsigned char out[256 * 1024];
+  string partial;
+  uint64 partial_offset = 0;
+  uint64 offset = 0;            // bytes of the file consumed so far
+  bool first = true, compressed = false, ok = true;
+
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  uint64 block_start = 0;       // offset of the current gzip block
+  size_t n;
+  while (ok && (n = fread(in, 1, sizeof(in), file)) > 0) {
+    if (first) {
+      compressed = n >= 2 && in[0] == 0x1f && in[1] == 0x8b;
+      if (compressed && inflateInit2(&stream, 15 + 32) != Z_OK) ok = false;
+      first = false;
+    }
+    if (!compressed) {
+      SplitLines(reinterpret_cast<char*>(in), n, offset, -1,
+                 &partial, &partial_offset, &builder);
+      offset += n;
+      continue;
+    }
+    stream.next_in = in;
+    stream.avail_in = n;
+    while (ok && stream.avail_in > 0) {
+      stream.next_out = out;
+      stream.avail_out = sizeof(out);
+      const size_t before = stream.avail_in;
+      int ret = inflate(&stream, Z_NO_FLUSH);
+      const uint64 consumed = before - stream.avail_in;
+      SplitLines(reinterpret_cast<char*>(out), sizeof(out) - stream.avail_out,
+                 0, block_start, &partial, &partial_offset, &builder);
+      offset += consumed;
+      if (ret == Z_STREAM_END) {
+        inflateReset(&stream);
+        block_start = offset;
+        builder.MaybeEndInterval(offset);
+      } else if (ret == Z_BUF_ERROR) {
+        break;
+      } else if (ret != Z_OK) {
+        ok = false;  // Keep what we have up to the corrupt block.
+      }
+    }
+  }
+  if (compressed) inflateEnd(&stream);
+  fclose(file);
+  builder.Finish();
+  return true;
+}
+
+_END_GOOGLE_NAMESPACE_
@@ -0,0 +1,110 @@
+/*
+ * LogIndex.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#ifndef LOGINDEX_H_
+#define LOGINDEX_H_
+
+#include <stdio.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include "logging.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// A sparse index written next to each log file (--log_index_interval_kb)
+// so that tools can binary-search a large log by time and jump straight
+// to the regions that contain errors, instead of grepping it linearly.
+//
+// The index file is "<log file name>.idx": an 8 byte magic followed by
+// fixed size LogIndexEntry records in native byte order.  Every entry
+// describes one interval of roughly --log_index_interval_kb KiB of the
+// log file.  Entries are only appended when their interval is complete,
+// so the part of the log after the last entry has to be scanned.
+//
+// For compressed logs (--log_compress) offsets always point at the start
+// of a gzip block, which may begin with a few lines of the previous
+// interval.
+
+static const char kLogIndexMagic[8] = { 'G', 'L', 'O', 'G', 'I', 'D', 'X', '1' };
+
+struct LogIndexEntry {
+  uint64 offset;                  // byte offset where the interval starts
+  int64 first_time;               // timestamp of its first line
+  int64 last_time;                // timestamp of its last line
+  uint32 counts[NUM_SEVERITIES];  // number of lines of each severity
+};
+
+// Incrementally maintains the index of the log file being written.
+// Not thread-safe: LogFileObject calls it with its lock_ held.
+class LogIndexWriter {
+public:
+  LogIndexWriter();
+  ~LogIndexWriter();
+
+  // Create "index_filename".  Returns false if it can't be created, in
+  // which case the log file simply won't have an index.
+  bool Open(const std::string& index_filename, uint32 interval_bytes);
+
+  // Account for a line of "severity" logged at "timestamp", that starts
+  // (or whose compressed block starts) at "offset".
+  void AddLine(uint64 offset, time_t timestamp, LogSeverity severity);
+
+  // Write out the current interval if the log file has grown past its end.
+  void MaybeEndInterval(uint64 file_length) {
+    if (in_interval_ && file_length - current_.offset >= interval_bytes_) {
+      EndInterval();
+    }
+  }
+
+  // Push the index file to the kernel.
+  void Flush();
+
+  // Write out the last, partial interval and close the index file.
+  void Close();
+
+private:
+  void EndInterval();
+
+  FILE* file_;
+  uint32 interval_bytes_;
+  bool in_interval_;
+  LogIndexEntry current_;
+
+  // Disallow
+  LogIndexWriter(const LogIndexWriter&);
+  void operator=(const LogIndexWriter&);
+};
+
+// The severity of a formatted log line, from its "[IWEF]" prefix.  Lines
+// without a prefix are attributed to "default_severity".
+LogSeverity LogLineSeverity(const char* line, size_t len,
+                            LogSeverity default_severity);
+
+// Read "index_filename".  Returns false if it is missing or corrupt.
+bool ReadLogIndex(const std::string& index_filename,
+                  std::vector<LogIndexEntry>* entries);
+
+// Write "entries" to "index_filename", replacing it.
+bool WriteLogIndex(const std::string& index_filename,
+                   const std::vector<LogIndexEntry>& entries);
+
+// Rebuild the index of "log_filename" by scanning it, for logs whose
+// index is missing.  Timestamps are recovered from the line prefixes and
+// the year in the "Log file created at:" header.  Framed logs
+// (--log_framing) are decoded record by record; compressed ones are
+// decompressed into memory for that.
+bool BuildLogIndex(const std::string& log_filename, uint32 interval_bytes,
+                   std::vector<LogIndexEntry>* entries);
+
+// Index of the first entry whose interval ends at or after "t", or
+// entries.size() if the whole log is older than that.
+size_t FindLogIndexEntry(const std::vector<LogIndexEntry>& entries, int64 t);
+
+_END_GOOGLE_NAMESPACE_
+
+#endif /* LOGINDEX_H_ */
@@ -11,8 +11,19 @@
 #include <vector>
 #include "raw_logging.h"
 #include "mutex.h"
+#include "LogClock.h"
 #include "LogDestination.h"
 #include "LogSink.h"
+#include "EmailNotifier.h"
+#include "AsyncStderrWriter.h"
+#include "LogDedup.h"
+#include "LogGovernor.h"
+#include "LogProfiler.h"
+#include "LogSites.h"
+#include "LogStats.h"
+#include "StackBounds.h"
+#include "StackTraceTable.h"
+#include "ThreadContext.h"
 
 #ifdef HAVE_STACKTRACE
 #include "stacktrace.h"
@@ -46,6 +57,11 @@ static CrashReason crash_reason;
 static bool exit_on_dfatal = true;
 
 static bool fatal_msg_exclusive = true;
+// How long a FATAL message waits for its email to be sent, and for
+// --log_async_stderr to write out what is buffered.
+static const int kFatalEmailTimeoutMs = 10 * 1000;
+static const int kFatalStderrTimeoutMs = 2 * 1000;
+
 static char fatal_msg_buf_exclusive[LogMessage::kMaxLogMessageLen+1];
 static char fatal_msg_buf_shared[LogMessage::kMaxLogMessageLen+1];
 static LogMessage::LogStream fatal_msg_stream_exclusive(
@@ -73,6 +89,15 @@ LogMessage::LogMessage(const char* file, int line, LogSeverity severity, int ctr
   data_->stream_->set_ctr(ctr);
 }
 
+LogMessage::LogMessage(LogSite* site) {
+  Init(site->file, site->line, site->severity, &LogMessage::SendToLog, site);
+}
+
+LogMessage::LogMessage(LogSite* site, int ctr, SendMethod send_method) {
+  Init(site->file, site->line, site->severity, send_method, site);
+  data_->stream_->set_ctr(ctr);
+}
+
 LogMessage::LogMessage(const char *file, int line) {
   Init(file, line, GLOG_INFO, &LogMessage::SendToLog);
 }
@@ -101,7 +126,9 @@ LogMessage::LogMessage(const char* file, int line, LogSeverity severity,
 }
 
 void LogMessage::Init(const char *file, int line, LogSeverity severity,
-                      void (LogMessage::*send_method)()) {
+                      void (LogMessage::*send_method)(), LogSite* site) {
+  // Before this thread can crash, while it is still safe to look.
+  StackBounds::Learn();
   allocated_ = NULL;
   if (severity != GLOG_FATAL) {
     allocated_ = new LogMessageData();
@@ -132,12 +159,25 @@ void LogMessage::Init(const char *file, int line, LogSeverity severity,
   data_->severity_ = severity;
   data_->line_ = line;
   data_->send_method_ = send_method;
-  WallTime now = WallTime_Now();
-  data_->timestamp_ = static_cast<time_t>(now);
-  localtime_r(&data_->timestamp_, &data_->tm_time_);
-  int usecs = static_cast<int>((now - data_->timestamp_) * 1000000);
-  data_->basename_ = const_basename(file);
+  data_->site_ = site;
+  data_->full_trace_id_ = 0;
+  data_->start_ns_ = (site != NULL && FLAGS_log_profile_cpu) ||
+                     LogStats::enabled() ? MonotonicNanos() : 0;
   data_->fullname_ = file;
+  if (site != NULL && !__atomic_load_n(&site->enabled, __ATOMIC_RELAXED)) {
+    // Disabled by LogSites::SetEnabled(): nothing to format a prefix for.
+    data_->basename_ = LogSites::Basename(site);
+    data_->num_prefix_chars_ = 0;
+    data_->has_been_flushed_ = true;
+    return;
+  }
+  const int64 now_ns = LogClock::NowNanos();
+  data_->timestamp_ = static_cast<time_t>(now_ns / 1000000000);
+  localtime_r(&data_->timestamp_, &data_->tm_time_);
+  int usecs = static_cast<int>(now_ns % 1000000000 / 1000);
+  RawLog__SetLastTime(data_->tm_time_, usecs);
+  data_->basename_ = site != NULL ? LogSites::Basename(site)
+                                  : const_basename(file);
   data_->has_been_flushed_ = false;
   if (FLAGS_log_prefix) {
     stream() << LogSeverityNames[severity][0]
@@ -148,21 +188,19 @@ void LogMessage::Init(const char *file, int line, LogSeverity severity,
              << setw(2) << data_->tm_time_.tm_min   << ':'
              << setw(2) << data_->tm_time_.tm_sec   << "."
              << setw(6) << usecs
-             << ' '
-             << setfill(' ') << setw(5)
-             << static_cast<unsigned int>(GetTID()) << setfill('0')
-             << ' '
-             << data_->basename_ << ':' << data_->line_ << "] ";
+             << ' ';
+    // Rendered once per thread.
+    stream().write(ThreadContext::field(), ThreadContext::field_length());
+    stream() << ' ' << data_->basename_ << ':' << data_->line_ << "] ";
+    stream().write(ThreadContext::name_field(),
+                   ThreadContext::name_field_length());
   }
   data_->num_prefix_chars_ = data_->stream_->pcount();
-  if (!FLAGS_log_backtrace_at.empty()) {
-    char fileline[128];
-    snprintf(fileline, sizeof(fileline), "%s:%d", data_->basename_, line);
-    if (!strcmp(FLAGS_log_backtrace_at.c_str(), fileline)) {
-      string stacktrace;
-      DumpStackTraceToString(&stacktrace);
-      stream() << " (stacktrace:\n" << stacktrace << ") ";
-    }
+  if (LogSites::WantsBacktrace(site, data_->basename_, line,
+                               data_->timestamp_)) {
+    string stacktrace;
+    DumpStackTraceToString(&stacktrace, severity, &data_->full_trace_id_);
+    stream() << " (stacktrace:\n" << stacktrace << ") ";
   }
 }
 
@@ -181,11 +219,43 @@ void LogMessage::Flush() {
     stream() << "\n";
     data_->num_chars_to_log_ = data_->stream_->pcount();
   }
+  if (data_->start_ns_ != 0 && LogStats::enabled()) {
+    LogStats::Record(LogStats::kFormat, MonotonicNanos() - data_->start_ns_);
+  }
+  // Repeats are coalesced, and under overload INFO and WARNING messages
+  // may be shed.
+  if (data_->send_method_ == &LogMessage::SendToLog) {
+    if (!LogDedup::Admit(data_->fullname_, data_->line_, data_->severity_,
+                         data_->message_text_ + data_->num_prefix_chars_,
+                         data_->num_chars_to_log_ -
+                             data_->num_prefix_chars_)) {
+      LogStats::Add(LogStats::kDroppedDedup);
+      data_->has_been_flushed_ = true;
+      return;
+    }
+    if (!LogGovernor::Admit(data_->severity_, data_->num_chars_to_log_)) {
+      LogStats::Add(LogStats::kDroppedGovernor);
+      data_->has_been_flushed_ = true;
+      return;
+    }
+  }
   LogTraceWithMutexLock();
+  LogStats::Add(LogStats::kMessages);
+  LogStats::Add(LogStats::kBytes, data_->num_chars_to_log_);
+
+  // Outside of log_mutex, so that a burst of ERRORs from several threads
+  // ends up sharing a single fdatasync.
+  LogDestination::MaybeSyncLogfile(data_->severity_);
 
   WaitForSink();
 
   data_->has_been_flushed_ = true;
+
+  if (data_->site_ != NULL) {
+    LogProfiler::Account(data_->site_, data_->num_chars_to_log_,
+                         FLAGS_log_profile_cpu ? data_->start_ns_ : 0);
+  }
+  LogProfiler::MaybeDump();
 }
 
 // Copy of first FATAL log message so that we can print it out again
@@ -195,9 +265,23 @@ static time_t fatal_time;
 static char fatal_message[256];
 
 void LogMessage::LogTraceWithMutexLock() {
-  MutexLock l(&log_mutex);
+  // The governor and the stats want to know how long callers wait for
+  // log_mutex; only read the clock when it is contended.
+  const bool governed = LogGovernor::enabled();
+  const bool timed = governed || LogStats::enabled();
+  int64 wait_ns = 0;
+  if (!timed) {
+    log_mutex.Lock();
+  } else if (!log_mutex.TryLock()) {
+    const int64 start = MonotonicNanos();
+    log_mutex.Lock();
+    wait_ns = MonotonicNanos() - start;
+  }
   (this->*(data_->send_method_))();
   ++num_messages_[static_cast<int>(data_->severity_)];
+  log_mutex.Unlock();
+  if (governed) LogGovernor::Account(data_->num_chars_to_log_, wait_ns);
+  if (LogStats::enabled()) LogStats::Record(LogStats::kLockWait, wait_ns);
 }
 
 // callers must hold the log_mutex
@@ -215,7 +299,8 @@ void LogMessage::SendToLog() EXCLUSIVE_LOCKS_REQUIRED(log_mutex) {
   // global flag: never log to file if set. Also,
   // don't log to a file if we haven't retrieved program name.
   if (FLAGS_logtostderr || !IsGoogleLoggingInitialized()) {
-    WriteToStderr(data_->message_text_, data_->num_chars_to_log_);
+    LogDestination::LogToStderr(data_->severity_, data_->message_text_,
+                                data_->num_chars_to_log_);
     LogDestination::LogToSinks(data_->severity_, data_->fullname_,
                                data_->basename_, data_->line_,
                                &data_->tm_time_,
@@ -241,6 +326,11 @@ void LogMessage::SendToLog() EXCLUSIVE_LOCKS_REQUIRED(log_mutex) {
                                 - data_->num_prefix_chars_ - 1));
   }
 
+  if (data_->full_trace_id_ != 0) {
+    // The trace has only now been written in full.
+    StackTraceTable::MarkEmitted(data_->full_trace_id_, data_->severity_);
+  }
+
   // If we log a FATAL message, flush all the log destinations, then toss
   // a signal for others to catch. We leave the logs in a state that
   // someone else can use them (as long as they flush afterwards)
@@ -261,8 +351,10 @@ void LogMessage::SendToLog() EXCLUSIVE_LOCKS_REQUIRED(log_mutex) {
     if (!FLAGS_logtostderr) {
       for (int i = 0; i < NUM_SEVERITIES; ++i) {
         if ( LogDestination::log_destinations_[i] )
-          LogDestination::log_destinations_[i]->logger_->Write(true, 0, "", 0);
+          LogDestination::log_destinations_[i]->logger_->Flush();
       }
+      // We are about to die: make the FATAL message durable as well.
+      LogDestination::MaybeSyncLogfile(GLOG_FATAL);
     }
 
     // release the lock that our caller (directly or indirectly)
@@ -274,6 +366,14 @@ void LogMessage::SendToLog() EXCLUSIVE_LOCKS_REQUIRED(log_mutex) {
 
     WaitForSink();
 
+    // Make sure the FATAL message itself gets out on stderr.
+    AsyncStderrWriter* stderr_writer = AsyncStderrWriter::GetIfStarted();
+    if (stderr_writer != NULL) stderr_writer->Drain(kFatalStderrTimeoutMs);
+
+    // Give the email about this FATAL message a chance to go out.
+    EmailNotifier* notifier = EmailNotifier::GetIfStarted();
+    if (notifier != NULL) notifier->Flush(kFatalEmailTimeoutMs);
+
     Fail();
 
     // below code is just for unit test
@@ -39,6 +39,13 @@ public:
   LogMessage(const char* file, int line, LogSeverity severity, int ctr,
              SendMethod send_method);
 
+  // Used for LOG(severity): Implied are: file, line and severity
+  // from "site", ctr = 0, send_method = &LogMessage::SendToLog.
+  explicit LogMessage(LogSite* site);
+
+  // Used for LOG_FIRST_N LOG_EVERY_N LOG_IF_EVERY_N & LOG_EVERY_T
+  LogMessage(LogSite* site, int ctr, SendMethod send_method);
+
   // Used for LOG(INFO): Implied are:
   // severity = INFO, ctr = 0, send_method = &LogMessage::SendToLog.
   LogMessage(const char *file, int line);
@@ -90,7 +97,7 @@ public:
 
 private:
   void Init(const char *file, int line, LogSeverity severity,
-            void (LogMessage::*send_method)());
+            void (LogMessage::*send_method)(), LogSite* site = NULL);
 
   // Fully internal SendMethod cases:
   void SendToSinkAndLog(); // Send to sink if provided and dispatch to the logs
@@ -133,6 +140,9 @@ private:
     tm tm_time_;                  // year, month, day, hour, minute, second
     const char *basename_;        // basename of file that called LOG
     const char *fullname_;        // fullname of file that called LOG
+    LogSite *site_;               // NULL if not logged through a LogSite
+    int full_trace_id_;           // StackTraceTable id of a trace in full
+    int64 start_ns_;              // MonotonicNanos() at Init(), if timed
     size_t num_prefix_chars_;     // number of chars of prefix in this message
     size_t num_chars_to_log_;     // number of chars of msg to send to log
     bool has_been_flushed_;       // false => data has not been flushed
@@ -0,0 +1,112 @@
+/*
+ * LogProfiler.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#include "LogProfiler.h"
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "LogMessage.h"
+#include "LogSites.h"
+
+using std::string;
+using std::vector;
+
+_START_GOOGLE_NAMESPACE_
+
+// How many sites the signal-triggered dump lists.
+static const int kDumpSites = 20;
+
+int LogProfiler::dump_requested_ = 0;
+
+void LogProfiler::Init() {
+  if (FLAGS_log_profile_signal <= 0) return;
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  sigemptyset(&action.sa_mask);
+  action.sa_handler = &HandleSignal;
+  action.sa_flags = SA_RESTART;
+  sigaction(FLAGS_log_profile_signal, &action, NULL);
+}
+
+void LogProfiler::HandleSignal(int) {
+  __atomic_store_n(&dump_requested_, 1, __ATOMIC_RELAXED);
+}
+
+namespace {
+
+struct SiteProfile {
+  LogSite* site;
+  int64 messages;
+  int64 bytes;
+  int64 nanos;
+};
+
+bool MoreBytes(const SiteProfile& a, const SiteProfile& b) {
+  return a.bytes > b.bytes;
+}
+
+}  // namespace
+
+string LogProfiler::TopSites(int n) {
+  vector<SiteProfile> profiles;
+  int64 total_messages = 0, total_bytes = 0;
+  for (int id = 0; id < LogSites::count(); ++id) {
+    LogSite* site = LogSites::Get(id);
+    SiteProfile profile;
+    profile.site = site;
+    profile.messages = __atomic_load_n(&site->messages, __ATOMIC_RELAXED);
+    if (profile.messages == 0) continue;
+    profile.bytes = __atomic_load_n(&site->bytes, __ATOMIC_RELAXED);
+    profile.nanos = __atomic_load_n(&site->nanos, __ATOMIC_RELAXED);
+    total_messages += profile.messages;
+    total_bytes += profile.bytes;
+    profiles.push_back(profile);
+  }
+  n = std::min<int>(std::max(n, 0), profiles.size());
+  std::partial_sort(profiles.begin(), profiles.begin() + n, profiles.end(),
+                    &MoreBytes);
+
+  char line[256];
+  snprintf(line, sizeof(line),
+           "Top %d of %d log sites by bytes (total %lld messages, "
+           "%lld bytes):\n%12s %14s %6s %10s  %s\n", n,
+           static_cast<int>(profiles.size()),
+           static_cast<long long>(total_messages),
+           static_cast<long long>(total_bytes),
+           "messages", "bytes", "%", "cpu ms", "site");
+  string table(line);
+  for (int i = 0; i < n; ++i) {
+    const SiteProfile& profile = profiles[i];
+    snprintf(line, sizeof(line), "%12lld %14lld %6.2f %10.3f  %s:%d %s\n",
+             static_cast<long long>(profile.messages),
+             static_cast<long long>(profile.bytes),
+             100.0 * profile.bytes / total_bytes, profile.nanos / 1e6,
+             profile.site->basename, profile.site->line,
+             LogSeverityNames[profile.site->severity]);
+    table += line;
+  }
+  return table;
+}
+
+void LogProfiler::Reset() {
+  for (int id = 0; id < LogSites::count(); ++id) {
+    LogSite* site = LogSites::Get(id);
+    __atomic_store_n(&site->messages, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&site->bytes, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&site->nanos, 0, __ATOMIC_RELAXED);
+  }
+}
+
+void LogProfiler::Dump() {
+  // Only the thread that takes the request dumps.
+  if (!__atomic_exchange_n(&dump_requested_, 0, __ATOMIC_RELAXED)) return;
+  LogMessage(__FILE__, __LINE__, GLOG_INFO).stream() << TopSites(kDumpSites);
+}
+
+_END_GOOGLE_NAMESPACE_
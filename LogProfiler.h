@@ -0,0 +1,67 @@
+/*
+ * LogProfiler.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#ifndef LOGPROFILER_H_
+#define LOGPROFILER_H_
+
+#include <stddef.h>
+#include <string>
+#include "logging.h"
+#include "utilities.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// Attributes logging to the LOG() statements responsible for it.
+//
+// Every LogSite counts the messages it logged and their bytes, and with
+// --log_profile_cpu the nanoseconds from the LogMessage being created to
+// it being sent: formatting, prefix, and dispatch including waiting for
+// log_mutex.  The counters are updated with relaxed atomic adds, so the
+// profile is always on.
+//
+// TopSites() reports the sites that logged the most bytes, and
+// --log_profile_signal logs that report when the signal arrives: the
+// handler only sets a flag, and the next message logged does the work.
+class LogProfiler {
+public:
+  // Install the --log_profile_signal handler.  Called by
+  // InitGoogleLogging().
+  static void Init();
+
+  // Account for a message of "len" bytes logged from "site", which
+  // started at "start_ns" (MonotonicNanos()), or 0 if not timed.
+  static void Account(LogSite* site, size_t len, int64 start_ns) {
+    __atomic_add_fetch(&site->messages, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&site->bytes, len, __ATOMIC_RELAXED);
+    if (start_ns != 0) {
+      __atomic_add_fetch(&site->nanos,
+                         glog_internal_namespace_::MonotonicNanos() - start_ns,
+                         __ATOMIC_RELAXED);
+    }
+  }
+
+  // A table of the "n" sites that logged the most bytes.
+  static std::string TopSites(int n);
+
+  // Zero the profile of all sites.
+  static void Reset();
+
+  // Log TopSites() if --log_profile_signal was received.
+  static void MaybeDump() {
+    if (__atomic_load_n(&dump_requested_, __ATOMIC_RELAXED)) Dump();
+  }
+
+private:
+  static void Dump();
+  static void HandleSignal(int signal);
+
+  static int dump_requested_;
+};
+
+_END_GOOGLE_NAMESPACE_
+
+#endif /* LOGPROFILER_H_ */
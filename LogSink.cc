@@ -9,6 +9,7 @@
 #include <sstream>
 #include <iomanip>
 #include "utilities.h"
+#include "ThreadContext.h"
 
 _START_GOOGLE_NAMESPACE_
 
@@ -36,10 +37,10 @@ string LogSink::ToString(LogSeverity severity, const char* file, int line,
          << setw(2) << tm_time->tm_min << ':'
          << setw(2) << tm_time->tm_sec << '.'
          << setw(6) << usecs
-         << ' '
-         << setfill(' ') << setw(5) << GetTID() << setfill('0')
-         << ' '
-         << file << ':' << line << "] ";
+         << ' ';
+  stream.write(ThreadContext::field(), ThreadContext::field_length());
+  stream << ' ' << file << ':' << line << "] ";
+  stream.write(ThreadContext::name_field(), ThreadContext::name_field_length());
 
   stream << string(message, message_len);
   return stream.str();
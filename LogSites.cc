@@ -0,0 +1,149 @@
+/*
+ * LogSites.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#include "LogSites.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+#include "mutex.h"
+
+using std::pair;
+using std::string;
+using std::vector;
+
+_START_GOOGLE_NAMESPACE_
+
+// Defined by the linker around the "glog_log_sites" section.  Weak, so
+// that a program without any registered LOG() statement still links.
+extern "C" {
+extern LogSite* __start_glog_log_sites[]
+    __attribute__((weak, visibility("hidden")));
+extern LogSite* __stop_glog_log_sites[]
+    __attribute__((weak, visibility("hidden")));
+}
+
+static pthread_once_t log_sites_once = PTHREAD_ONCE_INIT;
+static LogSite** log_sites = NULL;  // sorted by address, no duplicates
+static int num_log_sites = 0;
+
+static void InitLogSites() {
+  if (__start_glog_log_sites == NULL) return;
+  LogSite** begin = __start_glog_log_sites;
+  LogSite** end = __stop_glog_log_sites;
+  LogSite** sites = new LogSite*[end - begin];
+  LogSite** sites_end = std::remove_copy(begin, end, sites,
+                                         static_cast<LogSite*>(NULL));
+  std::sort(sites, sites_end);
+  sites_end = std::unique(sites, sites_end);
+  const int count = sites_end - sites;
+  for (int id = 0; id < count; ++id) {
+    LogSites::Basename(sites[id]);
+    sites[id]->id = id;
+  }
+  log_sites = sites;
+  __atomic_store_n(&num_log_sites, count, __ATOMIC_RELEASE);
+}
+
+void LogSites::Init() {
+  pthread_once(&log_sites_once, &InitLogSites);
+}
+
+int LogSites::count() {
+  return __atomic_load_n(&num_log_sites, __ATOMIC_ACQUIRE);
+}
+
+LogSite* LogSites::Get(int id) {
+  if (id < 0 || id >= count()) return NULL;
+  return log_sites[id];
+}
+
+bool LogSites::backtrace_wanted_ = false;
+
+static Mutex backtrace_mutex;
+static string backtrace_flag;                    // as last parsed
+static vector<pair<string, int> > backtrace_at;  // its file:line entries
+static int backtrace_generation = 1;             // bumped by each parse
+static time_t backtrace_checked = 0;             // when the flag was seen
+
+// Parse --log_backtrace_at again if it changed, at most once a second.
+static void MaybeParseBacktraceAt(time_t now, bool* wanted) {
+  time_t checked = __atomic_load_n(&backtrace_checked, __ATOMIC_RELAXED);
+  if (checked == now ||
+      !__atomic_compare_exchange_n(&backtrace_checked, &checked, now, false,
+                                   __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    return;
+  }
+  MutexLock l(&backtrace_mutex);
+  if (FLAGS_log_backtrace_at == backtrace_flag) return;
+  backtrace_flag = FLAGS_log_backtrace_at;
+  backtrace_at.clear();
+  size_t begin = 0;
+  while (begin <= backtrace_flag.size()) {
+    size_t end = backtrace_flag.find(',', begin);
+    if (end == string::npos) end = backtrace_flag.size();
+    string entry = backtrace_flag.substr(begin, end - begin);
+    const size_t first = entry.find_first_not_of(" \t");
+    const size_t last = entry.find_last_not_of(" \t");
+    entry = first == string::npos ? "" : entry.substr(first, last - first + 1);
+    const size_t colon = entry.rfind(':');
+    if (colon != string::npos) {
+      backtrace_at.push_back(make_pair(entry.substr(0, colon),
+                                       atoi(entry.c_str() + colon + 1)));
+    }
+    begin = end + 1;
+  }
+  __atomic_add_fetch(&backtrace_generation, 1, __ATOMIC_RELEASE);
+  __atomic_store_n(wanted, !backtrace_at.empty(), __ATOMIC_RELAXED);
+}
+
+static bool BacktraceAt(const char* basename, int line) {
+  ReaderMutexLock l(&backtrace_mutex);
+  for (size_t i = 0; i < backtrace_at.size(); ++i) {
+    if (backtrace_at[i].second == line && backtrace_at[i].first == basename) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool LogSites::WantsBacktraceSlow(LogSite* site, const char* basename,
+                                  int line, time_t now) {
+  MaybeParseBacktraceAt(now, &backtrace_wanted_);
+  if (!__atomic_load_n(&backtrace_wanted_, __ATOMIC_RELAXED)) return false;
+  if (site == NULL) return BacktraceAt(basename, line);
+  const int generation =
+      __atomic_load_n(&backtrace_generation, __ATOMIC_ACQUIRE);
+  int cached = __atomic_load_n(&site->backtrace, __ATOMIC_RELAXED);
+  if (cached >> 1 != generation) {
+    cached = generation << 1 | BacktraceAt(basename, line);
+    __atomic_store_n(&site->backtrace, cached, __ATOMIC_RELAXED);
+  }
+  return cached & 1;
+}
+
+int LogSites::SetEnabled(const char* basename, int line, bool enabled) {
+  const int n = count();
+  int found = 0;
+  for (int id = 0; id < n; ++id) {
+    LogSite* site = log_sites[id];
+    if ((line != 0 && site->line != line) ||
+        strcmp(site->basename, basename) != 0) {
+      continue;
+    }
+    ++found;
+    if (site->severity < GLOG_FATAL) {
+      __atomic_store_n(&site->enabled, enabled, __ATOMIC_RELAXED);
+    }
+  }
+  return found;
+}
+
+_END_GOOGLE_NAMESPACE_
@@ -0,0 +1,78 @@
+/*
+ * LogSites.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#ifndef LOGSITES_H_
+#define LOGSITES_H_
+
+#include "logging.h"
+#include "utilities.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// The registry of all the LogSites linked into the program.
+//
+// The linker gathers the address of the LogSite of every LOG() statement
+// into the "glog_log_sites" section; Init() walks it once, numbers the
+// sites and
+// computes their basenames, so that logging no longer does a strrchr()
+// per message, and per-site state can live in plain arrays indexed by
+// LogSite::id.
+//
+// Only the sites of the module (executable or shared library) that
+// glog is linked into are found: each module has its own section.
+class LogSites {
+public:
+  // Number and fill in all sites.  Called by InitGoogleLogging();
+  // further calls do nothing.
+  static void Init();
+
+  // The number of sites, 0 before Init().
+  static int count();
+
+  // The site numbered "id", or NULL.
+  static LogSite* Get(int id);
+
+  // Enable or disable the sites at "basename:line", or all the sites in
+  // "basename" if "line" is 0.  FATAL sites can't be disabled.  Returns
+  // the number of sites found.
+  static int SetEnabled(const char* basename, int line, bool enabled);
+
+  // Whether --log_backtrace_at asks for a stack trace at "basename:line"
+  // (of "site", which may be NULL).  The flag is parsed again when it
+  // changes, which is looked at no more than once a second ("now"); a
+  // site keeps the answer, tagged with the number of that parse, in
+  // LogSite::backtrace.  So a site not in the list costs a few loads.
+  static bool WantsBacktrace(LogSite* site, const char* basename, int line,
+                             time_t now) {
+    if (FLAGS_log_backtrace_at.empty() &&
+        !__atomic_load_n(&backtrace_wanted_, __ATOMIC_RELAXED)) {
+      return false;   // Not asked for, now or at the last parse.
+    }
+    return WantsBacktraceSlow(site, basename, line, now);
+  }
+
+  // The basename of site->file, computed on first use if Init() has not
+  // done it.
+  static const char* Basename(LogSite* site) {
+    const char* basename = __atomic_load_n(&site->basename, __ATOMIC_RELAXED);
+    if (basename == NULL) {
+      basename = glog_internal_namespace_::const_basename(site->file);
+      __atomic_store_n(&site->basename, basename, __ATOMIC_RELAXED);
+    }
+    return basename;
+  }
+
+private:
+  static bool WantsBacktraceSlow(LogSite* site, const char* basename,
+                                 int line, time_t now);
+
+  static bool backtrace_wanted_;   // the last parse found sites
+};
+
+_END_GOOGLE_NAMESPACE_
+
+#endif /* LOGSITES_H_ */
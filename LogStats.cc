@@ -0,0 +1,144 @@
+/*
+ * LogStats.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#include "LogStats.h"
+#include <stdio.h>
+#include <string.h>
+
+using std::string;
+
+_START_GOOGLE_NAMESPACE_
+
+namespace {
+
+struct Shard {
+  uint64 counters[LogStats::kNumCounters];
+  uint64 counts[LogStats::kNumHistograms];
+  uint64 sums[LogStats::kNumHistograms];
+  uint64 buckets[LogStats::kNumHistograms][LogStats::kNumBuckets];
+} __attribute__((aligned(64)));
+
+Shard shards[LogStats::kNumShards];
+int next_shard = 0;
+__thread Shard* thread_shard = NULL;
+
+Shard* GetShard() {
+  if (thread_shard == NULL) {
+    const int index = __atomic_fetch_add(&next_shard, 1, __ATOMIC_RELAXED);
+    thread_shard = &shards[index % LogStats::kNumShards];
+  }
+  return thread_shard;
+}
+
+int Bucket(uint64 value) {
+  if (value < 2) return 0;
+  const int bucket = 63 - __builtin_clzll(value);
+  return bucket < LogStats::kNumBuckets ? bucket : LogStats::kNumBuckets - 1;
+}
+
+const char* const kCounterNames[LogStats::kNumCounters] = {
+  "messages", "bytes", "flushes", "syncs", "rollovers", "dropped_dedup",
+  "dropped_governor", "dropped_stderr", "dropped_email", "dropped_disk_full"
+};
+
+const char* const kHistogramNames[LogStats::kNumHistograms] = {
+  "format_ns", "lock_wait_ns", "write_ns", "flush_ns", "flushed_bytes",
+  "rollover_ns", "sink_send_ns"
+};
+
+}  // namespace
+
+void LogStats::Add(Counter counter, uint64 n) {
+  __atomic_add_fetch(&GetShard()->counters[counter], n, __ATOMIC_RELAXED);
+}
+
+void LogStats::Record(Histogram histogram, int64 value) {
+  if (value < 0) value = 0;
+  Shard* shard = GetShard();
+  __atomic_add_fetch(&shard->counts[histogram], 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&shard->sums[histogram], value, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&shard->buckets[histogram][Bucket(value)], 1,
+                     __ATOMIC_RELAXED);
+}
+
+void LogStats::GetSnapshot(Snapshot* snapshot) {
+  memset(snapshot, 0, sizeof(*snapshot));
+  for (int s = 0; s < kNumShards; ++s) {
+    const Shard& shard = shards[s];
+    for (int c = 0; c < kNumCounters; ++c) {
+      snapshot->counters[c] +=
+          __atomic_load_n(&shard.counters[c], __ATOMIC_RELAXED);
+    }
+    for (int h = 0; h < kNumHistograms; ++h) {
+      snapshot->counts[h] += __atomic_load_n(&shard.counts[h],
+                                             __ATOMIC_RELAXED);
+      snapshot->sums[h] += __atomic_load_n(&shard.sums[h], __ATOMIC_RELAXED);
+      for (int b = 0; b < kNumBuckets; ++b) {
+        snapshot->buckets[h][b] +=
+            __atomic_load_n(&shard.buckets[h][b], __ATOMIC_RELAXED);
+      }
+    }
+  }
+}
+
+void LogStats::Reset() {
+  for (int s = 0; s < kNumShards; ++s) {
+    uint64* words = reinterpret_cast<uint64*>(&shards[s]);
+    for (size_t i = 0; i < sizeof(Shard) / sizeof(uint64); ++i) {
+      __atomic_store_n(&words[i], 0, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+const char* LogStats::CounterName(Counter counter) {
+  return kCounterNames[counter];
+}
+
+const char* LogStats::HistogramName(Histogram histogram) {
+  return kHistogramNames[histogram];
+}
+
+uint64 LogStats::Snapshot::Percentile(Histogram histogram, double p) const {
+  // Counts may be a little off from the buckets, which were read later.
+  uint64 total = 0;
+  for (int b = 0; b < kNumBuckets; ++b) total += buckets[histogram][b];
+  if (total == 0) return 0;
+  const double rank = total * p / 100;
+  uint64 seen = 0;
+  for (int b = 0; b < kNumBuckets; ++b) {
+    seen += buckets[histogram][b];
+    if (seen >= rank) return (2ULL << b) - 1;
+  }
+  return (2ULL << (kNumBuckets - 1)) - 1;
+}
+
+string LogStats::Snapshot::ToString() const {
+  string text;
+  char line[256];
+  for (int c = 0; c < kNumCounters; ++c) {
+    snprintf(line, sizeof(line), "%s %llu\n", kCounterNames[c],
+             static_cast<unsigned long long>(counters[c]));
+    text += line;
+  }
+  for (int h = 0; h < kNumHistograms; ++h) {
+    const Histogram histogram = static_cast<Histogram>(h);
+    snprintf(line, sizeof(line),
+             "%s count %llu mean %llu p50 %llu p90 %llu p99 %llu "
+             "p99.9 %llu\n", kHistogramNames[h],
+             static_cast<unsigned long long>(counts[h]),
+             static_cast<unsigned long long>(counts[h] ? sums[h] / counts[h]
+                                                       : 0),
+             static_cast<unsigned long long>(Percentile(histogram, 50)),
+             static_cast<unsigned long long>(Percentile(histogram, 90)),
+             static_cast<unsigned long long>(Percentile(histogram, 99)),
+             static_cast<unsigned long long>(Percentile(histogram, 99.9)));
+    text += line;
+  }
+  return text;
+}
+
+_END_GOOGLE_NAMESPACE_
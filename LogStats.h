@@ -0,0 +1,84 @@
+/*
+ * LogStats.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#ifndef LOGSTATS_H_
+#define LOGSTATS_H_
+
+#include <string>
+#include "logging.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// Counters and latency histograms of the logging pipeline itself.
+//
+// Counters are always kept.  Latencies are only measured with
+// --log_stats, since that takes a couple of clock reads per message.
+//
+// Updates go to one of kNumShards cache-line aligned shards, picked per
+// thread, with relaxed atomic adds: threads don't share cache lines
+// unless there are more of them than shards, and even then never lose
+// counts.  GetSnapshot() adds the shards up.
+class LogStats {
+public:
+  enum Counter {
+    kMessages,          // messages sent to the logs
+    kBytes,             // and their bytes
+    kFlushes,           // log file flushes
+    kSyncs,             // log file fdatasyncs (--logsynclevel)
+    kRollovers,         // log files created
+    kDroppedDedup,      // repeats counted instead of logged (LogDedup)
+    kDroppedGovernor,   // messages shed under overload (LogGovernor)
+    kDroppedStderr,     // dropped by the --log_async_stderr writer
+    kDroppedEmail,      // alerts left out of logging email
+    kDroppedDiskFull,   // not written: --stop_logging_if_full_disk
+    kNumCounters
+  };
+
+  enum Histogram {
+    kFormat,            // LogMessage created until flushed, in ns
+    kLockWait,          // waiting for log_mutex, in ns
+    kWrite,             // appending to a log file, in ns
+    kFlush,             // flushing a log file, in ns
+    kFlushedBytes,      // bytes written since the previous flush
+    kRollover,          // closing and creating a log file, in ns
+    kSinkSend,          // LogSink::send() calls for a message, in ns
+    kNumHistograms
+  };
+
+  // Bucket 0 holds 0 and 1, bucket i > 0 holds [2^i, 2^(i+1)).
+  static const int kNumBuckets = 48;
+  static const int kNumShards = 32;
+
+  struct Snapshot {
+    uint64 counters[kNumCounters];
+    uint64 counts[kNumHistograms];
+    uint64 sums[kNumHistograms];
+    uint64 buckets[kNumHistograms][kNumBuckets];
+
+    // An upper bound of the "p"th percentile (0 < p <= 100), 0 if empty.
+    uint64 Percentile(Histogram histogram, double p) const;
+
+    // One line per counter and per histogram.
+    std::string ToString() const;
+  };
+
+  // Measure latencies?
+  static bool enabled() { return FLAGS_log_stats; }
+
+  static void Add(Counter counter, uint64 n = 1);
+  static void Record(Histogram histogram, int64 value);
+
+  static void GetSnapshot(Snapshot* snapshot);
+  static void Reset();
+
+  static const char* CounterName(Counter counter);
+  static const char* HistogramName(Histogram histogram);
+};
+
+_END_GOOGLE_NAMESPACE_
+
+#endif /* LOGSTATS_H_ */
@@ -8,13 +8,22 @@
 #include <stdio.h>
 #include <assert.h>
 #include <fcntl.h>
+#include <sched.h>
 #include <string.h>
+#include <unistd.h>
 #include <errno.h> // for errno
 #include <iomanip>
 #include <vector>
 #include <strstream>
 #include "utilities.h"
 #include "LogDestination.h"
+#include "DirectFileWriter.h"
+#include "LogCompressor.h"
+#include "LogIndex.h"
+#include "LogFraming.h"
+#include "RingLogFile.h"
+#include "StackTraceTable.h"
+#include "LogStats.h"
 
 using std::vector;
 using std::setw;
@@ -34,6 +43,45 @@ DEFINE_bool(stop_logging_if_full_disk, false,
 DEFINE_string(log_link, "", "Put additional links to the log "
               "files in this directory");
 
+DEFINE_bool(log_direct_io, false,
+            "Write log files with O_DIRECT, through aligned double buffers, "
+            "so that logging doesn't pollute the page cache.  Falls back to "
+            "buffered writes on file systems without direct I/O.");
+
+DEFINE_bool(log_compress, false,
+            "Compress log files as they are written, in independent gzip "
+            "blocks that are written out every 64 KiB and whenever the log "
+            "is flushed.  The files get a .gz suffix; read them with zcat "
+            "or logcat.");
+
+DEFINE_bool(log_compress_defer_flush, false,
+            "With --log_compress, don't end a block for every message above "
+            "--logbuflevel, only every 64 KiB and on the --logbufsecs timer.  "
+            "Fewer and better compressed gzip members, but a crash loses "
+            "what was logged since the last block.");
+
+DEFINE_bool(log_drop_page_cache, false,
+            "After log data has been flushed, write it back and drop it "
+            "from the page cache with posix_fadvise(DONTNEED).");
+
+DEFINE_int32(log_index_interval_kb, 0,
+             "If positive, maintain a sparse time/severity index of every "
+             "log file in <log file>.idx, with one entry per this many KiB "
+             "of log.  Read it with the logindex tool.");
+
+DEFINE_bool(log_framing, false,
+            "Write every log message as a record with a length and a "
+            "CRC32C, with periodic sync markers, so that torn or corrupt "
+            "parts of a log file can be detected and skipped.  Read such "
+            "files with logrecover.");
+
+DEFINE_int32(log_ring_size_mb, 0,
+             "If positive, write each severity's log to a single "
+             "preallocated file of this many MB that is overwritten as a "
+             "ring, oldest records first, instead of to a series of "
+             "files.  Read it with logring.  A process that finds the "
+             "ring in use by another one writes <ring>.<pid> instead.");
+
 _START_GOOGLE_NAMESPACE_
 
 // Safely get max_log_size, overriding to 1 if it somehow gets defined as 0
@@ -41,6 +89,17 @@ static int32 MaxLogSize() {
   return (FLAGS_max_log_size > 0 ? FLAGS_max_log_size : 1);
 }
 
+// With --log_drop_page_cache, write back and drop the page cache once
+// at least this many bytes have been flushed since the last time.
+static const uint32 kDropPageCacheChunk = 1 << 20;
+
+// With --log_compress, uncompressed data is written out as a block once
+// there is this much of it, even if no flush is due yet.
+static const size_t kCompressBlockSize = 64 * 1024;
+
+// See LogFileObject::SetSyncHook().
+static void (*sync_hook)() = NULL;
+
 static vector<string>* logging_directories_list;
 // Globally disable log writing (if disk is full)
 static bool stop_writing = false;
@@ -76,21 +135,32 @@ LogFileObject::LogFileObject(LogSeverity severity,
     symlink_basename_(glog_internal_namespace_::ProgramInvocationShortName()),
     filename_extension_(),
     file_(NULL),
+    direct_writer_(NULL),
+    ring_(NULL),
+    compressor_(NULL),
+    index_(NULL),
+    framed_(false),
+    framed_length_(0),
+    last_sync_marker_(0),
     severity_(severity),
     bytes_since_flush_(0),
     file_length_(0),
     rollover_attempt_(kRolloverAttemptFrequency-1),
-    next_flush_time_(0) {
+    next_flush_time_(0),
+    page_cache_dropped_(0),
+    page_cache_written_(0),
+    write_seq_(0),
+    raw_fd_(-1),
+    raw_writers_(0),
+    synced_seq_(0),
+    sync_in_progress_(false) {
   assert(severity >= 0);
   assert(severity < NUM_SEVERITIES);
 }
 
 LogFileObject::~LogFileObject() {
   MutexLock l(&lock_);
-  if (file_ != NULL) {
-    fclose(file_);
-    file_ = NULL;
-  }
+  CloseLogfile();
 }
 
 void LogFileObject::SetBasename(const char* basename) {
@@ -98,9 +168,8 @@ void LogFileObject::SetBasename(const char* basename) {
   base_filename_selected_ = true;
   if (base_filename_ != basename) {
     // Get rid of old log file since we are changing names
-    if (file_ != NULL) {
-      fclose(file_);
-      file_ = NULL;
+    if (HasLogfile()) {
+      CloseLogfile();
       rollover_attempt_ = kRolloverAttemptFrequency-1;
     }
     base_filename_ = basename;
@@ -111,9 +180,8 @@ void LogFileObject::SetExtension(const char* ext) {
   MutexLock l(&lock_);
   if (filename_extension_ != ext) {
     // Get rid of old log file since we are changing names
-    if (file_ != NULL) {
-      fclose(file_);
-      file_ = NULL;
+    if (HasLogfile()) {
+      CloseLogfile();
       rollover_attempt_ = kRolloverAttemptFrequency-1;
     }
     filename_extension_ = ext;
@@ -131,19 +199,289 @@ void LogFileObject::Flush() {
 }
 
 void LogFileObject::FlushUnlocked(){
-  if (file_ != NULL) {
+  const int64 start = LogStats::enabled() ? MonotonicNanos() : 0;
+  const uint32 flushed_bytes = bytes_since_flush_;
+  if (compressor_ != NULL) CompressPendingBlock();
+  if (index_ != NULL) index_->Flush();
+  if (direct_writer_ != NULL) {
+    direct_writer_->Flush();
+    bytes_since_flush_ = 0;
+  } else if (ring_ != NULL) {
+    ring_->Flush();
+    bytes_since_flush_ = 0;
+  } else if (file_ != NULL) {
     fflush(file_);
     bytes_since_flush_ = 0;
+    if (FLAGS_log_drop_page_cache) DropPageCache(false);
   }
   // Figure out when we are due for another flush.
   const int64 next = (FLAGS_logbufsecs
-                      * static_cast<int64>(1000000));  // in usec
-  next_flush_time_ = CycleClock_Now() + next;
+                      * static_cast<int64>(1000000000));  // in nsec
+  next_flush_time_ = LogEveryTNowNanos() + next;
+
+  if (!HasLogfile()) return;
+  LogStats::Add(LogStats::kFlushes);
+  if (start != 0) {
+    LogStats::Record(LogStats::kFlush, MonotonicNanos() - start);
+    LogStats::Record(LogStats::kFlushedBytes, flushed_bytes);
+  }
+}
+
+void LogFileObject::Sync() {
+  uint64 target;
+  {
+    MutexLock l(&lock_);
+    target = write_seq_;
+  }
+  CondVarLock l(&sync_cv_);
+  while (synced_seq_ < target) {
+    if (sync_in_progress_) {
+      // Somebody else is syncing; it may or may not cover our write.
+      sync_cv_.Wait();
+      continue;
+    }
+    // Become the leader: sync everything written up to now, including
+    // the writes of every thread that is waiting behind us.
+    sync_in_progress_ = true;
+    sync_cv_.Unlock();
+    uint64 batch;
+    int fd = -1;
+    {
+      MutexLock l(&lock_);
+      batch = write_seq_;
+      FlushUnlocked();
+      // dup() so that a concurrent rollover can close the file under us.
+      if (HasLogfile()) fd = dup(LogfileDescriptor());
+    }
+    if (sync_hook != NULL) sync_hook();
+    if (fd >= 0) {
+      fdatasync(fd);
+      close(fd);
+      LogStats::Add(LogStats::kSyncs);
+    }
+    sync_cv_.Lock();
+    sync_in_progress_ = false;
+    if (batch > synced_seq_) synced_seq_ = batch;
+    sync_cv_.SignalAll();
+  }
+}
+
+void LogFileObject::SetSyncHook(void (*hook)()) {
+  sync_hook = hook;
+}
+
+void LogFileObject::FlushUnsafe() {
+  if (direct_writer_ != NULL) {
+    direct_writer_->FlushUnsafe();
+  } else if (ring_ != NULL) {
+    ring_->Flush();
+  } else if (file_ != NULL) {
+    fflush_unlocked(file_);
+  }
+}
+
+void LogFileObject::WriteRaw(const char* data, size_t len) {
+  // Sequentially consistent, against SetRawDescriptor(): either it sees
+  // this writer, or this writer sees the new descriptor.
+  __atomic_add_fetch(&raw_writers_, 1, __ATOMIC_SEQ_CST);
+  const int fd = __atomic_load_n(&raw_fd_, __ATOMIC_SEQ_CST);
+  if (fd >= 0 && write(fd, data, len) < 0) {
+    // Ignore errors.
+  }
+  __atomic_sub_fetch(&raw_writers_, 1, __ATOMIC_SEQ_CST);
+}
+
+void LogFileObject::SetRawDescriptor(int fd) {
+  // How long to wait for a WriteRaw() to finish with the old descriptor.
+  static const int kMaxRawWaitYields = 1000;
+  const int old_fd = __atomic_exchange_n(&raw_fd_, fd, __ATOMIC_SEQ_CST);
+  if (old_fd < 0) return;
+  for (int i = 0; i < kMaxRawWaitYields; ++i) {
+    if (__atomic_load_n(&raw_writers_, __ATOMIC_SEQ_CST) == 0) {
+      close(old_fd);
+      return;
+    }
+    sched_yield();
+  }
+  // A writer is stuck (stopped, or interrupted by a long signal handler):
+  // leak the descriptor rather than let its write land in a file that
+  // reuses the number.
+}
+
+int LogFileObject::LogfileDescriptor() const {
+  if (direct_writer_ != NULL) return direct_writer_->fd();
+  if (ring_ != NULL) return ring_->fd();
+  if (file_ != NULL) return fileno(file_);
+  return -1;
+}
+
+void LogFileObject::AppendRecord(const char* data, size_t len) {
+  if (ring_ != NULL) {
+    // The ring has records of its own, and a constant size: file_length_
+    // stays 0 so that it never rolls over.
+    ring_->Append(data, len);
+    return;
+  }
+  if (!framed_) {
+    AppendToLogfile(data, len);
+    return;
+  }
+  if (framed_length_ == 0 ||
+      framed_length_ - last_sync_marker_ >= kLogSyncInterval) {
+    char marker[kLogSyncMarkerSize];
+    EncodeLogSyncMarker(framed_length_, marker);
+    last_sync_marker_ = framed_length_;
+    AppendToLogfile(marker, sizeof(marker));
+    framed_length_ += sizeof(marker);
+  }
+  char header[kLogFrameHeaderSize];
+  EncodeLogFrameHeader(data, len, header);
+  AppendToLogfile(header, sizeof(header));
+  AppendToLogfile(data, len);
+  framed_length_ += sizeof(header) + len;
+}
+
+void LogFileObject::AppendToLogfile(const char* data, size_t len) {
+  if (compressor_ == NULL) {
+    WriteToLogfile(data, len);
+    return;
+  }
+  pending_block_.append(data, len);
+  if (pending_block_.size() >= kCompressBlockSize) CompressPendingBlock();
+}
+
+void LogFileObject::CompressPendingBlock() {
+  if (pending_block_.empty()) return;
+  string block;
+  if (!compressor_->CompressBlock(pending_block_.data(),
+                                  pending_block_.size(), &block)) {
+    // Don't lose the data: store it uncompressed, in a gzip member that
+    // any reader of the file still decodes.
+    block.clear();
+    LogCompressor::StoreBlock(pending_block_.data(), pending_block_.size(),
+                              &block);
+  }
+  WriteToLogfile(block.data(), block.size());
+  pending_block_.clear();
+}
+
+void LogFileObject::WriteToLogfile(const char* data, size_t len) {
+  if (direct_writer_ != NULL) {
+    direct_writer_->Append(data, len);
+    if (direct_writer_->error() != 0) errno = direct_writer_->error();
+  } else {
+    fwrite(data, 1, len, file_);
+  }
+  file_length_ += len;
+}
+
+void LogFileObject::CloseLogfile() {
+  SetRawDescriptor(-1);
+  if (compressor_ != NULL) {
+    CompressPendingBlock();
+    delete compressor_;
+    compressor_ = NULL;
+  }
+  if (index_ != NULL) {
+    index_->Close();
+    delete index_;
+    index_ = NULL;
+  }
+  // Writes that are waiting in Sync() can't be synced once the file is
+  // gone, so make them durable now.
+  if (FLAGS_logsynclevel < NUM_SEVERITIES && HasLogfile()) {
+    FlushUnlocked();
+    fdatasync(LogfileDescriptor());
+    LogStats::Add(LogStats::kSyncs);
+    CondVarLock l(&sync_cv_);
+    if (write_seq_ > synced_seq_) synced_seq_ = write_seq_;
+    sync_cv_.SignalAll();
+  }
+  if (ring_ != NULL) {
+    ring_->Close();
+    delete ring_;
+    ring_ = NULL;
+  }
+  if (direct_writer_ != NULL) {
+    const bool inherited = !direct_writer_->OwnedByThisProcess();
+    direct_writer_->Close();
+    // An inherited writer is leaked: its buffers are still the parent's
+    // pages, and destroying its condition variable would wait for the
+    // parent's writer thread, which may have been waiting on it.
+    if (!inherited) delete direct_writer_;
+    direct_writer_ = NULL;
+  }
+  if (file_ != NULL) {
+    if (FLAGS_log_drop_page_cache) {
+      fflush(file_);
+      DropPageCache(true);
+    }
+    fclose(file_);
+    file_ = NULL;
+  }
+  page_cache_dropped_ = page_cache_written_ = 0;
+}
+
+void LogFileObject::DropPageCache(bool force) {
+  if (force ? file_length_ == page_cache_dropped_
+            : file_length_ - page_cache_written_ < kDropPageCacheChunk) {
+    return;
+  }
+  // DONTNEED only drops clean pages, but waiting for write-back here
+  // would hold every logging thread on lock_.  So only start write-back
+  // of the new data, and drop what the previous call started, which has
+  // had a chunk's worth of logging to complete.  When closing, drop
+  // whatever is clean already and leave the rest to the kernel.
+  const int fd = fileno(file_);
+  if (file_length_ > page_cache_written_) {
+    sync_file_range(fd, page_cache_written_,
+                    file_length_ - page_cache_written_,
+                    SYNC_FILE_RANGE_WRITE);
+  }
+  const uint32 drop_end = force ? file_length_ : page_cache_written_;
+  if (drop_end > page_cache_dropped_) {
+    posix_fadvise(fd, page_cache_dropped_, drop_end - page_cache_dropped_,
+                  POSIX_FADV_DONTNEED);
+  }
+  page_cache_written_ = file_length_;
+  // The kernel keeps the last partial page; retry it next time.
+  page_cache_dropped_ = drop_end & ~(getpagesize() - 1);
+}
+
+bool LogFileObject::OpenRingLogfile() {
+  static bool warned = false;
+  if (!warned && (FLAGS_log_compress || FLAGS_log_framing ||
+                  FLAGS_log_index_interval_kb > 0 || FLAGS_log_direct_io)) {
+    warned = true;
+    fprintf(stderr, "--log_ring_size_mb ignores --log_compress, "
+            "--log_framing, --log_index_interval_kb and --log_direct_io\n");
+  }
+  // No time or pid in the name: a restarted process continues the ring.
+  // But if another process (or a forked parent) still writes it, this
+  // one gets a ring of its own.
+  const uint64 capacity = static_cast<uint64>(FLAGS_log_ring_size_mb) << 20;
+  string filename = base_filename_ + filename_extension_ + "ring";
+  ring_ = new RingLogFile;
+  bool ok = ring_->Open(filename, capacity);
+  if (!ok && errno == EWOULDBLOCK) {
+    char pid[16];
+    snprintf(pid, sizeof(pid), ".%d", static_cast<int>(getpid()));
+    filename += pid;
+    ok = ring_->Open(filename, capacity);
+  }
+  if (!ok) {
+    delete ring_;
+    ring_ = NULL;
+    return false;
+  }
+  return true;
 }
 
 bool LogFileObject::CreateLogfile(const char* time_pid_string) {
+  if (FLAGS_log_ring_size_mb > 0) return OpenRingLogfile();
   string string_filename = base_filename_+filename_extension_+
                            time_pid_string;
+  if (FLAGS_log_compress) string_filename += ".gz";
   const char* filename = string_filename.c_str();
   // Make sure the file doesn't exist.
   // File can be read by all, and can be written by user and group.
@@ -152,12 +490,36 @@ bool LogFileObject::CreateLogfile(const char* time_pid_string) {
   // Mark the file close-on-exec. We don't really care if this fails
   fcntl(fd, F_SETFD, FD_CLOEXEC);
 
-  file_ = fdopen(fd, "a");  // Make a FILE*.
-  if (file_ == NULL) {  // Man, we're screwed!
+  if (FLAGS_log_direct_io) {
+    direct_writer_ = new DirectFileWriter;
+    if (!direct_writer_->Attach(fd)) {
+      // No O_DIRECT here (tmpfs, some network file systems...):
+      // fall back to ordinary buffered writes.
+      delete direct_writer_;
+      direct_writer_ = NULL;
+    }
+  }
+
+  if (direct_writer_ == NULL) file_ = fdopen(fd, "a");  // Make a FILE*.
+  if (direct_writer_ == NULL && file_ == NULL) {  // Man, we're screwed!
     close(fd);
     unlink(filename);  // Erase the half-baked evidence: an unusable log file
     return false;
   }
+  if (FLAGS_log_compress) compressor_ = new LogCompressor;
+  framed_ = FLAGS_log_framing;
+  framed_length_ = last_sync_marker_ = 0;
+  if (FLAGS_log_index_interval_kb > 0) {
+    index_ = new LogIndexWriter;
+    if (!index_->Open(string_filename + ".idx",
+                      FLAGS_log_index_interval_kb * 1024)) {
+      delete index_;  // Log without an index rather than not at all.
+      index_ = NULL;
+    }
+  }
+  if (file_ != NULL && compressor_ == NULL && !framed_ && index_ == NULL) {
+    SetRawDescriptor(dup(fileno(file_)));
+  }
 
   // We try to create a symlink called <program_name>.<severity>,
   // which is easier to use.  (Every time we create a new logfile,
@@ -205,21 +567,30 @@ void LogFileObject::Write(bool force_flush,
     return;
   }
 
+  // When a rollover started, if it is timed.
+  int64 rollover_start = 0;
+  // PidHasChanged() is true for one LogFileObject only, but no file
+  // may be shared with the parent of a fork() in ring mode, nor a
+  // direct writer, whose thread stayed in the parent.
   if (static_cast<int>(file_length_ >> 20) >= MaxLogSize() ||
-      PidHasChanged()) {
-    if (file_ != NULL) fclose(file_);
-    file_ = NULL;
+      PidHasChanged() || (ring_ != NULL && !ring_->OwnedByThisProcess()) ||
+      (direct_writer_ != NULL && !direct_writer_->OwnedByThisProcess())) {
+    if (LogStats::enabled()) rollover_start = MonotonicNanos();
+    CloseLogfile();
     file_length_ = bytes_since_flush_ = 0;
     rollover_attempt_ = kRolloverAttemptFrequency-1;
   }
 
   // If there's no destination file, make one before outputting
-  if (file_ == NULL) {
+  if (!HasLogfile()) {
     // Try to rollover the log file every 32 log messages.  The only time
     // this could matter would be when we have trouble creating the log
     // file.  If that happens, we'll lose lots of log messages, of course!
     if (++rollover_attempt_ != kRolloverAttemptFrequency) return;
     rollover_attempt_ = 0;
+    if (rollover_start == 0 && LogStats::enabled()) {
+      rollover_start = MonotonicNanos();
+    }
 
     struct ::tm tm_time;
     localtime_r(&timestamp, &tm_time);
@@ -312,9 +683,15 @@ void LogFileObject::Write(bool force_flush,
                        << "threadid file:line] msg" << '\n'
                        << '\0';
     int header_len = strlen(file_header_string);
-    fwrite(file_header_string, 1, header_len, file_);
-    file_length_ += header_len;
+    AppendRecord(file_header_string, header_len);
     bytes_since_flush_ += header_len;
+    // Interned stack traces are written in full again in this file.
+    StackTraceTable::NewLogFile(severity_);
+
+    LogStats::Add(LogStats::kRollovers);
+    if (rollover_start != 0) {
+      LogStats::Record(LogStats::kRollover, MonotonicNanos() - rollover_start);
+    }
   }
 
   // Write to LOG file
@@ -325,26 +702,40 @@ void LogFileObject::Write(bool force_flush,
     // 4096 bytes. fwrite() returns 4096 for message lengths that are
     // greater than 4096, thereby indicating an error.
     errno = 0;
-    fwrite(message, 1, message_len, file_);
+    if (index_ != NULL && message_len > 0) {
+      // With --log_compress this is where the pending block will start.
+      index_->AddLine(file_length_, timestamp,
+                      LogLineSeverity(message, message_len, severity_));
+    }
+    const int64 write_start = LogStats::enabled() ? MonotonicNanos() : 0;
+    AppendRecord(message, message_len);
+    if (write_start != 0) {
+      LogStats::Record(LogStats::kWrite, MonotonicNanos() - write_start);
+    }
+    if (index_ != NULL) index_->MaybeEndInterval(file_length_);
     if ( FLAGS_stop_logging_if_full_disk &&
          errno == ENOSPC ) {  // disk full, stop writing to disk
       stop_writing = true;  // until the disk is
       return;
     } else {
-      file_length_ += message_len;
       bytes_since_flush_ += message_len;
+      if (message_len > 0) ++write_seq_;
     }
   } else {
-    if ( CycleClock_Now() >= next_flush_time_ )
+    LogStats::Add(LogStats::kDroppedDiskFull);
+    if ( LogEveryTNowNanos() >= next_flush_time_ )
       stop_writing = false;  // check to see if disk has free space.
     return;  // no need to flush
   }
 
   // See important msgs *now*.  Also, flush logs at least every 10^6 chars,
-  // or every "FLAGS_logbufsecs" seconds.
-  if ( force_flush ||
+  // or every "FLAGS_logbufsecs" seconds.  For a compressed file every
+  // flush ends a gzip member; --log_compress_defer_flush trades the
+  // forced ones for fewer members.
+  const bool defer = compressor_ != NULL && FLAGS_log_compress_defer_flush;
+  if ( (force_flush && !defer) ||
        (bytes_since_flush_ >= 1000000) ||
-       (CycleClock_Now() >= next_flush_time_) ) {
+       (LogEveryTNowNanos() >= next_flush_time_) ) {
     FlushUnlocked();
   }
 }
@@ -14,6 +14,13 @@
 
 using std::string;
 
+_START_GOOGLE_NAMESPACE_
+class DirectFileWriter;
+class LogCompressor;
+class LogIndexWriter;
+class RingLogFile;
+_END_GOOGLE_NAMESPACE_
+
 // A Logger is the interface used by logging modules to emit entries
 // to a log.  A typical implementation will dump formatted data to a
 // sequence of files.  We also provide interfaces that will forward
@@ -86,11 +93,34 @@ public:
     return file_length_;
   }
 
+  // Wait until everything written so far has reached the disk
+  // (fdatasync).  Threads that call this concurrently share a single
+  // fdatasync: one of them syncs on behalf of everybody that is waiting,
+  // so the cost is amortized across a burst of ERROR lines.
+  // Must be called without lock_ held.
+  void Sync();
+
+  // For tests: have the thread that leads a Sync() call "hook" (or
+  // nothing, if NULL) just before its fdatasync(), with no lock held.
+  static void SetSyncHook(void (*hook)());
+
   // Internal flush routine.  Exposed so that FlushLogFilesUnsafe()
   // can avoid grabbing a lock.  Usually Flush() calls it after
   // acquiring lock_.
   void FlushUnlocked();
 
+  // Append "data[0,len-1]" to the log file with a single write(),
+  // without locking or allocating, for RAW_LOG().  Only plain files
+  // take raw writes: not ring, direct I/O, compressed, framed or indexed
+  // ones, whose format they would break.  It bypasses the FILE buffer,
+  // so it can come out before messages Write() buffered earlier.
+  void WriteRaw(const char* data, size_t len);
+
+  // Push out what is buffered in memory without locking or allocating,
+  // for the failure signal handler.  Data waiting for the compressor is
+  // lost.
+  void FlushUnsafe();
+
  private:
   static const uint32 kRolloverAttemptFrequency = 0x20;
 
@@ -100,16 +130,82 @@ public:
   string symlink_basename_;
   string filename_extension_;     // option users can specify (eg to add port#)
   FILE* file_;
+  DirectFileWriter* direct_writer_;  // Used instead of file_ for O_DIRECT
+  RingLogFile* ring_;             // Used instead of file_ in ring mode
+  LogCompressor* compressor_;     // Non-NULL if this file is compressed
+  string pending_block_;          // Not yet compressed data
+  LogIndexWriter* index_;         // Non-NULL if this file is indexed
+  bool framed_;                   // Is this file written in records?
+  uint64 framed_length_;          // Bytes of framed data so far
+  uint64 last_sync_marker_;       // Offset of the last sync marker
   LogSeverity severity_;
   uint32 bytes_since_flush_;
   uint32 file_length_;
   unsigned int rollover_attempt_;
-  int64 next_flush_time_;         // cycle count at which to flush log
+  int64 next_flush_time_;         // LogEveryTNowNanos() at which to flush
+  uint32 page_cache_dropped_;     // bytes already dropped from page cache
+  uint32 page_cache_written_;     // bytes whose write-back was started
+  uint64 write_seq_;              // number of Write()s with data so far
+  int raw_fd_;                    // atomic: dup() of the file for
+                                  // WriteRaw(), or -1
+  int raw_writers_;               // atomic: WriteRaw()s using raw_fd_
+
+  // Group commit state for Sync().  Lock order: lock_ before sync_cv_.
+  CondVar sync_cv_;
+  uint64 synced_seq_;             // under sync_cv_: writes known durable
+  bool sync_in_progress_;         // under sync_cv_: a leader is syncing
 
   // Actually create a logfile using the value of base_filename_ and the
   // supplied argument time_pid_string
   // REQUIRES: lock_ is held
   bool CreateLogfile(const char* time_pid_string);
+
+  // Open (or continue) the ring log file (--log_ring_size_mb).
+  // REQUIRES: lock_ is held
+  bool OpenRingLogfile();
+
+  // Is there a log file to write to?
+  // REQUIRES: lock_ is held
+  bool HasLogfile() const {
+    return file_ != NULL || direct_writer_ != NULL || ring_ != NULL;
+  }
+
+  // Append one Write()'s worth of data to the current log file, as a
+  // checksummed record if the file is framed (--log_framing).
+  // REQUIRES: lock_ is held and HasLogfile()
+  void AppendRecord(const char* data, size_t len);
+
+  // Append log data to the current log file, going through the
+  // compressor if there is one.
+  // REQUIRES: lock_ is held and HasLogfile()
+  void AppendToLogfile(const char* data, size_t len);
+
+  // Compress pending_block_ and write it out as one gzip member.
+  // REQUIRES: lock_ is held
+  void CompressPendingBlock();
+
+  // Append raw bytes to the current log file.
+  // REQUIRES: lock_ is held and HasLogfile()
+  void WriteToLogfile(const char* data, size_t len);
+
+  // The descriptor of the current log file, or -1.
+  // REQUIRES: lock_ is held
+  int LogfileDescriptor() const;
+
+  // Make "fd" (or -1) the descriptor of WriteRaw(), and close the one
+  // it replaces once no WriteRaw() uses it.
+  // REQUIRES: lock_ is held
+  void SetRawDescriptor(int fd);
+
+  // Close the current log file, if any.
+  // REQUIRES: lock_ is held
+  void CloseLogfile();
+
+  // Start write-back of what has been flushed since the last call, and
+  // tell the kernel we won't read what the last call wrote back again
+  // (--log_drop_page_cache).  With "force", also drop what is clean now.
+  // REQUIRES: lock_ is held
+  void DropPageCache(bool force);
 };
 
 _END_GOOGLE_NAMESPACE_
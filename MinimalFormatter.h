@@ -0,0 +1,77 @@
+/*
+ * MinimalFormatter.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#ifndef MINIMALFORMATTER_H_
+#define MINIMALFORMATTER_H_
+
+#include <stddef.h>
+#include "config.h"
+#include "basic_type.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// Appends to a fixed buffer without snprintf(), which isn't
+// async-signal-safe, for RAW_LOG() and the failure signal handler.
+// Output that doesn't fit is dropped.
+class MinimalFormatter {
+public:
+  MinimalFormatter(char* buffer, size_t size)
+    : begin_(buffer), cur_(buffer), end_(buffer + size) { }
+
+  void AppendChar(char c) {
+    if (cur_ < end_) *cur_++ = c;
+  }
+
+  void AppendString(const char* str) {
+    while (*str != '\0' && cur_ < end_) *cur_++ = *str++;
+  }
+
+  // "n" in "base" (up to 16), padded with "pad" to "width" characters.
+  void AppendUint64(uint64 n, int base, int width = 0, char pad = '0') {
+    char digits[64];
+    int i = 0;
+    do {
+      digits[i++] = "0123456789abcdef"[n % base];
+      n /= base;
+    } while (n > 0);
+    for (; width > i; --width) AppendChar(pad);
+    while (i > 0) AppendChar(digits[--i]);
+  }
+
+  void AppendInt64(int64 n) {
+    if (n < 0) {
+      AppendChar('-');
+      AppendUint64(-static_cast<uint64>(n), 10);
+    } else {
+      AppendUint64(n, 10);
+    }
+  }
+
+  void AppendHex(uint64 n) {
+    AppendString("0x");
+    AppendUint64(n, 16);
+  }
+
+  const char* data() const { return begin_; }
+  size_t size() const { return cur_ - begin_; }
+  size_t remaining() const { return end_ - cur_; }
+  char* cur() { return cur_; }
+
+  // Account for "n" bytes written at cur() by someone else.
+  void Advance(size_t n) { cur_ += n < remaining() ? n : remaining(); }
+
+  void Clear() { cur_ = begin_; }
+
+private:
+  char* const begin_;
+  char* cur_;
+  char* const end_;
+};
+
+_END_GOOGLE_NAMESPACE_
+
+#endif /* MINIMALFORMATTER_H_ */
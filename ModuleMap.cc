@@ -0,0 +1,110 @@
+/*
+ * ModuleMap.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#include "ModuleMap.h"
+#include <elf.h>
+#include <fcntl.h>
+#include <link.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "LoadedModules.h"
+
+using std::string;
+
+_START_GOOGLE_NAMESPACE_
+
+void ModuleMap::Dump(void* const* pcs, int depth, Writer* writer, void* arg) {
+  LoadedModules::Reader reader;
+  const LoadedModules::Snapshot* snapshot = reader.snapshot();
+  if (snapshot == NULL) return;
+  for (size_t m = 0; m < snapshot->count; ++m) {
+    const LoadedModules::Module& module = snapshot->modules[m];
+    bool used = false;
+    for (int i = 0; i < depth && !used; ++i) {
+      // Return addresses: the call is the byte before.
+      const uintptr_t pc = reinterpret_cast<uintptr_t>(pcs[i]) - 1;
+      used = module.start <= pc && pc < module.end;
+    }
+    if (!used) continue;
+
+    char line[256];
+    snprintf(line, sizeof(line), "    module 0x%llx-0x%llx bias 0x%llx "
+             "build-id %s ",
+             static_cast<unsigned long long>(module.start),
+             static_cast<unsigned long long>(module.end),
+             static_cast<unsigned long long>(module.bias), module.build_id);
+    writer(line, arg);
+    writer(module.path, arg);
+    writer("\n", arg);
+  }
+}
+
+bool ModuleMap::ParseLine(const char* line, Module* module) {
+  while (*line == ' ' || *line == '\t') ++line;
+  char build_id[LoadedModules::kMaxBuildIdHex];
+  int consumed = 0;
+  if (sscanf(line, "module 0x%llx-0x%llx bias 0x%llx build-id %128s %n",
+             &module->start, &module->end, &module->bias, build_id,
+             &consumed) != 4 || consumed == 0) {
+    return false;
+  }
+  module->build_id = strcmp(build_id, "-") == 0 ? "" : build_id;
+  module->path = line + consumed;
+  while (!module->path.empty() &&
+         (module->path[module->path.size() - 1] == '\n' ||
+          module->path[module->path.size() - 1] == '\r')) {
+    module->path.resize(module->path.size() - 1);
+  }
+  return !module->path.empty() && module->start < module->end;
+}
+
+bool ModuleMap::ReadBuildId(const char* path, string* build_id) {
+  const int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      st.st_size < static_cast<off_t>(sizeof(ElfW(Ehdr)))) {
+    close(fd);
+    return false;
+  }
+  const size_t size = st.st_size;
+  void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return false;
+
+  // Sections rather than PT_NOTE: separate debug files (objcopy
+  // --only-keep-debug) keep the note but not the segment contents.
+  bool found = false;
+  const char* base = static_cast<const char*>(map);
+  const ElfW(Ehdr)* header = reinterpret_cast<const ElfW(Ehdr)*>(base);
+  if (memcmp(header->e_ident, ELFMAG, SELFMAG) == 0 &&
+      header->e_shentsize == sizeof(ElfW(Shdr)) &&
+      header->e_shoff + header->e_shnum * sizeof(ElfW(Shdr)) <= size) {
+    const ElfW(Shdr)* sections =
+        reinterpret_cast<const ElfW(Shdr)*>(base + header->e_shoff);
+    char hex[LoadedModules::kMaxBuildIdHex];
+    for (int i = 0; i < header->e_shnum && !found; ++i) {
+      const ElfW(Shdr)& section = sections[i];
+      if (section.sh_type != SHT_NOTE ||
+          section.sh_offset + section.sh_size > size) {
+        continue;
+      }
+      found = LoadedModules::FindBuildId(base + section.sh_offset,
+                                         section.sh_size,
+                                         section.sh_addralign == 8 ? 8 : 4,
+                                         hex, sizeof(hex));
+    }
+    if (found) *build_id = hex;
+  }
+  munmap(map, size);
+  return found;
+}
+
+_END_GOOGLE_NAMESPACE_
@@ -0,0 +1,56 @@
+/*
+ * ModuleMap.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#ifndef MODULEMAP_H_
+#define MODULEMAP_H_
+
+#include <string>
+#include "config.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// The table of loaded modules that goes with the raw pcs of a stack trace
+// logged with --symbolize_offline, so that tools/logsymbolize can
+// symbolize it later, against the same (or unstripped) binaries.
+//
+// Each module is one line:
+//
+//     module 0x<start>-0x<end> bias 0x<bias> build-id <hex or -> <path>
+//
+// where <start>-<end> are the run-time addresses of its loaded segments,
+// and <bias> is what was added to the link-time addresses of its symbols
+// (0 for non-PIE executables).  The GNU build-id tells whether a binary
+// found later is the one that was running.
+class ModuleMap {
+public:
+  typedef void Writer(const char* data, void* arg);
+
+  struct Module {
+    unsigned long long start;
+    unsigned long long end;
+    unsigned long long bias;
+    std::string build_id;   // "" if the module has none
+    std::string path;
+  };
+
+  // Write the lines of the modules that contain any of pcs[0..depth),
+  // from the last LoadedModules::Refresh(): modules loaded since then are
+  // missing.
+  // Doesn't allocate or lock, so it can be used on the crash path, even
+  // when crashing inside dlopen() or dlclose().
+  static void Dump(void* const* pcs, int depth, Writer* writer, void* arg);
+
+  // Parse a line written by Dump(); leading blanks are skipped.
+  static bool ParseLine(const char* line, Module* module);
+
+  // Read the GNU build-id of the ELF file "path" as hex.
+  static bool ReadBuildId(const char* path, std::string* build_id);
+};
+
+_END_GOOGLE_NAMESPACE_
+
+#endif /* MODULEMAP_H_ */
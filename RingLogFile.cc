@@ -0,0 +1,244 @@
+/*
+ * RingLogFile.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#include "RingLogFile.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::string;
+
+_START_GOOGLE_NAMESPACE_
+
+const char RingLogFile::kMagic[8] = { 'G', 'L', 'O', 'G', 'R', 'I', 'N', 'G' };
+
+static const size_t kRecordHeaderSize = sizeof(uint32);
+
+RingLogFile::RingLogFile()
+  : fd_(-1), pid_(0), map_(NULL), map_size_(0), header_(NULL), data_(NULL),
+    capacity_(0) {
+}
+
+RingLogFile::~RingLogFile() {
+  Close();
+}
+
+bool RingLogFile::Open(const string& filename, uint64 capacity) {
+  fd_ = open(filename.c_str(), O_RDWR | O_CREAT, 0664);
+  if (fd_ == -1) return false;
+  // Mark the file close-on-exec. We don't really care if this fails
+  fcntl(fd_, F_SETFD, FD_CLOEXEC);
+  // Two writers would corrupt head and tail.  The lock belongs to the
+  // open file, so a forked child holds it only as long as the parent.
+  if (flock(fd_, LOCK_EX | LOCK_NB) != 0) {
+    const int saved_errno = errno;
+    Close();
+    errno = saved_errno;
+    return false;
+  }
+  pid_ = getpid();
+
+  map_size_ = kHeaderSize + capacity;
+  struct stat st;
+  Header existing;
+  const bool reuse =
+      fstat(fd_, &st) == 0 && static_cast<uint64>(st.st_size) == map_size_ &&
+      pread(fd_, &existing, sizeof(existing), 0) == sizeof(existing) &&
+      memcmp(existing.magic, kMagic, sizeof(kMagic)) == 0 &&
+      existing.version == kVersion && existing.header_size == kHeaderSize &&
+      existing.capacity == capacity && existing.head <= existing.tail &&
+      existing.tail - existing.head <= capacity;
+  if (!reuse) {
+    // Allocate every block now so that writing never fails for lack of
+    // space, and never has to extend the file.
+    if (ftruncate(fd_, 0) != 0 ||
+        posix_fallocate(fd_, 0, map_size_) != 0) {
+      Close();
+      return false;
+    }
+  }
+  void* map = mmap(NULL, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   fd_, 0);
+  if (map == MAP_FAILED) {
+    map_ = NULL;
+    Close();
+    return false;
+  }
+  map_ = static_cast<char*>(map);
+  header_ = reinterpret_cast<Header*>(map_);
+  data_ = map_ + kHeaderSize;
+  capacity_ = capacity;
+  if (reuse && !RecordsAreConsistent()) {
+    // A torn or foreign write: Append() can't trust the lengths.
+    header_->head = header_->tail = header_->generation = 0;
+  }
+  if (!reuse) {
+    memset(header_, 0, sizeof(*header_));
+    header_->version = kVersion;
+    header_->header_size = kHeaderSize;
+    header_->capacity = capacity;
+    __sync_synchronize();
+    memcpy(header_->magic, kMagic, sizeof(kMagic));
+  }
+  return true;
+}
+
+void RingLogFile::CopyIn(uint64 pos, const char* data, size_t len) {
+  const size_t offset = pos % capacity_;
+  const size_t first = len < capacity_ - offset ? len : capacity_ - offset;
+  memcpy(data_ + offset, data, first);
+  memcpy(data_, data + first, len - first);
+}
+
+uint32 RingLogFile::RecordLength(uint64 pos) const {
+  uint32 len;
+  const size_t offset = pos % capacity_;
+  const size_t first = sizeof(len) < capacity_ - offset ?
+                       sizeof(len) : capacity_ - offset;
+  char* p = reinterpret_cast<char*>(&len);
+  memcpy(p, data_ + offset, first);
+  memcpy(p + first, data_, sizeof(len) - first);
+  return len;
+}
+
+bool RingLogFile::RecordsAreConsistent() const {
+  const uint64 tail = header_->tail;
+  uint64 pos = header_->head;
+  while (tail - pos >= kRecordHeaderSize) {
+    const uint32 len = RecordLength(pos);
+    if (len > tail - pos - kRecordHeaderSize) return false;
+    pos += kRecordHeaderSize + len;
+  }
+  return pos == tail;
+}
+
+void RingLogFile::Append(const char* data, size_t len) {
+  if (header_ == NULL) return;
+  if (len > capacity_ - kRecordHeaderSize) {
+    len = capacity_ - kRecordHeaderSize;
+  }
+  const uint64 need = kRecordHeaderSize + len;
+  const uint64 tail = header_->tail;
+  uint64 head = header_->head;
+  while (tail + need - head > capacity_) {
+    const uint64 next = head + kRecordHeaderSize + RecordLength(head);
+    if (next > tail) {
+      // Overwritten behind our back: drop everything rather than let
+      // head pass tail.
+      head = tail;
+      break;
+    }
+    head = next;
+  }
+  if (head != header_->head) {
+    header_->head = head;
+    // Readers must see the records go before they are overwritten.
+    __sync_synchronize();
+  }
+  const uint32 record_len = len;
+  CopyIn(tail, reinterpret_cast<const char*>(&record_len), sizeof(record_len));
+  CopyIn(tail + kRecordHeaderSize, data, len);
+  __sync_synchronize();
+  header_->tail = tail + need;
+  header_->generation = (tail + need) / capacity_;
+}
+
+void RingLogFile::Flush() {
+  if (map_ != NULL) msync(map_, map_size_, MS_ASYNC);
+}
+
+void RingLogFile::Close() {
+  if (map_ != NULL) {
+    munmap(map_, map_size_);
+    map_ = NULL;
+    header_ = NULL;
+    data_ = NULL;
+  }
+  if (fd_ != -1) {
+    close(fd_);
+    fd_ = -1;
+  }
+  pid_ = 0;
+}
+
+RingLogReader::RingLogReader()
+  : fd_(-1), map_(NULL), map_size_(0), data_(NULL), pos_(0),
+    lost_bytes_(0) {
+  memset(&header_, 0, sizeof(header_));
+}
+
+RingLogReader::~RingLogReader() {
+  if (map_ != NULL) munmap(const_cast<char*>(map_), map_size_);
+  if (fd_ != -1) close(fd_);
+}
+
+bool RingLogReader::Open(const string& filename) {
+  fd_ = open(filename.c_str(), O_RDONLY);
+  struct stat st;
+  if (fd_ == -1 || fstat(fd_, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(header_)) {
+    return false;
+  }
+  map_size_ = st.st_size;
+  void* map = mmap(NULL, map_size_, PROT_READ, MAP_SHARED, fd_, 0);
+  if (map == MAP_FAILED) return false;
+  map_ = static_cast<const char*>(map);
+  memcpy(&header_, map_, sizeof(header_));
+  if (memcmp(header_.magic, RingLogFile::kMagic, sizeof(header_.magic)) != 0 ||
+      header_.version != RingLogFile::kVersion ||
+      header_.capacity == 0 ||
+      header_.header_size + header_.capacity != map_size_ ||
+      header_.head > header_.tail ||
+      header_.tail - header_.head > header_.capacity) {
+    return false;
+  }
+  data_ = map_ + header_.header_size;
+  pos_ = header_.head;
+  return true;
+}
+
+bool RingLogReader::Next(string* record) {
+  const volatile RingLogFile::Header* live =
+      reinterpret_cast<const volatile RingLogFile::Header*>(map_);
+  while (pos_ + kRecordHeaderSize <= header_.tail) {
+    const uint64 capacity = header_.capacity;
+    char buf[sizeof(uint32)];
+    for (size_t i = 0; i < sizeof(buf); ++i) {
+      buf[i] = data_[(pos_ + i) % capacity];
+    }
+    uint32 len;
+    memcpy(&len, buf, sizeof(len));
+    const uint64 end = pos_ + kRecordHeaderSize + len;
+    if (end <= header_.tail) {
+      record->resize(len);
+      const size_t offset = (pos_ + kRecordHeaderSize) % capacity;
+      const size_t first = len < capacity - offset ? len : capacity - offset;
+      if (len > 0) {
+        memcpy(&(*record)[0], data_ + offset, first);
+        memcpy(&(*record)[first], data_, len - first);
+      }
+    }
+    // The writer may have reused this space meanwhile.
+    __sync_synchronize();
+    const uint64 head = live->head;
+    if (head > pos_ || end > header_.tail) {
+      const uint64 resume = head > pos_ ? head : header_.tail;
+      lost_bytes_ += resume - pos_;
+      pos_ = resume;
+      continue;
+    }
+    pos_ = end;
+    return true;
+  }
+  return false;
+}
+
+_END_GOOGLE_NAMESPACE_
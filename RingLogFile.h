@@ -0,0 +1,138 @@
+/*
+ * RingLogFile.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#ifndef RINGLOGFILE_H_
+#define RINGLOGFILE_H_
+
+#include <stddef.h>
+#include <unistd.h>
+#include <string>
+#include "config.h"
+#include "basic_type.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// A log file of constant size that is written as a ring (--log_ring_size_mb),
+// for appliances and sidecars whose disk usage has to stay bounded.
+//
+// The file is preallocated once and mmapped.  It starts with a one page
+// header, followed by the data area:
+//
+//   char   magic[8]       "GLOGRING"
+//   uint32 version
+//   uint32 header_size    offset of the data area
+//   uint64 capacity       size of the data area
+//   uint64 head           position of the oldest record
+//   uint64 tail           position where the next record goes
+//   uint64 generation     number of times the writer wrapped around
+//
+// head and tail are positions in the stream of everything ever written
+// (they only grow); the byte at position p is at data[p % capacity].
+// Each record is a uint32 length followed by the payload and may wrap
+// around the end of the data area.  To make room, whole records are
+// dropped from the head.  head is moved before a record is copied in and
+// tail after it, so a crash leaves at worst one record missing.
+//
+// The file is never rolled over or unlinked: a restarted process keeps
+// appending to the same ring, after checking that the records from head
+// to tail still chain up (else the ring is reset).  Only one process
+// writes a ring at a time: Open() takes an exclusive flock() on it.
+class RingLogFile {
+public:
+  static const char kMagic[8];
+  static const uint32 kVersion = 1;
+  static const uint32 kHeaderSize = 4096;
+
+  struct Header {
+    char magic[8];
+    uint32 version;
+    uint32 header_size;
+    uint64 capacity;
+    uint64 head;
+    uint64 tail;
+    uint64 generation;
+  };
+
+  RingLogFile();
+  ~RingLogFile();
+
+  // Open (or create and preallocate) the ring file "filename" with a data
+  // area of "capacity" bytes.  An existing ring of the same capacity is
+  // continued if its records are consistent; anything else at that path
+  // is reinitialized.  Returns false with errno EWOULDBLOCK if another
+  // RingLogFile (in this or another process) has the file open.
+  bool Open(const std::string& filename, uint64 capacity);
+
+  // Append "data[0,len-1]" as one record, dropping the oldest records if
+  // needed.  Records that don't fit in the ring at all are truncated.
+  void Append(const char* data, size_t len);
+
+  // Start write-back of dirty pages.
+  void Flush();
+
+  void Close();
+
+  int fd() const { return fd_; }
+
+  // Was the ring opened by this process, not inherited through fork()?
+  bool OwnedByThisProcess() const { return pid_ == getpid(); }
+
+private:
+  void CopyIn(uint64 pos, const char* data, size_t len);
+  uint32 RecordLength(uint64 pos) const;
+
+  // Do the records from head to tail chain up exactly to tail?
+  bool RecordsAreConsistent() const;
+
+  int fd_;
+  pid_t pid_;
+  char* map_;
+  size_t map_size_;
+  Header* header_;
+  char* data_;
+  uint64 capacity_;
+
+  // Disallow
+  RingLogFile(const RingLogFile&);
+  void operator=(const RingLogFile&);
+};
+
+// Reads the records of a ring log file, oldest first.  The ring may be
+// written concurrently; records that are overwritten while they are
+// being read are detected and reported as lost.
+class RingLogReader {
+public:
+  RingLogReader();
+  ~RingLogReader();
+
+  bool Open(const std::string& filename);
+
+  // Copy the next record into "*record".  Returns false at the end.
+  bool Next(std::string* record);
+
+  const RingLogFile::Header& header() const { return header_; }
+
+  // Bytes of records that were overwritten before they could be read.
+  uint64 lost_bytes() const { return lost_bytes_; }
+
+private:
+  int fd_;
+  const char* map_;
+  size_t map_size_;
+  RingLogFile::Header header_;   // snapshot taken by Open()
+  const char* data_;
+  uint64 pos_;
+  uint64 lost_bytes_;
+
+  // Disallow
+  RingLogReader(const RingLogReader&);
+  void operator=(const RingLogReader&);
+};
+
+_END_GOOGLE_NAMESPACE_
+
+#endif /* RINGLOGFILE_H_ */
@@ -0,0 +1,49 @@
+/*
+ * StackBounds.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#include "StackBounds.h"
+#include <pthread.h>
+#include <signal.h>
+
+_START_GOOGLE_NAMESPACE_
+
+__thread StackBounds::Bounds StackBounds::bounds_;
+
+// The signal stack of the calling thread, or [0, 0).
+static void GetSignalStack(uintptr_t* low, uintptr_t* high) {
+  stack_t signal_stack;
+  if (sigaltstack(NULL, &signal_stack) == 0 &&
+      !(signal_stack.ss_flags & SS_DISABLE)) {
+    *low = reinterpret_cast<uintptr_t>(signal_stack.ss_sp);
+    *high = *low + signal_stack.ss_size;
+  } else {
+    *low = 0;
+    *high = 0;
+  }
+}
+
+void StackBounds::LearnSlow() {
+  bounds_.tried = true;
+  pthread_attr_t attr;
+  if (pthread_getattr_np(pthread_self(), &attr) != 0) return;
+  void* address;
+  size_t size;
+  const bool ok = pthread_attr_getstack(&attr, &address, &size) == 0;
+  pthread_attr_destroy(&attr);
+  if (!ok) return;
+
+  bounds_.stack_low = reinterpret_cast<uintptr_t>(address);
+  bounds_.stack_high = bounds_.stack_low + size;
+  GetSignalStack(&bounds_.signal_low, &bounds_.signal_high);
+  bounds_.known = true;
+}
+
+void StackBounds::UpdateSignalStack() {
+  GetSignalStack(&bounds_.signal_low, &bounds_.signal_high);
+}
+
+_END_GOOGLE_NAMESPACE_
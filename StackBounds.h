@@ -0,0 +1,97 @@
+/*
+ * StackBounds.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#ifndef STACKBOUNDS_H_
+#define STACKBOUNDS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// The stack of each thread, and its alternate signal stack if it has one,
+// so that the stack unwinders can check that a pointer is on a stack
+// before reading through it with a range check, instead of a system call
+// such as msync() per frame.
+//
+// Learning them isn't async-signal-safe (pthread_getattr_np() reads
+// /proc/self/maps for the main thread), so it is done ahead of time:
+// by InitGoogleLogging(), by the first LOG() of every thread and by
+// DumpStackTraceToString().  Crash handlers only read what was learned,
+// except for a signal stack installed since (CheckCurrentStack()).
+//
+// Code can also run on stacks that aren't either (ucontext, fibers,
+// coroutines).  An unwind that starts on one of these treats the bounds
+// as unknown, and the unwinders fall back to their plain sanity checks.
+class StackBounds {
+public:
+  // Learn the stacks of the calling thread, the first time only.
+  static void Learn() {
+    if (!bounds_.tried) LearnSlow();
+  }
+
+  // Whether the stacks of the calling thread are known, and the current
+  // unwind started on one of them (see CheckCurrentStack()).
+  static bool known() { return bounds_.known && !bounds_.elsewhere; }
+
+  // Whether [address, address + size) is on a stack of the calling
+  // thread.  REQUIRES: known()
+  static bool Contains(uintptr_t address, size_t size) {
+    return (bounds_.stack_low <= address &&
+            address + size <= bounds_.stack_high) ||
+           (bounds_.signal_low <= address &&
+            address + size <= bounds_.signal_high);
+  }
+
+  // Call before unwinding.  If the caller runs on a stack that isn't
+  // known, maybe a signal stack installed since Learn(), look it up again
+  // with sigaltstack(), which is async-signal-safe.  If it is on neither
+  // stack still, known() is false until the next call.
+  static void CheckCurrentStack() {
+    if (!bounds_.known) return;
+    char here;
+    const uintptr_t address = reinterpret_cast<uintptr_t>(&here);
+    bool on_known_stack = OnKnownStack(address);
+    if (!on_known_stack) {
+      UpdateSignalStack();
+      on_known_stack = OnKnownStack(address);
+    }
+    bounds_.elsewhere = !on_known_stack;
+  }
+
+  // Whether "address" is on the signal stack.  Frames on it are newer
+  // than those on the thread stack.  REQUIRES: known()
+  static bool OnSignalStack(uintptr_t address) {
+    return bounds_.signal_low <= address && address < bounds_.signal_high;
+  }
+
+private:
+  struct Bounds {
+    bool tried;
+    bool known;
+    bool elsewhere;           // the current unwind is on neither stack
+    uintptr_t stack_low;
+    uintptr_t stack_high;
+    uintptr_t signal_low;     // 0 if there is no signal stack
+    uintptr_t signal_high;
+  };
+
+  static bool OnKnownStack(uintptr_t address) {
+    return (bounds_.stack_low <= address && address < bounds_.stack_high) ||
+           OnSignalStack(address);
+  }
+
+  static void LearnSlow();
+  static void UpdateSignalStack();
+
+  static __thread Bounds bounds_;
+};
+
+_END_GOOGLE_NAMESPACE_
+
+#endif /* STACKBOUNDS_H_ */
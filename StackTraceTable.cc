@@ -0,0 +1,94 @@
+/*
+ * StackTraceTable.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#include "StackTraceTable.h"
+#include <stdint.h>
+#include "basic_type.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// Twice kMaxTraces slots keeps the probe sequences short.
+static const uint32 kNumSlots = 2 * StackTraceTable::kMaxTraces;
+static const int kIdBits = 16;
+static const uint64 kIdMask = (1 << kIdBits) - 1;
+
+// Each slot is 0, or hash << kIdBits | id.
+static uint64 slots[kNumSlots];
+static int next_id = 1;
+
+// Bumped when a new log file of the severity is opened.
+static uint32 file_generation[NUM_SEVERITIES];
+// file_generation + 1 when the trace was last written in full to the log
+// file of each severity; 0 if never.
+static uint32 emitted[StackTraceTable::kMaxTraces + 1][NUM_SEVERITIES];
+
+static uint64 HashStack(void* const* stack, int depth) {
+  uint64 hash = depth;
+  for (int i = 0; i < depth; ++i) {
+    hash = (hash ^ reinterpret_cast<uintptr_t>(stack[i])) *
+           0x9e3779b97f4a7c15ULL;
+    hash ^= hash >> 29;
+  }
+  // 48 bits, never 0 (an empty slot).
+  hash >>= kIdBits;
+  return hash != 0 ? hash : 1;
+}
+
+int StackTraceTable::Intern(void* const* stack, int depth, bool* first) {
+  *first = false;
+  const uint64 hash = HashStack(stack, depth);
+  int id = 0;   // allocated for this trace, once needed
+  for (uint32 probe = 0; probe < kNumSlots; ++probe) {
+    uint64* slot = &slots[(hash + probe) % kNumSlots];
+    uint64 value = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+    while (value == 0) {
+      if (id == 0) {
+        // Full: don't even count up.
+        if (__atomic_load_n(&next_id, __ATOMIC_RELAXED) > kMaxTraces) {
+          return 0;
+        }
+        id = __atomic_fetch_add(&next_id, 1, __ATOMIC_RELAXED);
+        if (id > kMaxTraces) return 0;
+      }
+      if (__atomic_compare_exchange_n(slot, &value, hash << kIdBits | id,
+                                      false, __ATOMIC_ACQ_REL,
+                                      __ATOMIC_ACQUIRE)) {
+        *first = true;
+        return id;
+      }
+      // Lost the slot; "value" is the winner's.
+    }
+    if (value >> kIdBits == hash) return value & kIdMask;
+  }
+  return 0;
+}
+
+bool StackTraceTable::Emitted(int id, LogSeverity severity) {
+  for (int i = severity; i >= 0; --i) {
+    const uint32 generation =
+        __atomic_load_n(&file_generation[i], __ATOMIC_RELAXED);
+    if (__atomic_load_n(&emitted[id][i], __ATOMIC_RELAXED) !=
+        generation + 1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void StackTraceTable::MarkEmitted(int id, LogSeverity severity) {
+  for (int i = severity; i >= 0; --i) {
+    const uint32 generation =
+        __atomic_load_n(&file_generation[i], __ATOMIC_RELAXED);
+    __atomic_store_n(&emitted[id][i], generation + 1, __ATOMIC_RELAXED);
+  }
+}
+
+void StackTraceTable::NewLogFile(LogSeverity severity) {
+  __atomic_add_fetch(&file_generation[severity], 1, __ATOMIC_RELAXED);
+}
+
+_END_GOOGLE_NAMESPACE_
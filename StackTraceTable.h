@@ -0,0 +1,55 @@
+/*
+ * StackTraceTable.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#ifndef STACKTRACETABLE_H_
+#define STACKTRACETABLE_H_
+
+#include "config.h"
+#include "logging.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// Gives each distinct stack trace a small id, for --intern_stacktraces:
+// DumpStackTraceToString() writes (and symbolizes) a trace in full the
+// first time only, and just its id after that.
+//
+// "The first time" is per log file: a trace is written in full again in
+// every new log file, and to the file of each severity.  It only counts
+// as written once the message that carries it has been written
+// (MarkEmitted()), not when the message was dropped on the way.  The one
+// exception is a message that itself starts a new log file: it was
+// formatted before, so it can carry only the id.
+//
+// Traces are told apart by a 48-bit hash of their pcs, which with at most
+// kMaxTraces traces makes a mix-up very unlikely.  The table is an open
+// addressing hash table of 64-bit words (hash and id), filled in with
+// compare-and-swap: it never locks and never shrinks.
+class StackTraceTable {
+public:
+  static const int kMaxTraces = 4096;
+
+  // The id (1, 2, ...) of the trace stack[0, depth), and whether this
+  // call added it; 0 once the table is full.  Two threads adding the
+  // same trace at the same time get the same id, and only one of them
+  // "first".
+  static int Intern(void* const* stack, int depth, bool* first);
+
+  // Whether trace "id" was written in full to each log file that a
+  // message of "severity" goes to (those of "severity" and below), since
+  // they were opened.
+  static bool Emitted(int id, LogSeverity severity);
+
+  // Trace "id" was written in full in a message of "severity".
+  static void MarkEmitted(int id, LogSeverity severity);
+
+  // A new log file of "severity" was opened: it has no traces yet.
+  static void NewLogFile(LogSeverity severity);
+};
+
+_END_GOOGLE_NAMESPACE_
+
+#endif /* STACKTRACETABLE_H_ */
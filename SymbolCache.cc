@@ -0,0 +1,279 @@
+/*
+ * SymbolCache.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#include "SymbolCache.h"
+#include <elf.h>
+#include <fcntl.h>
+#include <link.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "DemangleCache.h"
+#include "LoadedModules.h"
+#include "mutex.h"
+#include "utilities.h"
+
+using std::string;
+using std::vector;
+
+_START_GOOGLE_NAMESPACE_
+
+namespace {
+
+struct Symbol {
+  uint64 start;        // run-time address
+  uint64 size;
+  const char* name;    // in the mapped file
+};
+
+bool SymbolStartsBefore(const Symbol& a, const Symbol& b) {
+  return a.start < b.start;
+}
+
+class Module {
+public:
+  Module(const string& path, uint64 bias, uint64 start, uint64 end)
+    : path_(path), bias_(bias), start_(start), end_(end), indexed_(false),
+      map_(NULL), map_size_(0) {
+  }
+
+  ~Module() {
+    if (map_ != NULL) munmap(map_, map_size_);
+  }
+
+  const string& path() const { return path_; }
+  uint64 bias() const { return bias_; }
+  uint64 start() const { return start_; }
+  uint64 end() const { return end_; }
+  bool indexed() const { return indexed_; }
+
+  // Map the file and sort its symbols.  Failures leave no symbols.
+  void Index();
+
+  // The symbol containing "pc", or NULL.
+  const Symbol* Find(uint64 pc) const;
+
+private:
+  void AddSymbols(const ElfW(Shdr)* sections, int num_sections,
+                  ElfW(Word) type);
+
+  const string path_;
+  const uint64 bias_;       // dlpi_addr: run-time minus link-time address
+  const uint64 start_;      // of the lowest PT_LOAD segment
+  const uint64 end_;        // of the highest PT_LOAD segment
+  bool indexed_;
+  void* map_;
+  size_t map_size_;
+  vector<Symbol> symbols_;  // sorted by start
+
+  Module(const Module&);
+  void operator=(const Module&);
+};
+
+void Module::Index() {
+  indexed_ = true;
+  const int fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return;
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      st.st_size < static_cast<off_t>(sizeof(ElfW(Ehdr)))) {
+    close(fd);
+    return;
+  }
+  void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return;
+  map_ = map;
+  map_size_ = st.st_size;
+
+  const char* base = static_cast<const char*>(map_);
+  const ElfW(Ehdr)* header = reinterpret_cast<const ElfW(Ehdr)*>(base);
+  if (memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 ||
+      header->e_shentsize != sizeof(ElfW(Shdr)) ||
+      header->e_shoff + header->e_shnum * sizeof(ElfW(Shdr)) > map_size_) {
+    return;
+  }
+  const ElfW(Shdr)* sections =
+      reinterpret_cast<const ElfW(Shdr)*>(base + header->e_shoff);
+  // Like Symbolize(), prefer the full symbol table, and fall back to the
+  // dynamic one of stripped objects.
+  AddSymbols(sections, header->e_shnum, SHT_SYMTAB);
+  if (symbols_.empty()) AddSymbols(sections, header->e_shnum, SHT_DYNSYM);
+  std::stable_sort(symbols_.begin(), symbols_.end(), &SymbolStartsBefore);
+}
+
+void Module::AddSymbols(const ElfW(Shdr)* sections, int num_sections,
+                        ElfW(Word) type) {
+  const char* base = static_cast<const char*>(map_);
+  for (int i = 0; i < num_sections; ++i) {
+    const ElfW(Shdr)& symtab = sections[i];
+    if (symtab.sh_type != type || symtab.sh_entsize != sizeof(ElfW(Sym)) ||
+        symtab.sh_link >= static_cast<ElfW(Word)>(num_sections)) {
+      continue;
+    }
+    const ElfW(Shdr)& strtab = sections[symtab.sh_link];
+    if (symtab.sh_offset + symtab.sh_size > map_size_ ||
+        strtab.sh_offset + strtab.sh_size > map_size_) {
+      continue;
+    }
+    const ElfW(Sym)* syms =
+        reinterpret_cast<const ElfW(Sym)*>(base + symtab.sh_offset);
+    const size_t num_syms = symtab.sh_size / sizeof(ElfW(Sym));
+    symbols_.reserve(symbols_.size() + num_syms);
+    for (size_t j = 0; j < num_syms; ++j) {
+      const ElfW(Sym)& sym = syms[j];
+      if (sym.st_value == 0 || sym.st_shndx == SHN_UNDEF ||
+          sym.st_size == 0 || sym.st_name >= strtab.sh_size) {
+        continue;
+      }
+      Symbol symbol;
+      symbol.start = sym.st_value + bias_;
+      symbol.size = sym.st_size;
+      symbol.name = base + strtab.sh_offset + sym.st_name;
+      symbols_.push_back(symbol);
+    }
+  }
+}
+
+const Symbol* Module::Find(uint64 pc) const {
+  Symbol key;
+  key.start = pc;
+  vector<Symbol>::const_iterator it =
+      std::upper_bound(symbols_.begin(), symbols_.end(), key,
+                       &SymbolStartsBefore);
+  // Symbols can nest (a local alias inside a function): look back a few.
+  for (int tries = 0; it != symbols_.begin() && tries < 8; ++tries) {
+    --it;
+    if (pc < it->start + it->size) return &*it;
+  }
+  return NULL;
+}
+
+Mutex cache_mutex;
+vector<Module*>* modules = NULL;   // under cache_mutex: sorted by start
+uint64 modules_generation = 0;     // under cache_mutex
+vector<Module*>* files = NULL;     // under cache_mutex: for SymbolizeFile()
+
+// REQUIRES: cache_mutex is held exclusively
+void RebuildModules() {
+  LoadedModules::Refresh();
+  LoadedModules::Reader reader;
+  const LoadedModules::Snapshot* snapshot = reader.snapshot();
+  vector<Module*> old_modules;
+  if (modules != NULL) old_modules.swap(*modules);
+  else modules = new vector<Module*>;
+  // The snapshot is sorted by start already.
+  for (size_t m = 0; m < snapshot->count; ++m) {
+    const LoadedModules::Module& loaded = snapshot->modules[m];
+    // The main program by the link, which still opens it if the file was
+    // replaced since.
+    const string path = loaded.main_program ? "/proc/self/exe" : loaded.path;
+    // Keep what is already known about modules that are still loaded.
+    Module* module = NULL;
+    for (size_t i = 0; i < old_modules.size() && module == NULL; ++i) {
+      Module*& old = old_modules[i];
+      if (old != NULL && old->bias() == loaded.bias &&
+          old->start() == loaded.start && old->path() == path) {
+        module = old;
+        old = NULL;
+      }
+    }
+    if (module == NULL) {
+      module = new Module(path, loaded.bias, loaded.start, loaded.end);
+    }
+    modules->push_back(module);
+  }
+  for (size_t i = 0; i < old_modules.size(); ++i) delete old_modules[i];
+  modules_generation = snapshot->generation;
+}
+
+bool PcBeforeModule(uint64 pc, const Module* module) {
+  return pc < module->start();
+}
+
+// REQUIRES: cache_mutex is held
+Module* FindModule(uint64 pc) {
+  if (modules == NULL) return NULL;
+  vector<Module*>::const_iterator it =
+      std::upper_bound(modules->begin(), modules->end(), pc, &PcBeforeModule);
+  if (it == modules->begin()) return NULL;
+  --it;
+  return pc < (*it)->end() ? *it : NULL;
+}
+
+// Copy the demangled "name" to "out".
+bool CopySymbolName(const char* name, char* out, int out_size) {
+  if (DemangleCache::Demangle(name, out, out_size)) return true;
+  const size_t len = strlen(name);
+  if (len + 1 > static_cast<size_t>(out_size)) return false;
+  memcpy(out, name, len + 1);
+  return true;
+}
+
+}  // namespace
+
+bool SymbolCache::Symbolize(void* pc, char* out, int out_size) {
+  const uint64 address = reinterpret_cast<uintptr_t>(pc);
+  const uint64 generation = LoadedModules::CurrentGeneration();
+  {
+    ReaderMutexLock l(&cache_mutex);
+    if (modules != NULL && modules_generation == generation) {
+      Module* module = FindModule(address);
+      if (module == NULL) return false;
+      if (module->indexed()) {
+        const Symbol* symbol = module->Find(address);
+        return symbol != NULL && CopySymbolName(symbol->name, out, out_size);
+      }
+    }
+  }
+  // A new module, or one not indexed yet.
+  MutexLock l(&cache_mutex);
+  if (modules == NULL || modules_generation != generation) {
+    RebuildModules();
+  }
+  Module* module = FindModule(address);
+  if (module == NULL) return false;
+  if (!module->indexed()) module->Index();
+  const Symbol* symbol = module->Find(address);
+  return symbol != NULL && CopySymbolName(symbol->name, out, out_size);
+}
+
+bool SymbolCache::SymbolizeFile(const char* path, uint64 address,
+                                char* out, int out_size) {
+  MutexLock l(&cache_mutex);
+  if (files == NULL) files = new vector<Module*>;
+  Module* file = NULL;
+  for (size_t i = 0; i < files->size() && file == NULL; ++i) {
+    if ((*files)[i]->path() == path) file = (*files)[i];
+  }
+  if (file == NULL) {
+    file = new Module(path, 0, 0, ~0ULL);
+    file->Index();
+    files->push_back(file);
+  }
+  const Symbol* symbol = file->Find(address);
+  return symbol != NULL && CopySymbolName(symbol->name, out, out_size);
+}
+
+static void DeleteModules(vector<Module*>** list) {
+  if (*list == NULL) return;
+  for (size_t i = 0; i < (*list)->size(); ++i) delete (**list)[i];
+  delete *list;
+  *list = NULL;
+}
+
+void SymbolCache::Clear() {
+  MutexLock l(&cache_mutex);
+  DeleteModules(&modules);
+  DeleteModules(&files);
+}
+
+_END_GOOGLE_NAMESPACE_
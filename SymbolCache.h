@@ -0,0 +1,49 @@
+/*
+ * SymbolCache.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#ifndef SYMBOLCACHE_H_
+#define SYMBOLCACHE_H_
+
+#include "basic_type.h"
+#include "config.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// A cache for Symbolize(), used by DumpStackTraceToString() and so by
+// --log_backtrace_at (--symbolize_cache).
+//
+// Symbolize() reads /proc/self/maps and scans the symbol tables of the
+// object with pread() for every single pc: a 32 frame stack trace costs
+// hundreds of system calls.  Here the loaded modules come from the
+// LoadedModules snapshot (dl_iterate_phdr(), which also gives their
+// exact load bias), and each
+// module's file is mmapped and its symbols sorted by address once, on
+// first use.  After that a lookup is two binary searches.  The module
+// table is rebuilt when dlopen() or dlclose() change the set of loaded
+// modules.
+//
+// Unlike Symbolize(), this allocates and takes locks, so it must not be
+// used from signal handlers.  It doesn't run the callback installed by
+// InstallSymbolizeCallback().
+class SymbolCache {
+public:
+  // Like Symbolize(): write the demangled name of the symbol containing
+  // "pc" to "out" and return true, or return false.
+  static bool Symbolize(void* pc, char* out, int out_size);
+
+  // The same for the link-time "address" in the ELF file "path", which
+  // need not be loaded (tools/logsymbolize).
+  static bool SymbolizeFile(const char* path, uint64 address,
+                            char* out, int out_size);
+
+  // Forget all modules and files, and unmap them.
+  static void Clear();
+};
+
+_END_GOOGLE_NAMESPACE_
+
+#endif /* SYMBOLCACHE_H_ */
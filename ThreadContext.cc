@@ -0,0 +1,68 @@
+/*
+ * ThreadContext.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#include "ThreadContext.h"
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "MinimalFormatter.h"
+
+_START_GOOGLE_NAMESPACE_
+
+__thread ThreadContext::Context ThreadContext::context_;
+
+// At load time, so that no tid is cached before the handler exists.
+int ThreadContext::fork_handler_registered_ =
+    ThreadContext::RegisterForkHandler();
+
+int ThreadContext::RegisterForkHandler() {
+  return pthread_atfork(NULL, NULL, &ForgetTid) == 0;
+}
+
+void ThreadContext::ForgetTid() {
+  // The only thread of the child is the one that called fork().
+  context_.tid = 0;
+}
+
+void ThreadContext::Fill() {
+  context_.tid = syscall(SYS_gettid);
+  Render();
+}
+
+void ThreadContext::Render() {
+  MinimalFormatter out(context_.field, sizeof(context_.field) - 1);
+  out.AppendUint64(static_cast<unsigned int>(context_.tid), 10, 5, ' ');
+  context_.field_length = out.size();
+  context_.field[context_.field_length] = '\0';
+
+  MinimalFormatter name(context_.name_field, sizeof(context_.name_field) - 1);
+  if (context_.name[0] != '\0') {
+    name.AppendChar('[');
+    name.AppendString(context_.name);
+    name.AppendString("] ");
+  }
+  context_.name_field_length = name.size();
+  context_.name_field[context_.name_field_length] = '\0';
+}
+
+void ThreadContext::SetName(const char* name) {
+  int i = 0;
+  for (; name != NULL && name[i] != '\0' && i < kMaxNameLength; ++i) {
+    const unsigned char c = name[i];
+    // Keep "[name] " one word that ends at the first ']'.
+    const bool unsafe = c <= ' ' || c == 0x7f || c == '[' || c == ']';
+    context_.name[i] = unsafe ? '_' : c;
+  }
+  context_.name[i] = '\0';
+  if (context_.tid == 0) {
+    Fill();
+  } else {
+    Render();
+  }
+}
+
+_END_GOOGLE_NAMESPACE_
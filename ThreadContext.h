@@ -0,0 +1,86 @@
+/*
+ * ThreadContext.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+#ifndef THREADCONTEXT_H_
+#define THREADCONTEXT_H_
+
+#include <sys/types.h>
+#include "config.h"
+
+_START_GOOGLE_NAMESPACE_
+
+// What the log prefix says about the calling thread: its kernel thread
+// id (gettid(), not the pid that all threads share) in the "threadid"
+// field, and the name given with SetThreadLogName() at the start of the
+// message, both rendered once:
+//
+//   I1019 12:34:56.789012  1234 file.cc:12] no name
+//   I1019 12:34:56.789012  1235 file.cc:12] [worker] named "worker"
+//
+// The threadid field keeps its format, so the tools that parse prefixes
+// are unaffected by names.  Whitespace and brackets in a name are
+// replaced by '_', so that "[name] " is always one word.
+//
+// The context is filled in by the first use on each thread and kept in
+// thread local storage, so every later LOG() just copies the fields.
+// Filling it in is async-signal-safe.  The child of a fork() gets its
+// own tid: a pthread_atfork() handler, registered when the library is
+// loaded, clears the cached one.
+class ThreadContext {
+public:
+  static const int kMaxNameLength = 31;
+
+  // The kernel thread id of the calling thread.
+  static pid_t tid() { return Get().tid; }
+
+  // The name of the calling thread, "" if it has none.
+  static const char* name() { return Get().name; }
+
+  // The "threadid" field of the calling thread's log prefix: its tid,
+  // padded with spaces to 5 columns.
+  static const char* field() { return Get().field; }
+  static int field_length() { return Get().field_length; }
+
+  // What follows the "] " of the prefix: "[name] ", or "" if the calling
+  // thread has no name.
+  static const char* name_field() { return Get().name_field; }
+  static int name_field_length() { return Get().name_field_length; }
+
+  // Name the calling thread, or remove its name if "name" is NULL or "".
+  // Longer names are cut to kMaxNameLength characters; whitespace,
+  // control characters and brackets become '_'.
+  static void SetName(const char* name);
+
+private:
+  struct Context {
+    pid_t tid;              // 0 until filled in
+    char name[kMaxNameLength + 1];
+    char field[16];
+    int field_length;
+    char name_field[kMaxNameLength + 4];
+    int name_field_length;
+  };
+
+  static const Context& Get() {
+    if (context_.tid == 0) Fill();
+    return context_;
+  }
+
+  static void Fill();
+  static void Render();
+
+  // pthread_atfork() child handler.
+  static void ForgetTid();
+  static int RegisterForkHandler();
+
+  static __thread Context context_;
+  static int fork_handler_registered_;
+};
+
+_END_GOOGLE_NAMESPACE_
+
+#endif /* THREADCONTEXT_H_ */
@@ -0,0 +1,72 @@
+/*
+ * clock_benchmark.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+// Measures the cost of reading each --log_clock source, and how far the
+// TSC clock is from CLOCK_REALTIME once calibrated.
+//
+// Usage: clock_benchmark [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "LogClock.h"
+#include "logging.h"
+#include "utilities.h"
+
+using namespace GOOGLE_NAMESPACE;
+
+static void Run(const char* name, LogClock::Source source, int iterations) {
+  int64 sum = 0;
+  const int64 start = LogClock::NowNanos(LogClock::kRealtime);
+  for (int i = 0; i < iterations; ++i) {
+    sum += LogClock::NowNanos(source);
+  }
+  const int64 elapsed = LogClock::NowNanos(LogClock::kRealtime) - start;
+  printf("%-22s %8.2f ns per read (%lld)\n", name,
+         static_cast<double>(elapsed) / iterations,
+         static_cast<long long>(sum & 1));
+}
+
+static void RunGettimeofday(int iterations) {
+  int64 sum = 0;
+  const int64 start = LogClock::NowNanos(LogClock::kRealtime);
+  for (int i = 0; i < iterations; ++i) {
+    sum += glog_internal_namespace_::CycleClock_Now();
+  }
+  const int64 elapsed = LogClock::NowNanos(LogClock::kRealtime) - start;
+  printf("%-22s %8.2f ns per read (%lld)\n", "gettimeofday",
+         static_cast<double>(elapsed) / iterations,
+         static_cast<long long>(sum & 1));
+}
+
+int main(int argc, char** argv) {
+  const int iterations = argc > 1 ? atoi(argv[1]) : 10000000;
+  FLAGS_log_clock = "tsc";
+  LogClock::Init();
+  if (LogClock::source() != LogClock::kTsc) {
+    printf("no invariant TSC: tsc is realtime here\n");
+  }
+  // Wait for a calibration over the full interval.
+  usleep((LogClock::kCalibrationIntervalMs + 100) * 1000);
+
+  RunGettimeofday(iterations);
+  Run("realtime", LogClock::kRealtime, iterations);
+  Run("coarse", LogClock::kCoarse, iterations);
+  Run("tsc", LogClock::kTsc, iterations);
+
+  int64 worst = 0;
+  for (int i = 0; i < 10; ++i) {
+    const int64 tsc = LogClock::NowNanos(LogClock::kTsc);
+    const int64 realtime = LogClock::NowNanos(LogClock::kRealtime);
+    const int64 error = llabs(realtime - tsc);
+    if (error > worst) worst = error;
+    usleep(100 * 1000);
+  }
+  printf("tsc vs realtime: within %lld ns over 1 s\n",
+         static_cast<long long>(worst));
+  return 0;
+}
@@ -0,0 +1,120 @@
+/*
+ * demangle_benchmark.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+// Measures the throughput of Demangle() and DemangleCache over a corpus
+// of mangled names, and looks for names that take it pathologically long
+// (its parser backtracks, which can go exponential).
+//
+// Usage: demangle_benchmark [corpus] [iterations] [limit in us]
+//
+// The corpus has one name per line; the default, demangle_corpus.txt,
+// holds the C++ symbols of glog itself, made with
+//   nm *.o | awk '{print $NF}' | grep '^_Z' | sort -u
+// Run it on the symbols of other binaries the same way.  Exits with 1 if
+// some name takes longer than the limit (default 100 us) to demangle.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+#include "DemangleCache.h"
+#include "demangle.h"
+
+using std::pair;
+using std::string;
+using std::vector;
+using namespace GOOGLE_NAMESPACE;
+
+typedef bool (*Demangler)(const char* mangled, char* out, int out_size);
+
+static double NowSeconds() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static bool ReadCorpus(const char* path, vector<string>* names) {
+  FILE* in = fopen(path, "r");
+  if (in == NULL) {
+    perror(path);
+    return false;
+  }
+  char line[4096];
+  while (fgets(line, sizeof(line), in) != NULL) {
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0] != '\0') names->push_back(line);
+  }
+  fclose(in);
+  return true;
+}
+
+static void Run(const char* name, Demangler demangler,
+                const vector<string>& names, int iterations) {
+  char out[1024];
+  int demangled = 0;
+  const double start = NowSeconds();
+  for (int i = 0; i < iterations; ++i) {
+    for (size_t j = 0; j < names.size(); ++j) {
+      if (demangler(names[j].c_str(), out, sizeof(out))) ++demangled;
+    }
+  }
+  const double elapsed = NowSeconds() - start;
+  const double count = static_cast<double>(iterations) * names.size();
+  printf("%-22s %8.1f ns per name, %6.2f M names/s (%d of %d demangled)\n",
+         name, elapsed * 1e9 / count, count / elapsed / 1e6,
+         demangled / iterations, static_cast<int>(names.size()));
+}
+
+// Times each name on its own, prints the slowest ones, and returns the
+// number over "limit_us".
+static int FindSlowest(const vector<string>& names, double limit_us) {
+  static const int kRepeats = 20;
+  static const size_t kShown = 5;
+  vector<pair<double, string> > times;
+  char out[1024];
+  for (size_t i = 0; i < names.size(); ++i) {
+    const double start = NowSeconds();
+    for (int j = 0; j < kRepeats; ++j) {
+      Demangle(names[i].c_str(), out, sizeof(out));
+    }
+    times.push_back(make_pair((NowSeconds() - start) * 1e6 / kRepeats,
+                              names[i]));
+  }
+  std::sort(times.rbegin(), times.rend());
+  printf("slowest names:\n");
+  for (size_t i = 0; i < times.size() && i < kShown; ++i) {
+    printf("  %10.2f us  %s\n", times[i].first, times[i].second.c_str());
+  }
+  int over = 0;
+  for (size_t i = 0; i < times.size() && times[i].first > limit_us; ++i) {
+    printf("OVER %.0f us: %10.2f us  %s\n", limit_us, times[i].first,
+           times[i].second.c_str());
+    ++over;
+  }
+  return over;
+}
+
+int main(int argc, char** argv) {
+  const char* corpus = argc > 1 ? argv[1] : "benchmark/demangle_corpus.txt";
+  const int iterations = argc > 2 ? atoi(argv[2]) : 100;
+  const double limit_us = argc > 3 ? atof(argv[3]) : 100;
+  vector<string> names;
+  if (!ReadCorpus(corpus, &names)) return 2;
+  if (names.empty()) {
+    fprintf(stderr, "%s: no names\n", corpus);
+    return 2;
+  }
+  Run("Demangle()", &Demangle, names, iterations);
+  // The first pass fills the cache in.
+  Run("DemangleCache (cold)", &DemangleCache::Demangle, names, 1);
+  Run("DemangleCache (warm)", &DemangleCache::Demangle, names, iterations);
+  return FindSlowest(names, limit_us) > 0 ? 1 : 0;
+}
@@ -0,0 +1,68 @@
+/*
+ * symbolize_benchmark.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+// Measures symbolizing a stack trace with Symbolize() and with
+// SymbolCache, and the system calls each one makes.
+//
+// Usage: symbolize_benchmark [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "SymbolCache.h"
+#include "stacktrace.h"
+#include "symbolize.h"
+#include "utilities.h"
+
+using namespace GOOGLE_NAMESPACE;
+
+static double NowSeconds() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static int depth = 0;
+static void* stack[32];
+
+// Recurse a little so that there is a stack worth symbolizing.
+static void __attribute__((noinline)) CaptureStack(int levels) {
+  if (levels > 0) {
+    CaptureStack(levels - 1);
+    return;
+  }
+  depth = GetStackTrace(stack, ARRAYSIZE(stack), 0);
+}
+
+static double Run(const char* name, bool cached, int iterations) {
+  char out[1024];
+  int found = 0;
+  const double start = NowSeconds();
+  for (int i = 0; i < iterations; ++i) {
+    for (int j = 0; j < depth; ++j) {
+      char* pc = static_cast<char*>(stack[j]) - 1;
+      if (cached ? SymbolCache::Symbolize(pc, out, sizeof(out))
+                 : Symbolize(pc, out, sizeof(out))) {
+        ++found;
+      }
+    }
+  }
+  const double elapsed = NowSeconds() - start;
+  printf("%-12s %10.2f us per %d frame trace (%d of %d frames found)\n",
+         name, elapsed * 1e6 / iterations, depth, found / iterations, depth);
+  return elapsed;
+}
+
+int main(int argc, char** argv) {
+  const int iterations = argc > 1 ? atoi(argv[1]) : 200;
+  CaptureStack(24);
+  const double uncached = Run("Symbolize", false, iterations);
+  Run("SymbolCache", true, 1);  // fill the cache
+  const double cached = Run("SymbolCache", true, iterations);
+  printf("speedup %.0fx\n", uncached / cached);
+  return 0;
+}
@@ -0,0 +1,85 @@
+/*
+ * unwind_benchmark.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+// Measures the cost per frame of GetStackTrace() (the CFI unwinder on
+// x86-64) against following frame pointers, and glibc's backtrace() for
+// reference.
+//
+// Usage: unwind_benchmark [iterations] [stack depth]
+//
+// The frame pointer walk needs the benchmark built with frame pointers
+// (the default without optimization): with -fomit-frame-pointer it
+// follows whatever is in %rbp, and returns short traces, which are
+// reported instead of timed.
+
+#include <execinfo.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "LoadedModules.h"
+#include "StackBounds.h"
+#include "stacktrace.h"
+#include "utilities.h"
+
+using namespace GOOGLE_NAMESPACE;
+
+typedef int (*Unwinder)(void** result, int max_depth, int skip_count);
+
+static double NowSeconds() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+// Run() always asks for skip_count 0.
+static int Backtrace(void** result, int max_depth, int /* skip_count */) {
+  return backtrace(result, max_depth);
+}
+
+static void* stack[64];
+
+// Recurse "levels" deep, then unwind "iterations" times.
+static int __attribute__((noinline)) Unwind(Unwinder unwinder, int levels,
+                                            int iterations) {
+  if (levels > 0) {
+    // Not a tail call, so each level is a frame.
+    volatile int depth = Unwind(unwinder, levels - 1, iterations);
+    return depth;
+  }
+  int depth = 0;
+  for (int i = 0; i < iterations; ++i) {
+    depth = unwinder(stack, ARRAYSIZE(stack), 0);
+  }
+  return depth;
+}
+
+static void Run(const char* name, Unwinder unwinder, int levels,
+                int iterations) {
+  const int depth = Unwind(unwinder, levels, 1);
+  if (depth < levels) {
+    printf("%-24s only %d of %d frames: built without frame pointers?\n",
+           name, depth, levels);
+    return;
+  }
+  const double start = NowSeconds();
+  Unwind(unwinder, levels, iterations);
+  const double elapsed = NowSeconds() - start;
+  printf("%-24s %8.1f ns per frame, %8.2f us per %d frame trace\n", name,
+         elapsed * 1e9 / iterations / depth, elapsed * 1e6 / iterations,
+         depth);
+}
+
+int main(int argc, char** argv) {
+  const int iterations = argc > 1 ? atoi(argv[1]) : 100000;
+  const int levels = argc > 2 ? atoi(argv[2]) : 30;
+  LoadedModules::Refresh();
+  StackBounds::Learn();
+  Run("GetStackTrace (CFI)", &GetStackTrace, levels, iterations);
+  Run("frame pointers", &GetStackTraceFromFramePointers, levels, iterations);
+  Run("backtrace()", &Backtrace, levels, iterations);
+  return 0;
+}
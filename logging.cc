@@ -7,6 +7,11 @@
 
 #include "logging.h"
 #include "utilities.h"
+#include "FailureSignalHandler.h"
+#include "LogClock.h"
+#include "LogProfiler.h"
+#include "LogSites.h"
+#include "ThreadContext.h"
 #include <sstream>
 
 DEFINE_bool(logtostderr, false,
@@ -15,6 +20,47 @@ DEFINE_bool(logtostderr, false,
 DEFINE_bool(alsologtostderr, false,
             "log messages go to stderr in addition to logfiles");
 
+DEFINE_bool(log_async_stderr, false,
+            "Write log messages to stderr from a separate thread, so that "
+            "a stalled stderr reader never blocks logging.  Messages are "
+            "dropped (INFO and WARNING first) if it falls behind");
+
+DEFINE_int32(log_budget_bytes_per_sec, 0,
+             "If positive, shed INFO and then WARNING messages while more "
+             "than this many bytes per second are being logged");
+
+DEFINE_int32(log_budget_lock_wait_ms_per_sec, 0,
+             "If positive, shed INFO and then WARNING messages while "
+             "logging threads wait more than this many milliseconds per "
+             "second for the logging lock");
+
+DEFINE_int32(log_dedup_window_ms, 0,
+             "If positive, a message repeating the last one logged from "
+             "the same place within this many milliseconds is only "
+             "counted; the count is logged with the next message");
+
+DEFINE_bool(log_profile_cpu, false,
+            "Attribute the time spent formatting and sending each message "
+            "to its LOG() statement in the per-site profile");
+
+DEFINE_int32(log_profile_signal, 0,
+             "If positive, log the top LOG() statements of the per-site "
+             "profile when this signal is received");
+
+DEFINE_bool(failure_signal_handler, false,
+            "Report crashing signals (SIGSEGV, SIGBUS, ...) with registers "
+            "and stack trace on stderr, and flush the log files, before "
+            "dying of them");
+
+DEFINE_bool(log_stats, false,
+            "Measure the latencies of formatting, locking, writing, "
+            "flushing, rollover and sinks in histograms (see LogStats.h)");
+
+DEFINE_string(log_clock, "realtime",
+              "The clock of the log timestamps: realtime "
+              "(CLOCK_REALTIME), coarse (CLOCK_REALTIME_COARSE, to the "
+              "kernel tick) or tsc (the calibrated time stamp counter)");
+
 DEFINE_bool(log_prefix, true,
             "Prepend the log prefix to the start of each log line");
 
@@ -31,13 +77,19 @@ DEFINE_string(log_dir, "/localdisk/changqwa/log",
               "instead of the default logging directory.");
 
 DEFINE_string(log_backtrace_at, "",
-              "Emit a backtrace when logging at file:linenum.");
+              "Emit a backtrace when logging at file:linenum; several "
+              "may be given, separated by commas.");
 
 DEFINE_int32(logbuflevel, 0,
              "Buffer log messages logged at this level or lower"
              " (-1 means don't buffer; 0 means buffer INFO only;"
              " ...)");
 
+DEFINE_int32(logsynclevel, 999,
+             "Sync log messages logged at this level or higher to disk"
+             " before LOG returns (999 means never sync; 2 means ERROR"
+             " and FATAL)");
+
 DEFINE_string(alsologtoemail, "",
               "log messages go to these email addresses "
               "in addition to logfiles");
@@ -50,6 +102,10 @@ DEFINE_int32(logemaillevel, 999,
 DEFINE_string(logmailer, "/bin/mail",
               "Mailer used to send logging email");
 
+DEFINE_int32(logemail_interval_secs, 60,
+             "Send at most one logging email per this many seconds;"
+             " messages logged in between are sent together as a digest");
+
 ////Has the user called SetExitOnDFatal(true)?
 //static bool exit_on_dfatal = true;
 
@@ -58,8 +114,16 @@ _START_GOOGLE_NAMESPACE_
 const char *const LogSeverityNames[NUM_SEVERITIES] = {
   "INFO", "WARNING", "ERROR", "FATAL"};
 
+void SetThreadLogName(const char* name) {
+  ThreadContext::SetName(name);
+}
+
 void InitGoogleLogging(const char *argv0) {
   glog_internal_namespace_::InitGoogleLoggingUtilities(argv0);
+  LogSites::Init();
+  LogProfiler::Init();
+  FailureSignalHandler::Init();
+  LogClock::Init();
 }
 
 #define DEFINE_CHECK_STROP_IMPL(name, func, expected)                   \
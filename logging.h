@@ -10,6 +10,7 @@
 
 #include <string>   //for string type
 #include <strstream> // ostrstream
+#include <time.h>     // clock_gettime, for LOG_EVERY_T
 #include "config.h"
 #include "basic_type.h"
 #include "vlog_is_on.h"
@@ -40,6 +41,51 @@ DECLARE_bool(logtostderr);
 // Set whether log messages go to stderr in addition to logfiles.
 DECLARE_bool(alsologtostderr);
 
+// Write log messages to stderr from a separate thread, dropping them
+// (INFO and WARNING first) rather than blocking if stderr stalls
+// Default false
+DECLARE_bool(log_async_stderr);
+
+// Shed INFO and then WARNING messages (never ERROR or FATAL) while more
+// than this many bytes per second are logged
+// Default 0, i.e. no budget
+DECLARE_int32(log_budget_bytes_per_sec);
+
+// Shed INFO and then WARNING messages while threads wait longer than
+// this many milliseconds per second for the logging lock
+// Default 0, i.e. no budget
+DECLARE_int32(log_budget_lock_wait_ms_per_sec);
+
+// Count instead of logging messages that repeat the last one logged from
+// the same LOG() statement within this many milliseconds
+// Default 0, i.e. log every message
+DECLARE_int32(log_dedup_window_ms);
+
+// Time how long each LOG() statement spends formatting and sending its
+// messages, for the per-site profile (see LogProfiler.h)
+// Default false, i.e. only messages and bytes are counted
+DECLARE_bool(log_profile_cpu);
+
+// Log the top sites of the per-site profile at INFO when this signal is
+// received
+// Default 0, i.e. no signal handler
+DECLARE_int32(log_profile_signal);
+
+// Report SIGSEGV, SIGILL, SIGFPE, SIGABRT and SIGBUS with the registers
+// and stack trace on stderr, and flush the log files, before dying of
+// them (see FailureSignalHandler.h)
+// Default false, i.e. the signals keep their default action
+DECLARE_bool(failure_signal_handler);
+
+// Measure the latencies of the logging pipeline (see LogStats.h)
+// Default false, i.e. only counters are kept
+DECLARE_bool(log_stats);
+
+// The clock of the log timestamps: "realtime", "coarse" or "tsc" (see
+// LogClock.h).  Read by InitGoogleLogging().
+// Default "realtime"
+DECLARE_string(log_clock);
+
 // Set whether the log prefix should be prepended to each line of output.
 DECLARE_bool(log_prefix);
 
@@ -66,15 +112,35 @@ DECLARE_int32(v);  // in vlog_is_on.cc
 // <log level> overrides any value given by --v.
 DECLARE_string(vmodule); //in vlog_is_on.cc
 
-// If specified, Emit a backtrace when logging at file:linenum.
+// If specified, Emit a backtrace when logging at file:linenum, or at any
+// of a comma-separated list of them.  Changes take up to a second.
 // Default null
 DECLARE_string(log_backtrace_at);
 
+// Symbolize the stack traces of crashes and of --log_backtrace_at
+// Default true
+DECLARE_bool(symbolize_stacktrace);  // in utilities.cc
+
+// Log stack traces as raw pcs plus the path, load address and build-id
+// of their modules, to be symbolized later by tools/logsymbolize.
+// Default false
+DECLARE_bool(symbolize_offline);  // in utilities.cc
+
+// Log each distinct --log_backtrace_at stack trace in full only once,
+// as "trace#<id>:", and as "trace#<id>" when it comes again.
+// Default false
+DECLARE_bool(intern_stacktraces);  // in utilities.cc
+
 // Buffer log messages logged at this level or lower
 // -1 means don't buffer; 0 means buffer INFO only
 // Default 0
 DECLARE_int32(logbuflevel);
 
+// Log messages at this level or higher are on disk (fdatasync) before
+// LOG returns.  Concurrent writers share one fdatasync (group commit).
+// Default 999, i.e. never sync
+DECLARE_int32(logsynclevel);
+
 // log messages go to these email addresses in addition to logfiles
 // Default null
 DECLARE_string(alsologtoemail);
@@ -88,6 +154,11 @@ DECLARE_int32(logemaillevel);
 // Default /bin/mail
 DECLARE_string(logmailer);
 
+// Send at most one logging email per this many seconds, with everything
+// logged in between as a digest
+// Default 60
+DECLARE_int32(logemail_interval_secs);
+
 #define DEFINE_VARIABLE(type, name, value, meaning, type_name) \
   namespace FLAG_namespace_do_not_use_directly_use_DECLARE_##type_name##_instead {  \
   type FLAGS_##name(value);                                                         \
@@ -103,13 +174,66 @@ DECLARE_string(logmailer);
 #define DEFINE_string(name, value, meaning) \
   DEFINE_VARIABLE(std::string, name, value, meaning, string)
 
-#define COMPACT_GOOGLE_LOG_INFO GOOGLE_NAMESPACE::LogMessage(__FILE__, __LINE__)
-#define COMPACT_GOOGLE_LOG_WARNING    \
-  GOOGLE_NAMESPACE::LogMessage(__FILE__, __LINE__, GOOGLE_NAMESPACE::GLOG_WARNING)
-#define COMPACT_GOOGLE_LOG_ERROR      \
-  GOOGLE_NAMESPACE::LogMessage(__FILE__, __LINE__, GOOGLE_NAMESPACE::GLOG_ERROR)
-#define COMPACT_GOOGLE_LOG_FATAL      \
-  GOOGLE_NAMESPACE::LogMessage(__FILE__, __LINE__, GOOGLE_NAMESPACE::GLOG_FATAL)
+_START_GOOGLE_NAMESPACE_
+
+// A LOG() statement.  Each expansion of LOG(), and so of VLOG() and
+// CHECK(), defines one statically initialized LogSite and puts its
+// address in the "glog_log_sites" section, so that all of them can be
+// found at run time through the linker's __start_/__stop_ symbols (see
+// LogSites.h).
+struct LogSite {
+  const char* file;        // __FILE__
+  int line;                // __LINE__
+  LogSeverity severity;    // as written in the statement
+  const char* basename;    // of file: set by LogSites::Init(), or on use
+  int id;                  // 0..LogSites::count()-1: set by LogSites::Init()
+  bool enabled;            // false: messages are formatted but not logged
+  int backtrace;           // for --log_backtrace_at: see LogSites.h
+  // Profile of the messages logged (see LogProfiler.h)
+  int64 messages;
+  int64 bytes;
+  int64 nanos;             // formatting and sending, with --log_profile_cpu
+};
+
+_END_GOOGLE_NAMESPACE_
+
+#define GOOGLE_LOG_SITE_STRINGIFY_(x) #x
+#define GOOGLE_LOG_SITE_STRINGIFY(x) GOOGLE_LOG_SITE_STRINGIFY_(x)
+
+// The LogSite itself can't be put in the section with a section
+// attribute: GCC refuses to mix, in one section, the statics of inline
+// functions (which live in COMDAT groups) with other ones.  So the
+// pointer is emitted by hand.  An inline function emitted in several
+// objects emits it several times; LogSites::Init() drops the duplicates.
+// Position-independent code can't take the address of a preemptible
+// symbol as a constant: there the sites work, but are not registered.
+#if defined(__PIC__) && !defined(__PIE__)
+#define GOOGLE_LOG_SITE_REGISTER(site)
+#else
+#define GOOGLE_LOG_SITE_REGISTER(site) \
+    __asm__ __volatile__( \
+        ".pushsection glog_log_sites,\"aw\",@progbits\n\t" \
+        ".balign " GOOGLE_LOG_SITE_STRINGIFY(__SIZEOF_POINTER__) "\n\t" \
+        ".dc.a %c0\n\t" \
+        ".popsection" : : "i"(&(site)));
+#endif
+
+// A pointer to the LogSite of the statement it is expanded in.
+#define GOOGLE_LOG_SITE(severity) \
+  __extension__ ({ \
+    static GOOGLE_NAMESPACE::LogSite google_log_site_ = \
+        { __FILE__, __LINE__, (severity), NULL, -1, true, 0, 0, 0, 0 }; \
+    GOOGLE_LOG_SITE_REGISTER(google_log_site_) \
+    &google_log_site_; })
+
+#define COMPACT_GOOGLE_LOG_INFO GOOGLE_NAMESPACE::LogMessage( \
+  GOOGLE_LOG_SITE(GOOGLE_NAMESPACE::GLOG_INFO))
+#define COMPACT_GOOGLE_LOG_WARNING GOOGLE_NAMESPACE::LogMessage( \
+  GOOGLE_LOG_SITE(GOOGLE_NAMESPACE::GLOG_WARNING))
+#define COMPACT_GOOGLE_LOG_ERROR GOOGLE_NAMESPACE::LogMessage( \
+  GOOGLE_LOG_SITE(GOOGLE_NAMESPACE::GLOG_ERROR))
+#define COMPACT_GOOGLE_LOG_FATAL GOOGLE_NAMESPACE::LogMessage( \
+  GOOGLE_LOG_SITE(GOOGLE_NAMESPACE::GLOG_FATAL))
 
 // We use the preprocessor's merging operator, "##", so that, e.g.,
 // LOG(INFO) becomes the token GOOGLE_LOG_INFO.  There's some funny
@@ -134,6 +258,15 @@ public:
   void operator &(std::ostream &) {}
 };
 
+// The clock of LOG_EVERY_T, in nanoseconds.  CLOCK_MONOTONIC_COARSE is
+// read from the vDSO without a system call, and its resolution (a few
+// milliseconds) is plenty for rate limiting.
+inline int64 LogEveryTNowNanos() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  return static_cast<int64>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
 #define LOG_IF(severity, condition) \
   !(condition) ? (void) 0 : GOOGLE_NAMESPACE::LogMessageVoidify() & LOG(severity)
 #define LOG_ASSERT(condition) \
@@ -146,32 +279,63 @@ public:
 
 #define LOG_OCCURRENCES LOG_EVERY_N_VARNAME(occurrences_, __LINE__)
 #define LOG_OCCURRENCES_MOD_N LOG_EVERY_N_VARNAME(occurrences_mod_n_, __LINE__)
-
+#define LOG_OCCURRENCES_NOW LOG_EVERY_N_VARNAME(occurrences_now_, __LINE__)
+#define LOG_NEXT_TIME LOG_EVERY_N_VARNAME(next_time_, __LINE__)
+#define LOG_TIME_NOW LOG_EVERY_N_VARNAME(time_now_, __LINE__)
+#define LOG_NEXT_TIME_SEEN LOG_EVERY_N_VARNAME(next_time_seen_, __LINE__)
+
+// The per-site counters are shared by every thread that goes through the
+// site, so they are updated with relaxed atomic operations: no data race,
+// no lost counts, and no memory barriers.  Only the counter itself is
+// written; once LOG_FIRST_N has logged n times it only reads it, so its
+// cache line stops bouncing between cores.
 #define SOME_KIND_OF_LOG_FIRST_N(severity, n, what_to_do)   \
   static int LOG_OCCURRENCES = 0; \
-  if (LOG_OCCURRENCES < n) \
-    ++LOG_OCCURRENCES, google::LogMessage(__FILE__, __LINE__, \
-        google::GLOG_##severity, LOG_OCCURRENCES, &what_to_do).stream()
+  int LOG_OCCURRENCES_NOW; \
+  if (__atomic_load_n(&LOG_OCCURRENCES, __ATOMIC_RELAXED) < (n) && \
+      (LOG_OCCURRENCES_NOW = __atomic_add_fetch(&LOG_OCCURRENCES, 1, \
+                                                __ATOMIC_RELAXED)) <= (n)) \
+    google::LogMessage(GOOGLE_LOG_SITE(google::GLOG_##severity), \
+        LOG_OCCURRENCES_NOW, &what_to_do).stream()
 
 // n must be a integral number,
 // if is float, compile error will occur
 // if n > 0, n is a valid number, dump trace as we expect,
 // if n <= 0, n is not illegal number, do nothing.
 #define SOME_KIND_OF_LOG_EVERY_N(severity, n, what_to_do)    \
-  static int LOG_OCCURRENCES = 0, LOG_OCCURRENCES_MOD_N = 0; \
-    ++LOG_OCCURRENCES; \
-    if ((n) > 0 &&   \
-        (LOG_OCCURRENCES_MOD_N = (LOG_OCCURRENCES_MOD_N + 1)%(n)) == (1%(n))) \
-        google::LogMessage(__FILE__, __LINE__, \
-            google::GLOG_##severity, LOG_OCCURRENCES, &what_to_do).stream()
+  static int LOG_OCCURRENCES = 0; \
+  const int LOG_OCCURRENCES_NOW = \
+      __atomic_add_fetch(&LOG_OCCURRENCES, 1, __ATOMIC_RELAXED); \
+  if ((n) > 0 && \
+      (static_cast<unsigned int>(LOG_OCCURRENCES_NOW) - 1u) % (n) == 0) \
+    google::LogMessage(GOOGLE_LOG_SITE(google::GLOG_##severity), \
+        LOG_OCCURRENCES_NOW, &what_to_do).stream()
 
 #define SOME_KIND_OF_LOG_IF_EVERY_N(severity, condition, n, what_to_do) \
   static int LOG_OCCURRENCES = 0, LOG_OCCURRENCES_MOD_N = 0; \
-  ++LOG_OCCURRENCES; \
-  if ((n) > 0 && condition &&   \
-      (LOG_OCCURRENCES_MOD_N = (LOG_OCCURRENCES_MOD_N + 1)%(n)) == (1%(n))) \
-      google::LogMessage(__FILE__, __LINE__, \
-          google::GLOG_##severity, LOG_OCCURRENCES, &what_to_do).stream()
+  const int LOG_OCCURRENCES_NOW = \
+      __atomic_add_fetch(&LOG_OCCURRENCES, 1, __ATOMIC_RELAXED); \
+  if ((n) > 0 && (condition) && \
+      (static_cast<unsigned int>(__atomic_add_fetch(&LOG_OCCURRENCES_MOD_N, \
+                                     1, __ATOMIC_RELAXED)) - 1u) % (n) == 0) \
+    google::LogMessage(GOOGLE_LOG_SITE(google::GLOG_##severity), \
+        LOG_OCCURRENCES_NOW, &what_to_do).stream()
+
+// Logs at most once every "seconds" (which may be fractional): a token
+// bucket holding one token, refilled "seconds" after it was taken.  The
+// skip path costs one clock read and one relaxed load; when several
+// threads find the token at once, the compare-and-swap picks one.
+#define SOME_KIND_OF_LOG_EVERY_T(severity, seconds, what_to_do) \
+  static google::int64 LOG_NEXT_TIME = 0; \
+  const google::int64 LOG_TIME_NOW = google::LogEveryTNowNanos(); \
+  google::int64 LOG_NEXT_TIME_SEEN = \
+      __atomic_load_n(&LOG_NEXT_TIME, __ATOMIC_RELAXED); \
+  if (LOG_TIME_NOW >= LOG_NEXT_TIME_SEEN && \
+      __atomic_compare_exchange_n(&LOG_NEXT_TIME, &LOG_NEXT_TIME_SEEN, \
+          LOG_TIME_NOW + static_cast<google::int64>((seconds) * 1e9), \
+          false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) \
+    google::LogMessage(GOOGLE_LOG_SITE(google::GLOG_##severity), \
+        0, &what_to_do).stream()
 
 #define LOG_FIRST_N(severity, n) \
   SOME_KIND_OF_LOG_FIRST_N(severity, (n), google::LogMessage::SendToLog)
@@ -183,6 +347,9 @@ public:
   SOME_KIND_OF_LOG_IF_EVERY_N(severity, condition, (n), \
                               google::LogMessage::SendToLog)
 
+#define LOG_EVERY_T(severity, seconds) \
+  SOME_KIND_OF_LOG_EVERY_T(severity, (seconds), google::LogMessage::SendToLog)
+
 
 // Log only in verbose mode.
 #define VLOG(verboselevel) LOG_IF(INFO, VLOG_IS_ON(verboselevel))
@@ -425,6 +592,10 @@ class LogSink;  // defined below
 extern const char *const LogSeverityNames[NUM_SEVERITIES];
 void InitGoogleLogging(const char *argv0);
 
+// Name the calling thread in its log lines, as "[name] " at the start of
+// the message; NULL or "" removes the name (see ThreadContext.h).
+void SetThreadLogName(const char* name);
+
 _END_GOOGLE_NAMESPACE_
 
 #define WILLIAM_TRACE(x) std::cout << "Wang Changqian Trace: "<< #x << " = " << x << std::endl
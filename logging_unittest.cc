@@ -7,12 +7,49 @@
 
 #include "file_capture.h"
 #include "gtest/gtest.h"
+#include <pthread.h>
+#include <signal.h>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <ucontext.h>
+#include <zlib.h>
+#include <sstream>
 #include <string>
 #include <vector>
 #include "logging.h"
 #include "LogMessage.h"
 #include "raw_logging.h"
 #include "LogSink.h"
+#include "AsyncStderrWriter.h"
+#include "CfiUnwinder.h"
+#include "DemangleCache.h"
+#include "DirectFileWriter.h"
+#include "EmailNotifier.h"
+#include "FailureSignalHandler.h"
+#include "LogClock.h"
+#include "LogCompressor.h"
+#include "Logger.h"
+#include "LogFraming.h"
+#include "LogGovernor.h"
+#include "LogIndex.h"
+#include "LoadedModules.h"
+#include "LogProfiler.h"
+#include "LogSites.h"
+#include "LogStats.h"
+#include "ModuleMap.h"
+#include "RingLogFile.h"
+#include "StackBounds.h"
+#include "StackTraceTable.h"
+#include "SymbolCache.h"
+#include "ThreadContext.h"
+#include "demangle.h"
+#include "stacktrace.h"
+#include "symbolize.h"
 #include "unittest_common.h"
 
 using std::string;
@@ -20,6 +57,14 @@ using std::vector;
 using std::endl;
 using namespace GOOGLE_NAMESPACE;
 
+DECLARE_bool(log_compress);  // in Logger.cc
+DECLARE_bool(log_compress_defer_flush);  // in Logger.cc
+DECLARE_bool(log_direct_io);  // in Logger.cc
+DECLARE_bool(log_framing);  // in Logger.cc
+DECLARE_int32(log_index_interval_kb);  // in Logger.cc
+DECLARE_string(log_link);  // in Logger.cc
+DECLARE_int32(log_ring_size_mb);  // in Logger.cc
+
 class SeverityLogImplementTest: public testing::Test {
 protected:
   void SetUp() {
@@ -267,6 +312,69 @@ TEST_F(ConditionLogTest, LOG_EVERY_N) {
   EXPECT_NE((int)early_stderr.find(log_if_every_2 + "2"), -1);
 }
 
+TEST_F(ConditionLogTest, LOG_EVERY_T) {
+  FLAGS_logtostderr = true;
+  const int64 stream_info_log_num = LogMessage::num_messages(GLOG_INFO);
+  const string log_every_t = "Log every 60 seconds, iteration ";
+
+  CaptureTestStderr();
+  for (int index = 0; index < 4; index++) {
+    LOG_EVERY_T(INFO, 60) << log_every_t << index << endl;
+  }
+  string early_stderr = GetCapturedTestStderr();
+
+  ASSERT_EQ(LogMessage::num_messages(GLOG_INFO), stream_info_log_num + 1);
+  EXPECT_NE((int)early_stderr.find(log_every_t + "0"), -1);
+}
+
+static void* LogEvery10Thread(void*) {
+  for (int index = 0; index < 1000; index++) {
+    LOG_EVERY_N(INFO, 10) << "Log every 10 from several threads";
+  }
+  return NULL;
+}
+
+TEST_F(ConditionLogTest, LOG_EVERY_N_threads) {
+  FLAGS_logtostderr = true;
+  const int64 stream_info_log_num = LogMessage::num_messages(GLOG_INFO);
+  const int kThreads = 4;
+
+  CaptureTestStderr();
+  pthread_t threads[kThreads];
+  for (int i = 0; i < kThreads; ++i) {
+    pthread_create(&threads[i], NULL, &LogEvery10Thread, NULL);
+  }
+  for (int i = 0; i < kThreads; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+  GetCapturedTestStderr();
+
+  // No hit is lost or counted twice.
+  ASSERT_EQ(LogMessage::num_messages(GLOG_INFO),
+            stream_info_log_num + kThreads * 1000 / 10);
+}
+
+TEST_F(ConditionLogTest, log_dedup_window_ms) {
+  FLAGS_logtostderr = true;
+  FLAGS_log_dedup_window_ms = 60000;
+  const int64 stream_error_log_num = LogMessage::num_messages(GLOG_ERROR);
+
+  CaptureTestStderr();
+  for (int index = 0; index < 6; index++) {
+    LOG(ERROR) << (index < 5 ? "Error storm" : "End of storm");
+  }
+  string early_stderr = GetCapturedTestStderr();
+  FLAGS_log_dedup_window_ms = 0;
+
+  // The first one, the summary of the other four, and the last one.
+  ASSERT_EQ(LogMessage::num_messages(GLOG_ERROR), stream_error_log_num + 3);
+  EXPECT_NE((int)early_stderr.find("Last message repeated 4 times"), -1);
+  EXPECT_LT(early_stderr.find("Error storm"),
+            early_stderr.find("Last message repeated"));
+  EXPECT_LT(early_stderr.find("Last message repeated"),
+            early_stderr.find("End of storm"));
+}
+
 class CheckLogTest: public testing::Test {
 protected:
   void SetUp() {
@@ -569,3 +677,1633 @@ TEST_F(LogSinkTest, LOG_TO_SINK_BUT_NOT_TO_LOGFILE_null) {
   }
 }
 
+
+static int LogFromOneSite(const char* message) {
+  LOG(INFO) << message;
+  return __LINE__ - 1;
+}
+
+TEST(LogSitesTest, Registry) {
+  ASSERT_GT(LogSites::count(), 0);
+  for (int id = 0; id < LogSites::count(); ++id) {
+    LogSite* site = LogSites::Get(id);
+    ASSERT_EQ(id, site->id);
+    ASSERT_STREQ(const_basename(site->file), site->basename);
+  }
+  EXPECT_TRUE(LogSites::Get(LogSites::count()) == NULL);
+}
+
+TEST(LogSitesTest, SetEnabled) {
+  const int line = LogFromOneSite("site enabled");
+  const int64 stream_info_log_num = LogMessage::num_messages(GLOG_INFO);
+
+  ASSERT_EQ(1, LogSites::SetEnabled("logging_unittest.cc", line, false));
+  LogFromOneSite("site disabled");
+  ASSERT_EQ(LogMessage::num_messages(GLOG_INFO), stream_info_log_num);
+
+  ASSERT_EQ(1, LogSites::SetEnabled("logging_unittest.cc", line, true));
+  LogFromOneSite("site enabled again");
+  ASSERT_EQ(LogMessage::num_messages(GLOG_INFO), stream_info_log_num + 1);
+}
+
+TEST(LogSitesTest, BacktraceAt) {
+  LogSite site = { __FILE__, 100, GLOG_INFO, "logging_unittest.cc", -1, true,
+                   0, 0, 0, 0 };
+  LogSite other = site;
+  other.line = 200;
+  // The flag is looked at again when "now" is a new second.
+  time_t now = 1;
+  FLAGS_log_backtrace_at = "other.cc:100, logging_unittest.cc:100";
+  EXPECT_TRUE(LogSites::WantsBacktrace(&site, site.basename, 100, ++now));
+  EXPECT_FALSE(LogSites::WantsBacktrace(&other, other.basename, 200, now));
+  EXPECT_TRUE(LogSites::WantsBacktrace(NULL, site.basename, 100, now));
+
+  FLAGS_log_backtrace_at = "logging_unittest.cc:200";
+  EXPECT_TRUE(LogSites::WantsBacktrace(&site, site.basename, 100, now));
+  EXPECT_FALSE(LogSites::WantsBacktrace(&site, site.basename, 100, ++now));
+  EXPECT_TRUE(LogSites::WantsBacktrace(&other, other.basename, 200, now));
+
+  FLAGS_log_backtrace_at = "";
+  EXPECT_FALSE(LogSites::WantsBacktrace(&other, other.basename, 200, ++now));
+  EXPECT_FALSE(LogSites::WantsBacktrace(&other, other.basename, 200, ++now));
+}
+
+TEST(LogProfilerTest, TopSites) {
+  LogProfiler::Reset();
+  const string message = "profiled message";
+  int line = 0;
+  for (int i = 0; i < 3; i++) {
+    line = LogFromOneSite(message.c_str());
+  }
+  LOG(INFO) << "other site";
+
+  const string top = LogProfiler::TopSites(1);
+  std::ostringstream site;
+  site << "logging_unittest.cc:" << line << " INFO";
+  EXPECT_NE((int)top.find(site.str()), -1);
+  EXPECT_NE((int)top.find("Top 1 of 2 log sites"), -1);
+}
+
+TEST(LogStatsTest, Histogram) {
+  LogStats::Reset();
+  for (int i = 0; i < 99; i++) {
+    LogStats::Record(LogStats::kSinkSend, 1000);
+  }
+  LogStats::Record(LogStats::kSinkSend, 1 << 20);
+  LogStats::Snapshot snapshot;
+  LogStats::GetSnapshot(&snapshot);
+
+  EXPECT_EQ(100u, snapshot.counts[LogStats::kSinkSend]);
+  EXPECT_EQ(99 * 1000u + (1 << 20), snapshot.sums[LogStats::kSinkSend]);
+  EXPECT_EQ(1023u, snapshot.Percentile(LogStats::kSinkSend, 50));
+  EXPECT_EQ(1023u, snapshot.Percentile(LogStats::kSinkSend, 99));
+  EXPECT_EQ((2u << 20) - 1, snapshot.Percentile(LogStats::kSinkSend, 100));
+  EXPECT_EQ(0u, snapshot.Percentile(LogStats::kRollover, 50));
+}
+
+TEST(LogStatsTest, Pipeline) {
+  FLAGS_log_stats = true;
+  LogStats::Snapshot before, after;
+  LogStats::GetSnapshot(&before);
+  for (int i = 0; i < 5; i++) {
+    LOG(INFO) << "counted message";
+  }
+  LogStats::GetSnapshot(&after);
+  FLAGS_log_stats = false;
+
+  EXPECT_EQ(before.counters[LogStats::kMessages] + 5,
+            after.counters[LogStats::kMessages]);
+  EXPECT_LT(before.counters[LogStats::kBytes],
+            after.counters[LogStats::kBytes]);
+  EXPECT_EQ(before.counts[LogStats::kFormat] + 5,
+            after.counts[LogStats::kFormat]);
+  EXPECT_EQ(before.counts[LogStats::kLockWait] + 5,
+            after.counts[LogStats::kLockWait]);
+  EXPECT_NE((int)after.ToString().find("lock_wait_ns count "), -1);
+}
+
+// How many of "n" messages of "severity" the governor admits at "now".
+static int AdmitMany(LogSeverity severity, int n, int64 now) {
+  int admitted = 0;
+  for (int i = 0; i < n; ++i) {
+    if (LogGovernor::Admit(severity, 10, now)) ++admitted;
+  }
+  return admitted;
+}
+
+TEST(LogGovernorTest, Levels) {
+  CommonFlagsSaver flags_saver;
+  FlagSaver<int32> budget_saver(FLAGS_log_budget_bytes_per_sec);
+  FLAGS_logtostderr = true;
+  FLAGS_log_budget_bytes_per_sec = 1000;
+  const int64 kSecond = 1000000000LL;
+  const int kMaxLevel = LogGovernor::kMaxLevel;
+  int64 now = LogEveryTNowNanos();
+  CaptureTestStderr();
+
+  // The first call only starts a window.
+  ASSERT_TRUE(LogGovernor::Admit(GLOG_INFO, 10, now));
+  ASSERT_EQ(0, LogGovernor::level());
+
+  // Each window over budget raises the level by one.
+  const int expected_info[] = { 1, 0, 0, 0, 0 };
+  const int expected_warning[] = { 10, 10, 1, 0, 0 };
+  for (int level = 1; level <= kMaxLevel + 1; ++level) {
+    LogGovernor::Account(2000, 0);
+    now += kSecond;
+    LogGovernor::Admit(GLOG_ERROR, 10, now);
+    const int expected_level = level < kMaxLevel ? level : kMaxLevel;
+    ASSERT_EQ(expected_level, LogGovernor::level());
+    EXPECT_EQ(expected_info[expected_level - 1],
+              AdmitMany(GLOG_INFO, 10, now)) << expected_level;
+    EXPECT_EQ(expected_warning[expected_level - 1],
+              AdmitMany(GLOG_WARNING, 10, now)) << expected_level;
+    // ERROR and FATAL are always admitted.
+    EXPECT_EQ(10, AdmitMany(GLOG_ERROR, 10, now)) << expected_level;
+    EXPECT_EQ(10, AdmitMany(GLOG_FATAL, 10, now)) << expected_level;
+  }
+
+  // Under budget, but not under half of it: the level holds.
+  LogGovernor::Account(700, 0);
+  AdmitMany(GLOG_INFO, 60, now);
+  now += kSecond;
+  LogGovernor::Admit(GLOG_ERROR, 10, now);
+  EXPECT_EQ(kMaxLevel, LogGovernor::level());
+
+  // Each calm window lowers it by one.
+  for (int level = kMaxLevel - 1; level >= 0; --level) {
+    now += kSecond;
+    LogGovernor::Admit(GLOG_ERROR, 10, now);
+    ASSERT_EQ(level, LogGovernor::level());
+  }
+  EXPECT_EQ(10, AdmitMany(GLOG_INFO, 10, now));
+
+  // What was suppressed is summarized.
+  EXPECT_NE(string::npos, GetCapturedTestStderr().find(
+      "Logging is over budget: suppressed "));
+}
+
+TEST(SymbolCacheTest, MatchesSymbolize) {
+  void* const pcs[] = {
+    reinterpret_cast<void*>(&LogFromOneSite),
+    reinterpret_cast<void*>(&LogEvery10Thread),
+  };
+  char cached[256], uncached[256];
+  for (size_t i = 0; i < ARRAYSIZE(pcs); i++) {
+    // Twice: to fill the cache, and from it.
+    for (int j = 0; j < 2; j++) {
+      ASSERT_TRUE(SymbolCache::Symbolize(pcs[i], cached, sizeof(cached)));
+      ASSERT_TRUE(Symbolize(pcs[i], uncached, sizeof(uncached)));
+      EXPECT_STREQ(uncached, cached);
+    }
+  }
+  ASSERT_TRUE(SymbolCache::Symbolize(pcs[0], cached, sizeof(cached)));
+  EXPECT_STREQ("LogFromOneSite()", cached);
+  EXPECT_FALSE(SymbolCache::Symbolize(pcs[0], cached, 4));
+}
+
+// The frame to look for in the trace: a helper, since inlining and the
+// skip count decide whether the test body itself shows up first.
+static void __attribute__((noinline)) OfflineStackTraceOf(string* trace) {
+  int full_trace_id;
+  GOOGLE_NAMESPACE::glog_internal_namespace_::DumpStackTraceToString(
+      trace, GLOG_INFO, &full_trace_id);
+  __asm__ volatile("");   // not a tail call
+}
+
+TEST(ModuleMapTest, OfflineStackTrace) {
+  FLAGS_symbolize_offline = true;
+  string trace;
+  OfflineStackTraceOf(&trace);
+  FLAGS_symbolize_offline = false;
+
+  // The module table comes first, then the raw pcs.
+  std::istringstream lines(trace);
+  string line;
+  vector<ModuleMap::Module> modules;
+  ModuleMap::Module module;
+  while (std::getline(lines, line) && ModuleMap::ParseLine(line.c_str(),
+                                                           &module)) {
+    modules.push_back(module);
+  }
+  ASSERT_FALSE(modules.empty());
+  vector<unsigned long long> pcs;
+  do {
+    unsigned long long pc;
+    ASSERT_EQ(1, sscanf(line.c_str(), " @ %llx", &pc)) << line;
+    EXPECT_EQ(string::npos, line.find("OfflineStackTrace"));
+    pcs.push_back(pc);
+  } while (std::getline(lines, line));
+
+  // Every pc is in a module, and one of them is the helper, in the test
+  // program: symbolizing it offline agrees with symbolizing it online.
+  bool found_helper = false;
+  for (size_t i = 0; i < pcs.size(); ++i) {
+    const unsigned long long pc = pcs[i];
+    const ModuleMap::Module* found = NULL;
+    for (size_t m = 0; m < modules.size(); ++m) {
+      if (modules[m].start <= pc - 1 && pc - 1 < modules[m].end) {
+        found = &modules[m];
+      }
+    }
+    ASSERT_TRUE(found != NULL) << std::hex << pc;
+    char online[256];
+    if (!SymbolCache::Symbolize(reinterpret_cast<void*>(pc - 1),
+                                online, sizeof(online)) ||
+        strstr(online, "OfflineStackTraceOf") == NULL) {
+      continue;
+    }
+    found_helper = true;
+    string build_id;
+    if (ModuleMap::ReadBuildId(found->path.c_str(), &build_id)) {
+      EXPECT_EQ(build_id, found->build_id);
+    }
+    char offline[256];
+    ASSERT_TRUE(SymbolCache::SymbolizeFile(found->path.c_str(),
+                                           pc - 1 - found->bias,
+                                           offline, sizeof(offline)));
+    EXPECT_STREQ(online, offline);
+  }
+  EXPECT_TRUE(found_helper) << trace;
+}
+
+// Whether one of stack[0, depth) is a call from a function whose name
+// contains "function".
+static bool StackHasFunction(void* const* stack, int depth,
+                             const char* function) {
+  char symbol[256];
+  for (int i = 0; i < depth; i++) {
+    if (SymbolCache::Symbolize(static_cast<char*>(stack[i]) - 1,
+                               symbol, sizeof(symbol)) &&
+        strstr(symbol, function) != NULL) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Uses %rbp for data, so following frame pointers skips its caller.
+static int __attribute__((noinline, optimize("omit-frame-pointer")))
+GetStackTraceWithoutFramePointer(void** stack, int max_depth) {
+  volatile int depth = GetStackTrace(stack, max_depth, 0);
+  return depth;
+}
+
+TEST(CfiUnwinderTest, OmitFramePointer) {
+  void* stack[32];
+  const int depth = GetStackTraceWithoutFramePointer(stack, 32);
+  ASSERT_GE(depth, 2);
+  EXPECT_TRUE(StackHasFunction(stack, 1, "GetStackTraceWithoutFramePointer"));
+  EXPECT_TRUE(StackHasFunction(stack + 1, 1, "OmitFramePointer"));
+}
+
+static void* signal_stack[32];
+static int signal_stack_depth = 0;
+
+static void GetStackTraceInHandler(int) {
+  signal_stack_depth = GetStackTrace(signal_stack, 32, 0);
+}
+
+static void __attribute__((noinline)) RaiseSignal() {
+  raise(SIGUSR2);
+}
+
+TEST(CfiUnwinderTest, SignalFrame) {
+  struct sigaction action, old_action;
+  memset(&action, 0, sizeof(action));
+  sigemptyset(&action.sa_mask);
+  action.sa_handler = &GetStackTraceInHandler;
+  sigaction(SIGUSR2, &action, &old_action);
+  RaiseSignal();
+  sigaction(SIGUSR2, &old_action, NULL);
+  // Through the signal trampoline, back to the code that raised it.
+  EXPECT_TRUE(StackHasFunction(signal_stack, signal_stack_depth,
+                               "RaiseSignal"));
+  EXPECT_TRUE(StackHasFunction(signal_stack, signal_stack_depth,
+                               "SignalFrame"));
+}
+
+// The module of "snapshot" whose path contains "name", or NULL.
+static const LoadedModules::Module* FindModuleNamed(
+    const LoadedModules::Snapshot* snapshot, const char* name) {
+  for (size_t i = 0; i < snapshot->count; ++i) {
+    if (strstr(snapshot->modules[i].path, name) != NULL) {
+      return &snapshot->modules[i];
+    }
+  }
+  return NULL;
+}
+
+TEST(LoadedModulesTest, FreesReplacedSnapshots) {
+  LoadedModules::Refresh();
+  EXPECT_EQ(0u, LoadedModules::retired());
+  void* handle;
+  {
+    LoadedModules::Reader reader;
+    const LoadedModules::Snapshot* before = reader.snapshot();
+    ASSERT_TRUE(before != NULL);
+    handle = dlopen("libBrokenLocale.so.1", RTLD_NOW);
+    ASSERT_TRUE(handle != NULL) << dlerror();
+    LoadedModules::Refresh();
+    {
+      LoadedModules::Reader after;
+      EXPECT_NE(before, after.snapshot());
+      EXPECT_TRUE(FindModuleNamed(after.snapshot(), "libBrokenLocale"));
+    }
+    // Still read: kept, and still usable.
+    EXPECT_EQ(1u, LoadedModules::retired());
+    EXPECT_FALSE(FindModuleNamed(before, "libBrokenLocale"));
+    const uintptr_t pc = reinterpret_cast<uintptr_t>(&FindModuleNamed);
+    const LoadedModules::Module* module = LoadedModules::Find(before, pc);
+    ASSERT_TRUE(module != NULL);
+    EXPECT_TRUE(module->main_program);
+  }
+  // Freed once nobody reads it, even if nothing changed since.
+  LoadedModules::Refresh();
+  EXPECT_EQ(0u, LoadedModules::retired());
+  dlclose(handle);
+  LoadedModules::Refresh();
+  EXPECT_EQ(0u, LoadedModules::retired());
+  LoadedModules::Reader reader;
+  EXPECT_FALSE(FindModuleNamed(reader.snapshot(), "libBrokenLocale"));
+}
+
+static void __attribute__((noinline)) RaiseSignalOnSignalStack() {
+  raise(SIGUSR2);
+}
+
+TEST(StackBoundsTest, SignalStack) {
+  StackBounds::Learn();
+  ASSERT_TRUE(StackBounds::known());
+  int local;
+  EXPECT_TRUE(StackBounds::Contains(reinterpret_cast<uintptr_t>(&local),
+                                    sizeof(local)));
+  EXPECT_FALSE(StackBounds::Contains(reinterpret_cast<uintptr_t>(&local) +
+                                     (64 << 20), sizeof(local)));
+
+  // A signal stack installed after Learn().
+  vector<char> memory(64 * 1024);
+  stack_t alternate_stack, old_alternate_stack;
+  alternate_stack.ss_sp = &memory[0];
+  alternate_stack.ss_size = memory.size();
+  alternate_stack.ss_flags = 0;
+  ASSERT_EQ(0, sigaltstack(&alternate_stack, &old_alternate_stack));
+  struct sigaction action, old_action;
+  memset(&action, 0, sizeof(action));
+  sigemptyset(&action.sa_mask);
+  action.sa_handler = &GetStackTraceInHandler;
+  action.sa_flags = SA_ONSTACK;
+  sigaction(SIGUSR2, &action, &old_action);
+  signal_stack_depth = 0;
+  RaiseSignalOnSignalStack();
+  sigaction(SIGUSR2, &old_action, NULL);
+  sigaltstack(&old_alternate_stack, NULL);
+
+  EXPECT_TRUE(StackHasFunction(signal_stack, signal_stack_depth,
+                               "RaiseSignalOnSignalStack"));
+}
+
+static ucontext_t main_context, unwind_context;
+static void* context_stack[32];
+static int context_stack_depth = 0;
+
+static void __attribute__((noinline)) UnwindOnContextStack() {
+  context_stack_depth = GetStackTrace(context_stack, 32, 0);
+  __asm__ volatile("");   // not a tail call
+}
+
+static void RunOnContextStack() {
+  UnwindOnContextStack();
+  swapcontext(&unwind_context, &main_context);
+}
+
+TEST(StackBoundsTest, ContextStack) {
+  StackBounds::Learn();
+  ASSERT_TRUE(StackBounds::known());
+
+  // A stack of makecontext(), which is neither the thread's stack nor its
+  // signal stack.
+  vector<char> memory(256 * 1024);
+  ASSERT_EQ(0, getcontext(&unwind_context));
+  unwind_context.uc_stack.ss_sp = &memory[0];
+  unwind_context.uc_stack.ss_size = memory.size();
+  unwind_context.uc_link = &main_context;
+  makecontext(&unwind_context, &RunOnContextStack, 0);
+  context_stack_depth = 0;
+  ASSERT_EQ(0, swapcontext(&main_context, &unwind_context));
+
+  EXPECT_TRUE(StackHasFunction(context_stack, context_stack_depth,
+                               "RunOnContextStack"));
+  // Back on the thread's stack, the bounds apply again.
+  void* stack[32];
+  GetStackTrace(stack, 32, 0);
+  EXPECT_TRUE(StackBounds::known());
+}
+
+TEST(DemangleCacheTest, MatchesDemangle) {
+  const char* const names[] = {
+    "_ZN3FooC1Ev", "_ZN1N1fE", "_Z1fIiEvi", "_ZN3Foo3BarEv@@GLIBCXX_3.4",
+    "_Z3foo3bar.clone.3", "_Z1", "main", "",
+  };
+  // Twice each: the second time comes from the cache.
+  for (int pass = 0; pass < 2; ++pass) {
+    for (size_t i = 0; i < ARRAYSIZE(names); ++i) {
+      for (int out_size = 1; out_size <= 32; out_size *= 2) {
+        char expected[32], cached[32];
+        const bool ok = Demangle(names[i], expected, out_size);
+        ASSERT_EQ(ok, DemangleCache::Demangle(names[i], cached, out_size))
+            << names[i] << " " << out_size;
+        if (ok) {
+          EXPECT_STREQ(expected, cached);
+        }
+      }
+    }
+  }
+}
+
+static int* volatile null_pointer = NULL;
+
+static void ATTRIBUTE_NOINLINE CrashWithSegv() {
+  *null_pointer = 0;
+}
+
+TEST(FailureSignalHandlerTest, ReportsAndDies) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  const pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    struct rlimit no_core = { 0, 0 };
+    setrlimit(RLIMIT_CORE, &no_core);
+    dup2(fds[1], STDERR_FILENO);
+    FLAGS_failure_signal_handler = true;
+    FailureSignalHandler::Init();
+    CrashWithSegv();
+    _exit(0);
+  }
+  close(fds[1]);
+  string report;
+  char buf[4096];
+  ssize_t n;
+  while ((n = read(fds[0], buf, sizeof(buf))) > 0) report.append(buf, n);
+  close(fds[0]);
+  int status;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+
+  ASSERT_TRUE(WIFSIGNALED(status));
+  EXPECT_EQ(SIGSEGV, WTERMSIG(status));
+  EXPECT_NE(string::npos, report.find("*** SIGSEGV (@0x0) received by PID"))
+      << report;
+  EXPECT_NE(string::npos, report.find("PC: @ ")) << report;
+  EXPECT_NE(string::npos, report.find("CrashWithSegv")) << report;
+}
+
+TEST(RawLoggingTest, LocalTimePrefix) {
+  const int64 errors = raw_num_messages(GLOG_ERROR);
+  CaptureTestStderr();
+  const time_t before = time(NULL);
+  RAW_LOG(ERROR, "raw %d", 48);
+  const time_t after = time(NULL);
+  const string output = GetCapturedTestStderr();
+
+  EXPECT_EQ(errors + 1, raw_num_messages(GLOG_ERROR));
+  // As localtime_r() has it, at one of the two seconds.
+  bool found = false;
+  for (time_t t = before; t <= after; ++t) {
+    struct tm tm_time;
+    localtime_r(&t, &tm_time);
+    char prefix[32];
+    snprintf(prefix, sizeof(prefix), "E%02d%02d %02d:%02d:%02d.",
+             1 + tm_time.tm_mon, tm_time.tm_mday, tm_time.tm_hour,
+             tm_time.tm_min, tm_time.tm_sec);
+    if (output.compare(0, strlen(prefix), prefix) == 0) found = true;
+  }
+  EXPECT_TRUE(found) << output;
+  EXPECT_NE(string::npos, output.find(" logging_unittest.cc:"));
+  EXPECT_NE(string::npos, output.find("] RAW: raw 48\n")) << output;
+}
+
+TEST(LogClockTest, Sources) {
+  const int64 realtime = LogClock::NowNanos(LogClock::kRealtime);
+  // The coarse clock lags by up to a tick.
+  EXPECT_LT(llabs(LogClock::NowNanos(LogClock::kCoarse) - realtime),
+            100 * 1000 * 1000);
+
+  FLAGS_log_clock = "tsc";
+  LogClock::Init();
+  if (LogClock::source() == LogClock::kTsc) {
+    // Past the first calibration.
+    usleep(50 * 1000);
+    const int64 tsc = LogClock::NowNanos();
+    EXPECT_LT(llabs(tsc - LogClock::NowNanos(LogClock::kRealtime)), 1000000);
+  }
+  FLAGS_log_clock = "realtime";
+  LogClock::Init();
+  EXPECT_EQ(LogClock::kRealtime, LogClock::source());
+}
+
+TEST(LogClockTest, Fork) {
+  FLAGS_log_clock = "tsc";
+  LogClock::Init();
+  const bool tsc = LogClock::source() == LogClock::kTsc;
+  FLAGS_log_clock = "realtime";
+  LogClock::Init();
+  if (!tsc) return;  // no invariant TSC
+  for (int i = 0; i < 100 && !LogClock::calibrated(); ++i) usleep(10 * 1000);
+  ASSERT_TRUE(LogClock::calibrated());
+
+  // The child drops the parent's calibration and calibrates again.
+  const pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    if (LogClock::calibrated()) _exit(1);
+    const int64 realtime = LogClock::NowNanos(LogClock::kRealtime);
+    if (llabs(LogClock::NowNanos(LogClock::kTsc) - realtime) > 1000000) {
+      _exit(2);
+    }
+    for (int i = 0; i < 100 && !LogClock::calibrated(); ++i) {
+      usleep(10 * 1000);
+    }
+    if (!LogClock::calibrated()) _exit(3);
+    _exit(0);
+  }
+  int status;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+}
+
+static void* LogFromNamedThread(void* tid) {
+  SetThreadLogName("worker");
+  *static_cast<pid_t*>(tid) = ThreadContext::tid();
+  LOG(ERROR) << "from a named thread";
+  RAW_LOG(ERROR, "raw from a named thread");
+  // Names can't break the prefix apart.
+  SetThreadLogName("a b]c\td[");
+  EXPECT_STREQ("a_b_c_d_", ThreadContext::name());
+  EXPECT_STREQ("[a_b_c_d_] ", ThreadContext::name_field());
+  SetThreadLogName(NULL);
+  EXPECT_STREQ("", ThreadContext::name_field());
+  return NULL;
+}
+
+TEST(ThreadContextTest, TidAndName) {
+  EXPECT_EQ(getpid(), ThreadContext::tid());
+  EXPECT_STREQ("", ThreadContext::name());
+
+  pid_t worker_tid = 0;
+  CaptureTestStderr();
+  pthread_t thread;
+  ASSERT_EQ(0, pthread_create(&thread, NULL, &LogFromNamedThread,
+                              &worker_tid));
+  pthread_join(thread, NULL);
+  const string output = GetCapturedTestStderr();
+  EXPECT_NE(getpid(), worker_tid);
+  char field[64];
+  // The threadid field is the tid alone; the name starts the message.
+  snprintf(field, sizeof(field), " %5d logging_unittest.cc:",
+           static_cast<int>(worker_tid));
+  EXPECT_NE(string::npos, output.find(field)) << output;
+  EXPECT_NE(string::npos, output.find("] [worker] from a named thread\n"))
+      << output;
+  EXPECT_NE(string::npos,
+            output.find("] RAW: [worker] raw from a named thread\n"))
+      << output;
+
+  // The child of a fork() doesn't keep the parent's tid.
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  const pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    const pid_t tid = ThreadContext::tid();
+    _exit(write(fds[1], &tid, sizeof(tid)) == sizeof(tid) ? 0 : 1);
+  }
+  close(fds[1]);
+  pid_t child_tid = 0;
+  EXPECT_EQ(static_cast<ssize_t>(sizeof(child_tid)),
+            read(fds[0], &child_tid, sizeof(child_tid)));
+  close(fds[0]);
+  waitpid(pid, NULL, 0);
+  EXPECT_EQ(pid, child_tid);
+}
+
+static void __attribute__((noinline)) InternedStackTrace(string* trace,
+                                                        int* full_trace_id) {
+  GOOGLE_NAMESPACE::glog_internal_namespace_::DumpStackTraceToString(
+      trace, GLOG_WARNING, full_trace_id);
+  __asm__ volatile("");   // not a tail call
+}
+
+TEST(StackTraceTableTest, Intern) {
+  void* const trace[] = {
+    reinterpret_cast<void*>(&LogFromOneSite),
+    reinterpret_cast<void*>(&LogEvery10Thread),
+  };
+  bool first;
+  const int id = StackTraceTable::Intern(trace, 2, &first);
+  ASSERT_GT(id, 0);
+  EXPECT_TRUE(first);
+  EXPECT_EQ(id, StackTraceTable::Intern(trace, 2, &first));
+  EXPECT_FALSE(first);
+  EXPECT_NE(id, StackTraceTable::Intern(trace, 1, &first));
+  EXPECT_TRUE(first);
+
+  // The same call site (one, even when the loop is unrolled) every time.
+  FLAGS_intern_stacktraces = true;
+  string traces[5];
+  int full_trace_ids[5];
+  for (int i = 0; i < 5; i++) {
+    InternedStackTrace(&traces[i], &full_trace_ids[i]);
+    if (i == 1 || i == 3) {
+      // The message with the trace has been written.
+      StackTraceTable::MarkEmitted(full_trace_ids[i], GLOG_WARNING);
+    } else if (i == 2) {
+      EXPECT_TRUE(StackTraceTable::Emitted(full_trace_ids[1], GLOG_INFO));
+      EXPECT_FALSE(StackTraceTable::Emitted(full_trace_ids[1], GLOG_ERROR));
+      StackTraceTable::NewLogFile(GLOG_INFO);
+    }
+  }
+  FLAGS_intern_stacktraces = false;
+  int trace_id;
+  ASSERT_EQ(1, sscanf(traces[0].c_str(), "trace#%d:\n", &trace_id));
+  EXPECT_NE(string::npos, traces[0].find("    @ "));
+  EXPECT_EQ(trace_id, full_trace_ids[0]);
+  // Not written yet: in full again.
+  EXPECT_EQ(traces[0], traces[1]);
+  EXPECT_EQ(trace_id, full_trace_ids[1]);
+  // Written: by id only, until a new log file starts.
+  char again[32];
+  snprintf(again, sizeof(again), "trace#%d\n", trace_id);
+  EXPECT_EQ(again, traces[2]);
+  EXPECT_EQ(0, full_trace_ids[2]);
+  EXPECT_EQ(traces[0], traces[3]);
+  EXPECT_EQ(again, traces[4]);
+}
+
+static string ReadFileToString(const string& path) {
+  string contents;
+  FILE* file = fopen(path.c_str(), "rb");
+  if (file == NULL) return contents;
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), file)) > 0) contents.append(buf, n);
+  fclose(file);
+  return contents;
+}
+
+static off_t FileSize(const string& path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 ? st.st_size : -1;
+}
+
+TEST(DirectFileWriterTest, PaddingAndTail) {
+  char path[] = "/tmp/direct_writer_test.XXXXXX";
+  const int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  DirectFileWriter writer;
+  if (!writer.Attach(fd)) {
+    // No O_DIRECT on this file system.
+    close(fd);
+    unlink(path);
+    return;
+  }
+  // Across both buffers, ending in a partial block.
+  string expected;
+  for (int i = 0; expected.size() < DirectFileWriter::kBufferSize + 5000;
+       ++i) {
+    char line[64];
+    snprintf(line, sizeof(line), "direct line %d\n", i);
+    expected += line;
+    writer.Append(line, strlen(line));
+  }
+  writer.Flush();
+  EXPECT_EQ(0, writer.error());
+  EXPECT_EQ((off_t)expected.size(), FileSize(path));
+  EXPECT_TRUE(expected == ReadFileToString(path));
+
+  // The partial tail block is rewritten in place, then padded again.
+  writer.Append("tail", 4);
+  expected += "tail";
+  writer.FlushUnsafe();
+  EXPECT_EQ((off_t)expected.size(), FileSize(path));
+  EXPECT_TRUE(expected == ReadFileToString(path));
+
+  writer.Append(" and close\n", 11);
+  expected += " and close\n";
+  writer.Close();
+  EXPECT_EQ(-1, writer.fd());
+  EXPECT_TRUE(expected == ReadFileToString(path));
+
+  // A second writer continues a file that ends in a partial block,
+  // which it reads back.
+  const int again = open(path, O_RDWR);
+  ASSERT_GE(again, 0);
+  DirectFileWriter continued;
+  ASSERT_TRUE(continued.Attach(again));
+  continued.Append("more\n", 5);
+  expected += "more\n";
+  continued.Close();
+  EXPECT_EQ(0, continued.error());
+  EXPECT_TRUE(expected == ReadFileToString(path));
+  unlink(path);
+}
+
+// A fresh directory under /tmp, for log files.
+static string MakeTestDirectory() {
+  char dir[] = "/tmp/logging_unittest.XXXXXX";
+  return mkdtemp(dir) != NULL ? dir : "";
+}
+
+// Remove "dir" and the files in it.
+static void RemoveTestDirectory(const string& dir) {
+  DIR* d = opendir(dir.c_str());
+  if (d == NULL) return;
+  while (struct dirent* entry = readdir(d)) {
+    if (entry->d_name[0] != '.') unlink((dir + "/" + entry->d_name).c_str());
+  }
+  closedir(d);
+  rmdir(dir.c_str());
+}
+
+TEST(RawLoggingTest, LogFile) {
+  const string dir = MakeTestDirectory();
+  ASSERT_FALSE(dir.empty());
+  const pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    // The first LOG() of the child starts a new log file, and links it
+    // into "dir".
+    FLAGS_logtostderr = false;
+    FLAGS_alsologtostderr = false;
+    FLAGS_stderrthreshold = GLOG_FATAL;
+    FLAGS_logbuflevel = -1;  // not buffered
+    FLAGS_log_link = dir;
+    LOG(INFO) << "opened";
+    RAW_LOG(INFO, "raw %d in the file", 48);
+    RAW_LOG(WARNING, "raw %d in the file", 49);
+    _exit(0);
+  }
+  int status;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  const string link = dir + "/" +
+      GOOGLE_NAMESPACE::glog_internal_namespace_::ProgramInvocationShortName() + ".INFO";
+  const string contents = ReadFileToString(link);
+  const size_t opened = contents.find("] opened\n");
+  const size_t raw = contents.find("] RAW: raw 48 in the file\n");
+  EXPECT_NE(string::npos, opened) << contents;
+  EXPECT_NE(string::npos, raw) << contents;
+  EXPECT_LT(opened, raw);
+  // A WARNING goes to the INFO file as well, as a whole line.
+  const size_t warning = contents.find("] RAW: raw 49 in the file\n");
+  ASSERT_NE(string::npos, warning) << contents;
+  EXPECT_EQ('W', contents[contents.rfind('\n', warning) + 1]);
+
+  char target[4096];
+  const ssize_t n = readlink(link.c_str(), target, sizeof(target) - 1);
+  if (n > 0) {
+    target[n] = '\0';
+    unlink(target);
+  }
+  RemoveTestDirectory(dir);
+}
+
+static uint64 SyncCount() {
+  LogStats::Snapshot snapshot;
+  LogStats::GetSnapshot(&snapshot);
+  return snapshot.counters[LogStats::kSyncs];
+}
+
+struct SyncThreadArg {
+  LogFileObject* file;
+  int writes;
+};
+
+static void* WriteAndSyncThread(void* arg) {
+  SyncThreadArg* sync_arg = static_cast<SyncThreadArg*>(arg);
+  for (int i = 0; i < sync_arg->writes; ++i) {
+    sync_arg->file->Write(false, time(NULL), "sync me\n", 8);
+    sync_arg->file->Sync();
+  }
+  return NULL;
+}
+
+// Holds the first leader of a Sync() until the followers have written.
+static CondVar sync_gate;
+static bool sync_leader_held = false;     // under sync_gate
+static bool sync_leader_released = false;  // under sync_gate
+static int follower_writes = 0;            // under sync_gate
+
+static void HoldSyncLeader() {
+  CondVarLock l(&sync_gate);
+  sync_leader_held = true;
+  sync_gate.SignalAll();
+  while (!sync_leader_released) sync_gate.Wait();
+}
+
+static void* FollowerThread(void* arg) {
+  LogFileObject* file = static_cast<LogFileObject*>(arg);
+  file->Write(false, time(NULL), "follower\n", 9);
+  {
+    CondVarLock l(&sync_gate);
+    ++follower_writes;
+    sync_gate.SignalAll();
+  }
+  file->Sync();
+  return NULL;
+}
+
+static void* LeaderThread(void* arg) {
+  LogFileObject* file = static_cast<LogFileObject*>(arg);
+  file->Write(false, time(NULL), "leader\n", 7);
+  file->Sync();
+  return NULL;
+}
+
+TEST(LogFileObjectTest, GroupCommitSync) {
+  FlagSaver<int32> logsynclevel_saver(FLAGS_logsynclevel);
+  FLAGS_logsynclevel = GLOG_ERROR;
+  const string dir = MakeTestDirectory();
+  ASSERT_FALSE(dir.empty());
+  {
+    LogFileObject file(GLOG_ERROR, (dir + "/sync.").c_str());
+    file.SetSymlinkBasename("");
+
+    // Nothing written, nothing to sync.
+    uint64 syncs = SyncCount();
+    file.Sync();
+    EXPECT_EQ(syncs, SyncCount());
+
+    // One sync covers every write before it, whoever wrote them.
+    for (int i = 0; i < 3; ++i) file.Write(false, time(NULL), "one\n", 4);
+    file.Sync();
+    EXPECT_EQ(syncs + 1, SyncCount());
+    file.Sync();
+    file.Sync();
+    EXPECT_EQ(syncs + 1, SyncCount());
+
+    // A later write needs a sync of its own.
+    file.Write(false, time(NULL), "two\n", 4);
+    file.Sync();
+    EXPECT_EQ(syncs + 2, SyncCount());
+
+    // No concurrent writer returns before its own write is durable:
+    // afterwards there is nothing left to sync.
+    const int kThreads = 8;
+    const int kWrites = 50;
+    syncs = SyncCount();
+    pthread_t threads[kThreads];
+    SyncThreadArg arg = { &file, kWrites };
+    for (int i = 0; i < kThreads; ++i) {
+      ASSERT_EQ(0, pthread_create(&threads[i], NULL, &WriteAndSyncThread,
+                                  &arg));
+    }
+    for (int i = 0; i < kThreads; ++i) pthread_join(threads[i], NULL);
+    const uint64 concurrent_syncs = SyncCount() - syncs;
+    EXPECT_GE(concurrent_syncs, 1u);
+    file.Sync();
+    EXPECT_EQ(syncs + concurrent_syncs, SyncCount());
+
+    // While a leader is syncing, the writes behind it wait and then
+    // share one more sync, whichever thread leads it.
+    syncs = SyncCount();
+    sync_leader_held = sync_leader_released = false;
+    follower_writes = 0;
+    LogFileObject::SetSyncHook(&HoldSyncLeader);
+    pthread_t leader;
+    ASSERT_EQ(0, pthread_create(&leader, NULL, &LeaderThread, &file));
+    {
+      CondVarLock l(&sync_gate);
+      while (!sync_leader_held) sync_gate.Wait();
+    }
+    pthread_t followers[kThreads];
+    for (int i = 0; i < kThreads; ++i) {
+      ASSERT_EQ(0, pthread_create(&followers[i], NULL, &FollowerThread,
+                                  &file));
+    }
+    {
+      CondVarLock l(&sync_gate);
+      while (follower_writes < kThreads) sync_gate.Wait();
+      sync_leader_released = true;
+      sync_gate.SignalAll();
+    }
+    pthread_join(leader, NULL);
+    for (int i = 0; i < kThreads; ++i) pthread_join(followers[i], NULL);
+    LogFileObject::SetSyncHook(NULL);
+    EXPECT_EQ(syncs + 2, SyncCount());
+  }
+  RemoveTestDirectory(dir);
+}
+
+// All the gzip members of "path", decompressed.
+static string ReadGzipFile(const string& path) {
+  string contents;
+  gzFile file = gzopen(path.c_str(), "rb");
+  if (file == NULL) return contents;
+  char buf[4096];
+  int n;
+  while ((n = gzread(file, buf, sizeof(buf))) > 0) contents.append(buf, n);
+  gzclose(file);
+  return contents;
+}
+
+// The one file in "dir" whose name ends in "suffix", or "".
+static string FindFile(const string& dir, const string& suffix) {
+  string found;
+  DIR* d = opendir(dir.c_str());
+  if (d == NULL) return found;
+  while (struct dirent* entry = readdir(d)) {
+    const string name = entry->d_name;
+    if (name.size() >= suffix.size() &&
+        name.compare(name.size() - suffix.size(), suffix.size(),
+                     suffix) == 0) {
+      found = dir + "/" + name;
+    }
+  }
+  closedir(d);
+  return found;
+}
+
+TEST(LogCompressorTest, StoreBlock) {
+  const string dir = MakeTestDirectory();
+  ASSERT_FALSE(dir.empty());
+  // Empty, and across stored blocks.
+  const size_t sizes[] = { 0, 100, 65535, 65536, 200000 };
+  for (size_t i = 0; i < ARRAYSIZE(sizes); ++i) {
+    string data;
+    for (size_t j = 0; j < sizes[i]; ++j) data.push_back('a' + j * 7 % 26);
+    string stored, compressed;
+    LogCompressor compressor;
+    ASSERT_TRUE(compressor.CompressBlock(data.data(), data.size(),
+                                         &compressed));
+    LogCompressor::StoreBlock(data.data(), data.size(), &stored);
+    FILE* file = fopen((dir + "/stored.gz").c_str(), "wb");
+    ASSERT_TRUE(file != NULL);
+    fwrite(stored.data(), 1, stored.size(), file);
+    fwrite(compressed.data(), 1, compressed.size(), file);
+    fclose(file);
+    EXPECT_TRUE(data + data == ReadGzipFile(dir + "/stored.gz")) << sizes[i];
+  }
+  RemoveTestDirectory(dir);
+}
+
+TEST(LogFileObjectTest, CompressedRoundTrip) {
+  FlagSaver<bool> log_compress_saver(FLAGS_log_compress);
+  FlagSaver<bool> log_compress_defer_flush_saver(
+      FLAGS_log_compress_defer_flush);
+  FLAGS_log_compress = true;
+  const string dir = MakeTestDirectory();
+  ASSERT_FALSE(dir.empty());
+  {
+    LogFileObject file(GLOG_INFO, (dir + "/compressed.").c_str());
+    file.SetSymlinkBasename("");
+    string expected;
+    // More than a block's worth, so that some blocks end on size.
+    for (int i = 0; i < 5000; ++i) {
+      char line[64];
+      snprintf(line, sizeof(line), "I1019 12:00:00.000000 1 f.cc:1] %d\n", i);
+      expected += line;
+      file.Write(false, time(NULL), line, strlen(line));
+    }
+    const string path = FindFile(dir, ".gz");
+    ASSERT_FALSE(path.empty());
+
+    // A forced flush (of a WARNING line) ends the block right away.
+    file.Flush();
+    off_t flushed_size = FileSize(path);
+    file.Write(true, time(NULL), "W1019 forced\n", 13);
+    expected += "W1019 forced\n";
+    EXPECT_LT(flushed_size, FileSize(path));
+
+    // Unless deferred: then forced flushes don't end a gzip member each.
+    FLAGS_log_compress_defer_flush = true;
+    flushed_size = FileSize(path);
+    for (int i = 0; i < 100; ++i) {
+      file.Write(true, time(NULL), "W1019 deferred\n", 15);
+      expected += "W1019 deferred\n";
+    }
+    EXPECT_EQ(flushed_size, FileSize(path));
+    file.Flush();
+    EXPECT_LT(flushed_size, FileSize(path));
+
+    const string contents = ReadGzipFile(path);
+    const size_t header_end = contents.find("msg\n");
+    ASSERT_NE(string::npos, header_end);
+    EXPECT_TRUE(expected == contents.substr(header_end + 4));
+  }
+  RemoveTestDirectory(dir);
+}
+
+TEST(LogFileObjectTest, DirectIoFork) {
+  FlagSaver<bool> log_direct_io_saver(FLAGS_log_direct_io);
+  FLAGS_log_direct_io = true;
+  const string dir = MakeTestDirectory();
+  const string warning_dir = MakeTestDirectory();
+  ASSERT_FALSE(dir.empty());
+  ASSERT_FALSE(warning_dir.empty());
+  {
+    // Two files: only the first one the child writes sees PidHasChanged().
+    LogFileObject info(GLOG_INFO, (dir + "/direct.").c_str());
+    LogFileObject warning(GLOG_WARNING, (warning_dir + "/direct.").c_str());
+    info.SetSymlinkBasename("");
+    warning.SetSymlinkBasename("");
+    // More than a buffer, so that the writer threads have work in flight.
+    const string line = string(1000, 'p') + "\n";
+    size_t lines = 0;
+    for (; lines * line.size() < 2 * DirectFileWriter::kBufferSize; ++lines) {
+      info.Write(false, time(NULL), line.data(), line.size());
+      warning.Write(false, time(NULL), line.data(), line.size());
+    }
+
+    const pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+      alarm(10);  // rather than hang on the parent's writer threads
+      info.Write(true, time(NULL), "child info\n", 11);
+      warning.Write(true, time(NULL), "child warning\n", 14);
+      info.Flush();
+      warning.Flush();
+      _exit(0);
+    }
+    int status;
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0) << status;
+    info.Write(true, time(NULL), "parent info\n", 12);
+    info.Flush();
+
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%d", static_cast<int>(pid));
+    const string child_info = FindFile(dir, suffix);
+    const string child_warning = FindFile(warning_dir, suffix);
+    snprintf(suffix, sizeof(suffix), ".%d", static_cast<int>(getpid()));
+    const string parent_info = FindFile(dir, suffix);
+    ASSERT_FALSE(child_info.empty());
+    ASSERT_FALSE(child_warning.empty());
+    EXPECT_NE(string::npos,
+              ReadFileToString(child_info).find("child info\n"));
+    EXPECT_NE(string::npos,
+              ReadFileToString(child_warning).find("child warning\n"));
+    // The child's copy of the buffers went nowhere: the parent's file
+    // has each line once, and nothing of the child.
+    ASSERT_FALSE(parent_info.empty());
+    const string contents = ReadFileToString(parent_info);
+    size_t found = 0;
+    for (size_t pos = contents.find(line); pos != string::npos;
+         pos = contents.find(line, pos + line.size())) {
+      ++found;
+    }
+    EXPECT_EQ(lines, found);
+    EXPECT_EQ(string::npos, contents.find("child"));
+    EXPECT_EQ(contents.size() - 12, contents.find("parent info\n"));
+  }
+  RemoveTestDirectory(dir);
+  RemoveTestDirectory(warning_dir);
+}
+
+static LogIndexEntry MakeIndexEntry(uint64 offset, int64 first_time,
+                                    int64 last_time) {
+  LogIndexEntry entry;
+  memset(&entry, 0, sizeof(entry));
+  entry.offset = offset;
+  entry.first_time = first_time;
+  entry.last_time = last_time;
+  entry.counts[GLOG_INFO] = offset / 10;
+  return entry;
+}
+
+static bool SameIndex(const vector<LogIndexEntry>& a,
+                      const vector<LogIndexEntry>& b) {
+  return a.size() == b.size() &&
+         (a.empty() || memcmp(&a[0], &b[0], a.size() * sizeof(a[0])) == 0);
+}
+
+TEST(LogIndexTest, WriteReadAndFind) {
+  const string dir = MakeTestDirectory();
+  ASSERT_FALSE(dir.empty());
+  vector<LogIndexEntry> entries, read;
+  entries.push_back(MakeIndexEntry(0, 100, 110));
+  entries.push_back(MakeIndexEntry(1000, 110, 120));
+  entries.push_back(MakeIndexEntry(2000, 130, 130));
+  entries.push_back(MakeIndexEntry(3000, 130, 140));
+  ASSERT_TRUE(WriteLogIndex(dir + "/log.idx", entries));
+  ASSERT_TRUE(ReadLogIndex(dir + "/log.idx", &read));
+  EXPECT_TRUE(SameIndex(entries, read));
+
+  EXPECT_EQ(0u, FindLogIndexEntry(entries, 50));
+  EXPECT_EQ(0u, FindLogIndexEntry(entries, 110));
+  EXPECT_EQ(1u, FindLogIndexEntry(entries, 111));
+  // Between intervals, and the first of two that end at the same time.
+  EXPECT_EQ(2u, FindLogIndexEntry(entries, 125));
+  EXPECT_EQ(2u, FindLogIndexEntry(entries, 130));
+  EXPECT_EQ(3u, FindLogIndexEntry(entries, 131));
+  EXPECT_EQ(4u, FindLogIndexEntry(entries, 141));
+  EXPECT_EQ(0u, FindLogIndexEntry(vector<LogIndexEntry>(), 100));
+
+  ASSERT_TRUE(WriteLogIndex(dir + "/empty.idx", vector<LogIndexEntry>()));
+  EXPECT_TRUE(ReadLogIndex(dir + "/empty.idx", &read));
+  EXPECT_TRUE(read.empty());
+  FILE* file = fopen((dir + "/bad.idx").c_str(), "w");
+  fputs("GLOGIDX0", file);
+  fclose(file);
+  EXPECT_FALSE(ReadLogIndex(dir + "/bad.idx", &read));
+  EXPECT_FALSE(ReadLogIndex(dir + "/missing.idx", &read));
+  RemoveTestDirectory(dir);
+}
+
+// Write a log through LogFileObject with an index, and check that
+// BuildLogIndex() rebuilds the same index from the log alone.
+static void CheckBuildLogIndex(bool compress, bool framing) {
+  FlagSaver<bool> log_compress_saver(FLAGS_log_compress);
+  FlagSaver<bool> log_framing_saver(FLAGS_log_framing);
+  FlagSaver<int32> log_index_interval_kb_saver(FLAGS_log_index_interval_kb);
+  FLAGS_log_compress = compress;
+  FLAGS_log_framing = framing;
+  FLAGS_log_index_interval_kb = 4;
+  const string dir = MakeTestDirectory();
+  ASSERT_FALSE(dir.empty());
+  const time_t start = time(NULL) - 10000;
+  {
+    LogFileObject file(GLOG_INFO, (dir + "/indexed.").c_str());
+    file.SetSymlinkBasename("");
+    for (int i = 0; i < 3000; ++i) {
+      const time_t t = start + i / 10;
+      struct tm tm_time;
+      localtime_r(&t, &tm_time);
+      char line[128];
+      snprintf(line, sizeof(line),
+               "%c%02d%02d %02d:%02d:%02d.000000 1 f.cc:1] line %d\n",
+               "IWE"[i % 7 == 0 ? 2 : i % 3 == 0], 1 + tm_time.tm_mon,
+               tm_time.tm_mday, tm_time.tm_hour, tm_time.tm_min,
+               tm_time.tm_sec, i);
+      file.Write(false, t, line, strlen(line));
+    }
+  }
+  const string index_path = FindFile(dir, ".idx");
+  ASSERT_FALSE(index_path.empty());
+  const string log_path = index_path.substr(0, index_path.size() - 4);
+  vector<LogIndexEntry> written, built;
+  ASSERT_TRUE(ReadLogIndex(index_path, &written));
+  ASSERT_GE(written.size(), 2u);
+  ASSERT_TRUE(BuildLogIndex(log_path, 4 * 1024, &built));
+  EXPECT_TRUE(SameIndex(written, built));
+
+  // The interval that holds a time, by its bounds.
+  const int64 t = start + 150;
+  const size_t i = FindLogIndexEntry(built, t);
+  ASSERT_LT(i, built.size());
+  EXPECT_GE(built[i].last_time, t);
+  if (i > 0) {
+    EXPECT_LT(built[i - 1].last_time, t);
+  }
+  RemoveTestDirectory(dir);
+}
+
+TEST(LogIndexTest, BuildLogIndex) {
+  CheckBuildLogIndex(false, false);
+}
+
+TEST(LogIndexTest, BuildLogIndexCompressed) {
+  CheckBuildLogIndex(true, false);
+}
+
+TEST(LogIndexTest, BuildLogIndexFramed) {
+  CheckBuildLogIndex(false, true);
+}
+
+TEST(LogIndexTest, BuildLogIndexFramedAndCompressed) {
+  CheckBuildLogIndex(true, true);
+}
+
+static vector<string> ReadRing(const string& path) {
+  vector<string> records;
+  RingLogReader reader;
+  if (!reader.Open(path)) return records;
+  string record;
+  while (reader.Next(&record)) records.push_back(record);
+  return records;
+}
+
+static string RingRecord(int i) {
+  char record[32];
+  snprintf(record, sizeof(record), "record %d\n", i);
+  return record;
+}
+
+TEST(RingLogFileTest, AppendWrapAndReopen) {
+  const string dir = MakeTestDirectory();
+  ASSERT_FALSE(dir.empty());
+  const string path = dir + "/ring";
+  const uint64 kCapacity = 1024;
+  RingLogFile ring;
+  ASSERT_TRUE(ring.Open(path, kCapacity));
+  for (int i = 0; i < 10; ++i) {
+    ring.Append(RingRecord(i).data(), RingRecord(i).size());
+  }
+  vector<string> records = ReadRing(path);
+  ASSERT_EQ(10u, records.size());
+  EXPECT_EQ(RingRecord(0), records[0]);
+  EXPECT_EQ(RingRecord(9), records[9]);
+
+  // Wrap around several times: the newest records are kept, in order.
+  for (int i = 10; i < 300; ++i) {
+    ring.Append(RingRecord(i).data(), RingRecord(i).size());
+  }
+  records = ReadRing(path);
+  ASSERT_GT(records.size(), 10u);
+  ASSERT_LT(records.size(), 100u);
+  const int first = 300 - static_cast<int>(records.size());
+  for (size_t i = 0; i < records.size(); ++i) {
+    EXPECT_EQ(RingRecord(first + i), records[i]);
+  }
+  RingLogReader reader;
+  ASSERT_TRUE(reader.Open(path));
+  EXPECT_GT(reader.header().generation, 2u);
+  EXPECT_LE(reader.header().tail - reader.header().head, kCapacity);
+
+  // One writer at a time.
+  RingLogFile second;
+  EXPECT_FALSE(second.Open(path, kCapacity));
+  EXPECT_EQ(EWOULDBLOCK, errno);
+
+  // A reopened ring continues where it was.
+  ring.Close();
+  ASSERT_TRUE(ring.Open(path, kCapacity));
+  EXPECT_TRUE(records == ReadRing(path));
+  ring.Append(RingRecord(300).data(), RingRecord(300).size());
+  records = ReadRing(path);
+  EXPECT_EQ(RingRecord(300), records.back());
+  EXPECT_EQ(RingRecord(first + 1), records.front());
+
+  // Records longer than the ring are truncated to fit.
+  const string long_record(2 * kCapacity, 'x');
+  ring.Append(long_record.data(), long_record.size());
+  records = ReadRing(path);
+  ASSERT_EQ(1u, records.size());
+  EXPECT_EQ(kCapacity - sizeof(uint32), records[0].size());
+  ring.Close();
+  RemoveTestDirectory(dir);
+}
+
+TEST(RingLogFileTest, InconsistentRingIsReset) {
+  const string dir = MakeTestDirectory();
+  ASSERT_FALSE(dir.empty());
+  const string path = dir + "/ring";
+  const uint64 kCapacity = 1024;
+  {
+    RingLogFile ring;
+    ASSERT_TRUE(ring.Open(path, kCapacity));
+    for (int i = 0; i < 300; ++i) {
+      ring.Append(RingRecord(i).data(), RingRecord(i).size());
+    }
+  }
+  // A torn write leaves a bogus length at head.
+  RingLogReader reader;
+  ASSERT_TRUE(reader.Open(path));
+  const int fd = open(path.c_str(), O_WRONLY);
+  ASSERT_GE(fd, 0);
+  const uint32 bogus = 0xfffffff0;
+  ASSERT_EQ(static_cast<ssize_t>(sizeof(bogus)),
+            pwrite(fd, &bogus, sizeof(bogus), RingLogFile::kHeaderSize +
+                   reader.header().head % kCapacity));
+  close(fd);
+
+  RingLogFile ring;
+  ASSERT_TRUE(ring.Open(path, kCapacity));
+  EXPECT_TRUE(ReadRing(path).empty());
+  for (int i = 0; i < 300; ++i) {
+    ring.Append(RingRecord(i).data(), RingRecord(i).size());
+  }
+  EXPECT_EQ(RingRecord(299), ReadRing(path).back());
+  ring.Close();
+  RemoveTestDirectory(dir);
+}
+
+TEST(RingLogFileTest, OneProcessPerRing) {
+  FlagSaver<int32> log_ring_size_mb_saver(FLAGS_log_ring_size_mb);
+  FLAGS_log_ring_size_mb = 1;
+  const string dir = MakeTestDirectory();
+  ASSERT_FALSE(dir.empty());
+  const string base = dir + "/r.";
+  {
+    LogFileObject file(GLOG_INFO, base.c_str());
+    file.SetSymlinkBasename("");
+    file.Write(false, time(NULL), "parent\n", 7);
+
+    // The child of a fork() doesn't write into its parent's ring.
+    const pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+      file.Write(false, time(NULL), "child\n", 6);
+      _exit(0);
+    }
+    ASSERT_EQ(pid, waitpid(pid, NULL, 0));
+    file.Write(false, time(NULL), "parent again\n", 13);
+
+    vector<string> records = ReadRing(base + "ring");
+    ASSERT_EQ(3u, records.size());  // The file header, and two lines.
+    EXPECT_EQ("parent\n", records[1]);
+    EXPECT_EQ("parent again\n", records[2]);
+    char child_ring[32];
+    snprintf(child_ring, sizeof(child_ring), "ring.%d", static_cast<int>(pid));
+    records = ReadRing(base + child_ring);
+    ASSERT_EQ(2u, records.size());
+    EXPECT_EQ("child\n", records[1]);
+  }
+  RemoveTestDirectory(dir);
+}
+
+// Point --logmailer at a script that appends "<subject> -> <to>" and the
+// body of every mail to "dir/mail".
+static void UseTestMailer(const string& dir) {
+  const string mailer = dir + "/mailer";
+  FILE* script = fopen(mailer.c_str(), "w");
+  ASSERT_TRUE(script != NULL);
+  fprintf(script, "#!/bin/sh\n{ echo \"$2 -> $3\"; cat; } >> %s/mail\n",
+          dir.c_str());
+  fclose(script);
+  chmod(mailer.c_str(), 0755);
+  FLAGS_logmailer = mailer;
+}
+
+TEST(EmailNotifierTest, Digest) {
+  FlagSaver<string> logmailer_saver(FLAGS_logmailer);
+  FlagSaver<int32> logemail_interval_secs_saver(FLAGS_logemail_interval_secs);
+  FLAGS_logemail_interval_secs = 60;
+  const string dir = MakeTestDirectory();
+  ASSERT_FALSE(dir.empty());
+  UseTestMailer(dir);
+  const string mail = dir + "/mail";
+
+  EmailNotifier* notifier = EmailNotifier::Get();
+  ASSERT_TRUE(notifier != NULL);
+  notifier->Enqueue(GLOG_ERROR, "a@example.com", "first\n", 6);
+  notifier->Flush(5000);
+  string sent = ReadFileToString(mail);
+  EXPECT_EQ(0u, sent.find("[LOG] ERROR: "));
+  EXPECT_NE(string::npos, sent.find(" -> a@example.com\n"));
+  EXPECT_NE(string::npos, sent.find("\n\nfirst\n"));
+
+  // Within the interval, alerts wait to be coalesced into one digest.
+  notifier->Enqueue(GLOG_WARNING, "a@example.com", "second\n", 7);
+  notifier->Enqueue(GLOG_ERROR, "a@example.com", "third\n", 6);
+  usleep(200 * 1000);
+  EXPECT_EQ(sent, ReadFileToString(mail));
+  notifier->Flush(5000);
+  const string digest = ReadFileToString(mail).substr(sent.size());
+  EXPECT_EQ(0u, digest.find("[LOG] ERROR: "));
+  EXPECT_NE(string::npos, digest.find(" (2 messages) -> a@example.com\n"));
+  EXPECT_NE(string::npos, digest.find("\n\nsecond\nthird\n"));
+  RemoveTestDirectory(dir);
+}
+
+TEST(EmailNotifierTest, Fork) {
+  FlagSaver<string> logmailer_saver(FLAGS_logmailer);
+  const string dir = MakeTestDirectory();
+  ASSERT_FALSE(dir.empty());
+  UseTestMailer(dir);
+  ASSERT_TRUE(EmailNotifier::Get() != NULL);
+
+  // The child of a fork() starts a notifier thread of its own.
+  const pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    if (EmailNotifier::GetIfStarted() != NULL) _exit(1);
+    EmailNotifier* notifier = EmailNotifier::Get();
+    if (notifier == NULL) _exit(2);
+    notifier->Enqueue(GLOG_ERROR, "b@example.com", "from the child\n", 15);
+    notifier->Flush(5000);
+    _exit(0);
+  }
+  int status;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+  EXPECT_NE(string::npos, ReadFileToString(dir + "/mail").find(
+      "\n\nfrom the child\n"));
+  RemoveTestDirectory(dir);
+}
+
+// Read "fd" to the end.
+static string ReadFdToString(int fd) {
+  string contents;
+  char buf[4096];
+  ssize_t n;
+  while ((n = read(fd, buf, sizeof(buf))) != 0) {
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    contents.append(buf, n);
+  }
+  return contents;
+}
+
+// Fork a child whose stderr is a pipe; "*stderr_fd" is its read end.  The
+// AsyncStderrWriter is started once per process, so each test gets a
+// fresh one in a child.
+static pid_t ForkWithStderrPipe(int* stderr_fd) {
+  int fds[2];
+  if (pipe(fds) != 0) return -1;
+  const pid_t pid = fork();
+  if (pid == 0) {
+    dup2(fds[1], STDERR_FILENO);
+    close(fds[0]);
+    close(fds[1]);
+    return 0;
+  }
+  close(fds[1]);
+  *stderr_fd = fds[0];
+  return pid;
+}
+
+static size_t CountOccurrences(const string& s, const string& what) {
+  size_t count = 0;
+  for (size_t pos = s.find(what); pos != string::npos;
+       pos = s.find(what, pos + what.size())) {
+    ++count;
+  }
+  return count;
+}
+
+TEST(AsyncStderrWriterTest, OrderAndFatalDrain) {
+  int stderr_fd;
+  const pid_t pid = ForkWithStderrPipe(&stderr_fd);
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    FLAGS_logtostderr = true;
+    FLAGS_log_async_stderr = true;
+    for (int i = 0; i < 1000; ++i) LOG(INFO) << "line " << i << ".";
+    // The FATAL message drains the writer: nothing is left to exit().
+    LOG(FATAL) << "the end";
+    _exit(0);
+  }
+  const string output = ReadFdToString(stderr_fd);
+  close(stderr_fd);
+  int status;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  EXPECT_TRUE(WIFEXITED(status));
+  size_t pos = 0;
+  for (int i = 0; i < 1000; ++i) {
+    std::ostringstream line;
+    line << "] line " << i << ".\n";
+    pos = output.find(line.str(), pos);
+    ASSERT_NE(string::npos, pos) << line.str();
+  }
+  EXPECT_NE(string::npos, output.find("] the end\n", pos));
+}
+
+TEST(AsyncStderrWriterTest, Overflow) {
+  int ready[2];
+  ASSERT_EQ(0, pipe(ready));
+  int stderr_fd;
+  const pid_t pid = ForkWithStderrPipe(&stderr_fd);
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    close(ready[0]);
+    // Fill the pipe, so that the writer thread blocks on its first write
+    // and nothing leaves the buffer until the parent starts reading.
+    const int flags = fcntl(STDERR_FILENO, F_GETFL);
+    fcntl(STDERR_FILENO, F_SETFL, flags | O_NONBLOCK);
+    const char filler[512] = { 0 };
+    while (write(STDERR_FILENO, filler, sizeof(filler)) > 0) {
+    }
+    fcntl(STDERR_FILENO, F_SETFL, flags);
+
+    AsyncStderrWriter* writer = AsyncStderrWriter::Get();
+    if (writer == NULL) _exit(1);
+    const string info = string(1023, 'I') + "\n";
+    const string error = string(1023, 'E') + "\n";
+    for (int i = 0; i < 1000; ++i) {
+      writer->Write(GLOG_INFO, info.data(), info.size());
+    }
+    for (int i = 0; i < 300; ++i) {
+      writer->Write(GLOG_ERROR, error.data(), error.size());
+    }
+    if (write(ready[1], "x", 1) != 1) _exit(2);
+    if (!writer->Drain(10000)) _exit(3);
+    // The drop notice goes out with the next write, if not before.
+    writer->Write(GLOG_ERROR, "after\n", 6);
+    if (!writer->Drain(10000)) _exit(4);
+    _exit(0);
+  }
+  close(ready[1]);
+  char c;
+  ASSERT_EQ(1, read(ready[0], &c, 1));
+  close(ready[0]);
+  const string output = ReadFdToString(stderr_fd);
+  close(stderr_fd);
+  int status;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+
+  // INFO fills 3/4 of the buffer, ERROR the rest.
+  const size_t kMessages = AsyncStderrWriter::kBufferSize / 1024;
+  EXPECT_EQ(kMessages / 4 * 3, CountOccurrences(output, string(1023, 'I')));
+  EXPECT_EQ(kMessages / 4, CountOccurrences(output, string(1023, 'E')));
+  EXPECT_LT(output.rfind(string(1023, 'I')), output.find(string(1023, 'E')));
+
+  // The drops may be reported in two notices, depending on when the
+  // writer thread first woke up; the last one follows the messages.
+  const string kNotice = "stderr was blocked: dropped ";
+  unsigned long long dropped[NUM_SEVERITIES] = { 0 };
+  size_t notice_pos = string::npos;
+  for (size_t pos = output.find(kNotice); pos != string::npos;
+       pos = output.find(kNotice, pos + 1)) {
+    unsigned long long counts[NUM_SEVERITIES];
+    ASSERT_EQ(4, sscanf(output.c_str() + pos + kNotice.size(),
+                        "%llu INFO, %llu WARNING, %llu ERROR, %llu FATAL",
+                        &counts[0], &counts[1], &counts[2], &counts[3]));
+    for (int i = 0; i < NUM_SEVERITIES; ++i) dropped[i] += counts[i];
+    notice_pos = pos;
+  }
+  ASSERT_NE(string::npos, notice_pos);
+  EXPECT_EQ(1000 - kMessages / 4 * 3, dropped[GLOG_INFO]);
+  EXPECT_EQ(0u, dropped[GLOG_WARNING]);
+  EXPECT_EQ(300 - kMessages / 4, dropped[GLOG_ERROR]);
+  EXPECT_EQ(0u, dropped[GLOG_FATAL]);
+  EXPECT_LT(output.rfind(string(1023, 'E')), notice_pos);
+  EXPECT_EQ(output.size() - 6, output.find("after\n"));
+}
+
+TEST(AsyncStderrWriterTest, Fork) {
+  ASSERT_TRUE(AsyncStderrWriter::Get() != NULL);
+
+  // The child of a fork() starts a writer thread of its own.
+  int stderr_fd;
+  const pid_t pid = ForkWithStderrPipe(&stderr_fd);
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    if (AsyncStderrWriter::GetIfStarted() != NULL) _exit(1);
+    FLAGS_logtostderr = true;
+    FLAGS_log_async_stderr = true;
+    LOG(ERROR) << "from the child";
+    AsyncStderrWriter* writer = AsyncStderrWriter::GetIfStarted();
+    if (writer == NULL) _exit(2);
+    if (!writer->Drain(5000)) _exit(3);
+    _exit(0);
+  }
+  const string output = ReadFdToString(stderr_fd);
+  close(stderr_fd);
+  int status;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+  EXPECT_NE(string::npos, output.find("] from the child\n")) << output;
+}
+
+TEST(LogFramingTest, Crc32c) {
+  // The check value of CRC-32C.
+  ASSERT_EQ(0xe3069283u, Crc32c(0, "123456789", 9));
+  ASSERT_EQ(Crc32c(0, "123456789", 9),
+            Crc32c(Crc32c(0, "1234", 4), "56789", 5));
+}
+
+// Frame "records" the way LogFileObject does, with a sync marker every
+// "sync_every" records.
+static string FrameRecords(const vector<string>& records, int sync_every) {
+  string framed;
+  for (size_t i = 0; i < records.size(); ++i) {
+    if (i % sync_every == 0) {
+      char marker[kLogSyncMarkerSize];
+      EncodeLogSyncMarker(framed.size(), marker);
+      framed.append(marker, sizeof(marker));
+    }
+    char header[kLogFrameHeaderSize];
+    EncodeLogFrameHeader(records[i].data(), records[i].size(), header);
+    framed.append(header, sizeof(header));
+    framed.append(records[i]);
+  }
+  return framed;
+}
+
+TEST(LogFramingTest, TornTailAndCorruption) {
+  vector<string> records;
+  for (int i = 0; i < 10; ++i) {
+    records.push_back("I1019 12:00:00.000000 1 file.cc:1] record " +
+                      string(1, '0' + i) + "\n");
+  }
+  string framed = FrameRecords(records, 4);
+  ASSERT_EQ(framed.size(), FindLogFrameEnd(framed.data(), framed.size()));
+
+  // Tear the last record.
+  const size_t torn_len = framed.size() - 3;
+  ASSERT_EQ(framed.size() - kLogFrameHeaderSize - records[9].size(),
+            FindLogFrameEnd(framed.data(), torn_len));
+
+  // Corrupt record 1: records 2 and 3 are lost up to the next marker.
+  framed[kLogSyncMarkerSize + kLogFrameHeaderSize + records[0].size() +
+         kLogFrameHeaderSize + 5] ^= 1;
+  LogFrameReader reader(framed.data(), framed.size());
+  vector<string> read;
+  const char* payload;
+  uint32 len;
+  while (reader.Next(&payload, &len)) read.push_back(string(payload, len));
+  ASSERT_EQ((size_t)7, read.size());
+  ASSERT_EQ(records[0], read[0]);
+  ASSERT_EQ(records[4], read[1]);
+  ASSERT_EQ(records[9], read[6]);
+  ASSERT_EQ((uint64)1, reader.corrupt_regions());
+}
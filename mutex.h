@@ -47,6 +47,8 @@
 #define MUTEX_H_
 
 #include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
 typedef pthread_rwlock_t MutexType;
 
 #define MUTEX_NAMESPACE glog_internal_namespace_
@@ -65,6 +67,7 @@ class Mutex {
 
   inline void Lock();    // Block if needed until free then acquire exclusively
   inline void Unlock();  // Release a lock acquired via Lock()
+  inline bool TryLock(); // Acquire exclusively if free; true on success
   // Note that on systems that don't support read-write locks, these may
   // be implemented as synonyms to Lock() and Unlock().  So you can use
   // these for efficiency, but don't use them anyplace where being able
@@ -104,6 +107,9 @@ Mutex::Mutex() {
 Mutex::~Mutex()            { SAFE_PTHREAD(pthread_rwlock_destroy); }
 void Mutex::Lock()         { SAFE_PTHREAD(pthread_rwlock_wrlock); }
 void Mutex::Unlock()       { SAFE_PTHREAD(pthread_rwlock_unlock); }
+bool Mutex::TryLock() {
+  return is_safe_ ? pthread_rwlock_trywrlock(&mutex_) == 0 : true;
+}
 void Mutex::ReaderLock()   { SAFE_PTHREAD(pthread_rwlock_rdlock); }
 void Mutex::ReaderUnlock() { SAFE_PTHREAD(pthread_rwlock_unlock); }
 #undef SAFE_PTHREAD
@@ -149,6 +155,68 @@ private:
   void operator=(const WriterMutexLock&);
 };
 
+// A condition variable bundled with the plain pthread mutex it waits on.
+// Mutex above is a rwlock and can't be paired with pthread_cond_t, so
+// the few places that need to sleep until some state changes (background
+// writer threads and the like) use this instead.  Unlike Mutex it is not
+// safe to use during dynamic initialization; create it on the heap or as
+// a member of an object that is constructed after main() starts.
+class CondVar {
+public:
+  CondVar() {
+    if (pthread_mutex_init(&mutex_, NULL) != 0) abort();
+    if (pthread_cond_init(&cond_, NULL) != 0) abort();
+  }
+  ~CondVar() {
+    pthread_cond_destroy(&cond_);
+    pthread_mutex_destroy(&mutex_);
+  }
+
+  void Lock()   { if (pthread_mutex_lock(&mutex_) != 0) abort(); }
+  void Unlock() { if (pthread_mutex_unlock(&mutex_) != 0) abort(); }
+
+  // REQUIRES: the caller holds the lock.
+  void Wait() { pthread_cond_wait(&cond_, &mutex_); }
+
+  // Like Wait(), but gives up after "timeout_ms" milliseconds.  Returns
+  // false if the wait timed out.  REQUIRES: the caller holds the lock.
+  bool WaitWithTimeout(int timeout_ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000L;
+    }
+    return pthread_cond_timedwait(&cond_, &mutex_, &deadline) == 0;
+  }
+
+  void Signal()    { pthread_cond_signal(&cond_); }
+  void SignalAll() { pthread_cond_broadcast(&cond_); }
+
+private:
+  pthread_mutex_t mutex_;
+  pthread_cond_t cond_;
+
+  // Disallow "evil" constructors
+  CondVar(const CondVar&);
+  void operator=(const CondVar&);
+};
+
+// CondVarLock(cv) locks cv when constructed and unlocks it when destroyed.
+class CondVarLock {
+public:
+  explicit CondVarLock(CondVar *cv) : cv_(cv) { cv_->Lock(); }
+  ~CondVarLock() { cv_->Unlock(); }
+
+private:
+  CondVar * const cv_;
+  // Disallow "evil" constructors
+  CondVarLock(const CondVarLock&);
+  void operator=(const CondVarLock&);
+};
+
 #ifndef COMPILE_ASSERT
 template <bool>
 struct CompileAssert {};
@@ -160,6 +228,7 @@ struct CompileAssert {};
 #define MutexLock(x) COMPILE_ASSERT(0, mutex_lock_decl_missing_var_name)
 #define ReaderMutexLock(x) COMPILE_ASSERT(0, rmutex_lock_decl_missing_var_name)
 #define WriterMutexLock(x) COMPILE_ASSERT(0, wmutex_lock_decl_missing_var_name)
+#define CondVarLock(x) COMPILE_ASSERT(0, condvar_lock_decl_missing_var_name)
 
 }; // namespace MUTEX_NAMESPACE
 
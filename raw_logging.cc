@@ -42,6 +42,9 @@
 #include <time.h>
 #include "logging.h"          // To pick up flag settings etc.
 #include "raw_logging.h"
+#include "LogDestination.h"
+#include "MinimalFormatter.h"
+#include "ThreadContext.h"
 
 #ifdef HAVE_STACKTRACE
 # include "stacktrace.h"
@@ -65,43 +68,71 @@
 
 _START_GOOGLE_NAMESPACE_
 
-// Data for RawLog__ below. We simply pick up the latest
-// time data created by a normal log message to avoid calling
-// localtime_r which can allocate memory.
-static struct ::tm last_tm_time_for_raw_log;
-static int last_usecs_for_raw_log;
+// The local time zone for RawLog__ below, as seconds east of UTC. We
+// simply pick up the offset used by the latest normal log message to
+// avoid calling localtime_r which can allocate memory and takes a lock.
+static long raw_log_utc_offset = 0;
 
-void RawLog__SetLastTime(const struct ::tm& t, int usecs) {
-  memcpy(&last_tm_time_for_raw_log, &t, sizeof(last_tm_time_for_raw_log));
-  last_usecs_for_raw_log = usecs;
+void RawLog__SetLastTime(const struct ::tm& t, int /* usecs */) {
+  // Only store on change: every LogMessage calls this.
+  if (__atomic_load_n(&raw_log_utc_offset, __ATOMIC_RELAXED) != t.tm_gmtoff) {
+    __atomic_store_n(&raw_log_utc_offset, t.tm_gmtoff, __ATOMIC_RELAXED);
+  }
 }
 
-// CAVEAT: vsnprintf called from *DoRawLog below has some (exotic) code paths
-// that invoke malloc() and getenv() that might acquire some locks.
-// If this becomes a problem we should reimplement a subset of vsnprintf
-// that does not need locks and malloc.
-
-// Helper for RawLog__ below.
-// *DoRawLog writes to *buf of *size and move them past the written portion.
-// It returns true iff there was no overflow or error.
-static bool DoRawLog(char** buf, int* size, const char* format, ...) {
-  va_list ap;
-  va_start(ap, format);
-  int n = vsnprintf(*buf, *size, format, ap);
-  va_end(ap);
-  if (n < 0 || n > *size) return false;
-  *size -= n;
-  *buf += n;
-  return true;
+// Append "mmdd hh:mm:ss.uuuuuu" for the current local time to "out".
+// clock_gettime() is async-signal-safe (and a vDSO call on Linux); the
+// calendar arithmetic replaces localtime_r().
+static void AppendRawLogTime(MinimalFormatter* out) {
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  const int64 local = now.tv_sec +
+      __atomic_load_n(&raw_log_utc_offset, __ATOMIC_RELAXED);
+  int64 days = local / 86400;
+  int64 seconds = local % 86400;
+  if (seconds < 0) {
+    seconds += 86400;
+    --days;
+  }
+  // Days since 1970-01-01 to month and day, in the proleptic Gregorian
+  // calendar, counting years from March so that leap days come last.
+  days += 719468;
+  const int64 era = (days >= 0 ? days : days - 146096) / 146097;
+  const int64 day_of_era = days - era * 146097;
+  const int64 year_of_era = (day_of_era - day_of_era / 1460 +
+                             day_of_era / 36524 - day_of_era / 146096) / 365;
+  const int64 day_of_year = day_of_era - (365 * year_of_era +
+                                          year_of_era / 4 -
+                                          year_of_era / 100);
+  const int64 month_from_march = (5 * day_of_year + 2) / 153;
+  const int64 day = day_of_year - (153 * month_from_march + 2) / 5 + 1;
+  const int64 month = month_from_march < 10 ? month_from_march + 3
+                                            : month_from_march - 9;
+  out->AppendUint64(month, 10, 2);
+  out->AppendUint64(day, 10, 2);
+  out->AppendChar(' ');
+  out->AppendUint64(seconds / 3600, 10, 2);
+  out->AppendChar(':');
+  out->AppendUint64(seconds / 60 % 60, 10, 2);
+  out->AppendChar(':');
+  out->AppendUint64(seconds % 60, 10, 2);
+  out->AppendChar('.');
+  out->AppendUint64(now.tv_nsec / 1000, 10, 6);
 }
 
+// CAVEAT: vsnprintf called from VADoRawLog below has some (exotic) code
+// paths that invoke malloc() and getenv() that might acquire some locks.
+// The prefix is formatted without it; the message needs the format.
+
 // Helper for RawLog__ below.
-inline static bool VADoRawLog(char** buf, int* size,
+// Formats the message at out's cursor and moves it past the written
+// portion.  It returns true iff there was no overflow or error.
+inline static bool VADoRawLog(MinimalFormatter* out,
                               const char* format, va_list ap) {
-  int n = vsnprintf(*buf, *size, format, ap);
-  if (n < 0 || n > *size) return false;
-  *size -= n;
-  *buf += n;
+  const int size = out->remaining();
+  int n = vsnprintf(out->cur(), size, format, ap);
+  if (n < 0 || n >= size) return false;
+  out->Advance(n);
   return true;
 }
 
@@ -109,48 +140,57 @@ static const int kLogBufSize = 3000;
 static bool crashed = false;
 static CrashReason crash_reason;
 static char crash_buf[kLogBufSize + 1] = { 0 };  // Will end in '\0'
-// Number of messages sent at each severity. Under log_mutex.
+// Number of messages sent at each severity. Atomic.
 static int64 raw_num_messages_[NUM_SEVERITIES] = {0, 0, 0, 0};
 
 void RawLog__(LogSeverity severity, const char* file, int line,
               const char* format, ...) {
-  if (!(FLAGS_logtostderr || severity >= FLAGS_stderrthreshold ||
-        FLAGS_alsologtostderr || !IsGoogleLoggingInitialized())) {
-    return;  // this stderr log message is suppressed
+  const bool initialized = IsGoogleLoggingInitialized();
+  const bool to_stderr = FLAGS_logtostderr ||
+                         severity >= FLAGS_stderrthreshold ||
+                         FLAGS_alsologtostderr || !initialized;
+  const bool to_logfiles = initialized && !FLAGS_logtostderr;
+  if (!to_stderr && !to_logfiles) {
+    return;  // this log message is suppressed
   }
-  // can't call localtime_r here: it can allocate
-  struct ::tm& t = last_tm_time_for_raw_log;
   char buffer[kLogBufSize];
-  char* buf = buffer;
-  int size = sizeof(buffer);
+  // Room for the '\n' or the error message at the end.
+  static const char kTooLong[] = "RAW_LOG ERROR: The Message was too long!\n";
+  MinimalFormatter out(buffer, sizeof(buffer) - sizeof(kTooLong));
 
   // NOTE: this format should match the specification in base/logging.h
-  DoRawLog(&buf, &size, "%c%02d%02d %02d:%02d:%02d.%06d %5u %s:%d] RAW: ",
-           LogSeverityNames[severity][0],
-           1 + t.tm_mon, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec,
-           last_usecs_for_raw_log,
-           static_cast<unsigned int>(GetTID()),
-           const_basename(const_cast<char *>(file)), line);
+  out.AppendChar(LogSeverityNames[severity][0]);
+  AppendRawLogTime(&out);
+  out.AppendChar(' ');
+  out.AppendString(ThreadContext::field());
+  out.AppendChar(' ');
+  out.AppendString(const_basename(const_cast<char *>(file)));
+  out.AppendChar(':');
+  out.AppendInt64(line);
+  out.AppendString("] RAW: ");
+  out.AppendString(ThreadContext::name_field());
 
   // Record the position and size of the buffer after the prefix
-  const char* msg_start = buf;
-  const int msg_size = size;
+  const char* msg_start = out.cur();
+  const int msg_size = out.remaining();
 
   va_list ap;
   va_start(ap, format);
-  bool no_chop = VADoRawLog(&buf, &size, format, ap);
+  bool no_chop = VADoRawLog(&out, format, ap);
   va_end(ap);
-  if (no_chop) {
-    DoRawLog(&buf, &size, "\n");
-  } else {
-    DoRawLog(&buf, &size, "RAW_LOG ERROR: The Message was too long!\n");
-  }
+  MinimalFormatter tail(out.cur(), sizeof(buffer) - out.size());
+  tail.AppendString(no_chop ? "\n" : kTooLong);
+  const size_t len = out.size() + tail.size();
+  buffer[len] = '\0';
+
   // We make a raw syscall to write directly to the stderr file descriptor,
   // avoiding FILE buffering (to avoid invoking malloc()), and bypassing
   // libc (to side-step any libc interception).
   // We write just once to avoid races with other invocations of RawLog__.
-  safe_write(STDERR_FILENO, buffer, strlen(buffer));
-  ++raw_num_messages_[static_cast<int>(severity)];
+  if (to_stderr) safe_write(STDERR_FILENO, buffer, len);
+  if (to_logfiles) LogDestination::WriteRawToLogfiles(severity, buffer, len);
+  __atomic_add_fetch(&raw_num_messages_[static_cast<int>(severity)], 1,
+                     __ATOMIC_RELAXED);
 
   if (severity == GLOG_FATAL)  {
     if (!CompareAndSwap(&crashed, false, true)) {
@@ -171,7 +211,7 @@ void RawLog__(LogSeverity severity, const char* file, int line,
 }
 
 int64 raw_num_messages(int severity) {
-  return raw_num_messages_[severity];
+  return __atomic_load_n(&raw_num_messages_[severity], __ATOMIC_RELAXED);
 }
 
 _END_GOOGLE_NAMESPACE_
@@ -46,15 +46,20 @@ _START_GOOGLE_NAMESPACE_
 // * it is to be used ONLY by low-level modules that can't use normal LOG()
 // * it is desiged to be a low-level logger that does not allocate any
 //   memory and does not need any locks, hence:
-// * it logs straight and ONLY to STDERR w/o buffering
+// * it logs straight to STDERR (as the flags say for LOG()), and to the
+//   plain log files that LOG() already opened, w/o buffering: one
+//   write() per destination (see LogFileObject::WriteRaw())
 // * it uses an explicit format and arguments list
 // * it will silently chop off really long message strings
 // Usage example:
 //   RAW_LOG(ERROR, "Failed foo with %i: %s", status, error);
 //   RAW_VLOG(3, "status is %i", status);
-// These will print an almost standard log lines like this to stderr only:
-//   E0821 211317 file.cc:123] RAW: Failed foo with 22: bad_file
-//   I0821 211317 file.cc:142] RAW: status is 20
+// These will print almost standard log lines like these:
+//   E0821 21:13:17.123456  1234 file.cc:123] RAW: Failed foo with 22: bad_file
+//   I0821 21:13:17.123789  1234 file.cc:142] RAW: status is 20
+// It is safe in signal handlers and in the child of fork() as long as
+// the format doesn't need vsnprintf() to allocate (no %ls, %f and the
+// like).
 #define RAW_LOG(severity, ...) \
   do { \
     switch (google::GLOG_ ## severity) {  \
@@ -165,9 +170,10 @@ void RawLog__(LogSeverity severity,
               ...)
 __attribute__((__format__ (__printf__, 4, 5)));
 
-// Hack to propagate time information into this module so that
-// this module does not have to directly call localtime_r(),
-// which could allocate memory.
+// Hack to propagate the local time zone (t.tm_gmtoff) into this module so
+// that this module does not have to directly call localtime_r(), which
+// could allocate memory and takes a lock.  LogMessage calls it; the time
+// itself comes from clock_gettime() and "usecs" is ignored.
 void RawLog__SetLastTime(const struct tm& t, int usecs);
 
 int64 raw_num_messages(int severity);
@@ -55,6 +55,12 @@ _START_GOOGLE_NAMESPACE_
 // "result" must not be NULL.
 extern int GetStackTrace(void** result, int max_depth, int skip_count);
 
+// The same, by following the chain of frame pointers (%rbp/%ebp), which
+// only works for code built with them.  GetStackTrace() is this on
+// i386; on x86-64 it unwinds with the CFI of .eh_frame (CfiUnwinder.h).
+extern int GetStackTraceFromFramePointers(void** result, int max_depth,
+                                          int skip_count);
+
 _END_GOOGLE_NAMESPACE_
 
 #endif  // BASE_STACKTRACE_H_
@@ -39,6 +39,8 @@
 #endif
 
 #include <stdio.h>  // for NULL
+#include "CfiUnwinder.h"
+#include "StackBounds.h"
 #include "stacktrace.h"
 
 _START_GOOGLE_NAMESPACE_
@@ -51,6 +53,27 @@ template<bool STRICT_UNWINDING>
 static void **NextStackFrame(void **old_sp) {
   void **new_sp = (void **) *old_sp;
 
+  if (StackBounds::known()) {
+    // The frame (saved frame pointer and return address) must be on a
+    // stack of this thread, which makes the checks below exact.
+    const uintptr_t old_address = (uintptr_t)old_sp;
+    const uintptr_t new_address = (uintptr_t)new_sp;
+    if (!StackBounds::Contains(new_address, 2 * sizeof(void *)) ||
+        (new_address & (sizeof(void *) - 1))) {
+      return NULL;
+    }
+    const bool old_on_signal_stack = StackBounds::OnSignalStack(old_address);
+    const bool new_on_signal_stack = StackBounds::OnSignalStack(new_address);
+    if (old_on_signal_stack != new_on_signal_stack) {
+      // From the signal stack to the interrupted frames, wherever the
+      // signal stack was allocated; never the other way.
+      return old_on_signal_stack ? new_sp : NULL;
+    }
+    if (new_sp <= old_sp) return NULL;
+    const uintptr_t max_frame = STRICT_UNWINDING ? 100000 : 1000000;
+    return new_address - old_address > max_frame ? NULL : new_sp;
+  }
+
   // Check that the transition from frame pointer old_sp to frame
   // pointer new_sp isn't clearly bogus
   if (STRICT_UNWINDING) {
@@ -91,7 +114,8 @@ static void **NextStackFrame(void **old_sp) {
 }
 
 // If you change this function, also change GetStackFrames below.
-int GetStackTrace(void** result, int max_depth, int skip_count) {
+int GetStackTraceFromFramePointers(void** result, int max_depth,
+                                   int skip_count) {
   void **sp;
 #ifdef __i386__
   // Stack frame format:
@@ -118,8 +142,14 @@ int GetStackTrace(void** result, int max_depth, int skip_count) {
   sp = (void **) rbp;
 #endif
 
+  StackBounds::CheckCurrentStack();
   int n = 0;
   while (sp && n < max_depth) {
+    // %rbp need not point to a frame in code without frame pointers.
+    if (StackBounds::known() &&
+        !StackBounds::Contains((uintptr_t)sp, 2 * sizeof(void *))) {
+      break;
+    }
     if (*(sp+1) == (void *)0) {
       // In 64-bit code, we often see a frame that
       // points to itself and has a return address of 0.
@@ -136,4 +166,14 @@ int GetStackTrace(void** result, int max_depth, int skip_count) {
   return n;
 }
 
+ATTRIBUTE_NOINLINE
+int GetStackTrace(void** result, int max_depth, int skip_count) {
+  // Skip this frame too.  Using "depth" in the asm keeps the call from
+  // being a tail call, which would take this frame away.
+  const int depth = CfiUnwinder::GetStackTrace(result, max_depth,
+                                               skip_count + 1);
+  __asm__ volatile("" : : "r"(depth));
+  return depth;
+}
+
 _END_GOOGLE_NAMESPACE_
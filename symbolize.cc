@@ -53,7 +53,7 @@
 #include <limits>
 
 #include "symbolize.h"
-#include "demangle.h"
+#include "DemangleCache.h"
 #include "raw_logging.h"
 
 _START_GOOGLE_NAMESPACE_
@@ -81,7 +81,7 @@ void InstallSymbolizeCallback(SymbolizeCallback callback) {
 // get inlined.
 static ATTRIBUTE_NOINLINE void DemangleInplace(char *out, int out_size) {
   char demangled[256];  // Big enough for sane demangled symbols.
-  if (Demangle(out, demangled, sizeof(demangled))) {
+  if (DemangleCache::Demangle(out, demangled, sizeof(demangled))) {
     // Demangling succeeded. Copy to out if the space allows.
     size_t len = strlen(demangled);
     if (len + 1 <= (size_t)out_size) {  // +1 for '\0'.
@@ -553,8 +553,20 @@ OpenObjectFileContainingPcAndGetStartAddress(uint64_t pc,
     }
     ++cursor;  // Skip ' '.
 
-    // Skip to file name.  "cursor" now points to file offset.  We need to
-    // skip at least three spaces for file offset, dev, and inode.
+    // Read file offset.  Linkers no longer map the code of PIE
+    // executables and shared objects from offset 0, so the object's load
+    // bias is the start address minus the offset (assuming, as they all
+    // do, that segments have the same virtual address as file offset).
+    uint64_t file_offset;
+    cursor = GetHex(cursor, eol, &file_offset);
+    if (cursor == eol || *cursor != ' ') {
+      return -1;  // Malformed line.
+    }
+    start_address -= file_offset;
+
+    // Skip to file name.  "cursor" now points to the space after the file
+    // offset.  We need to skip at least three spaces for it, dev, and
+    // inode.
     int num_spaces = 0;
     while (cursor < eol) {
       if (*cursor == ' ') {
@@ -0,0 +1,118 @@
+/*
+ * logcat.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+// Prints log files written with --log_compress, decompressing them on
+// the fly.  Uncompressed log files are copied through unchanged.
+//
+// Usage: logcat [-f] file...
+//
+//   -f  Follow the (last) file like "tail -f": keep decoding blocks as
+//       the logger writes them.
+//
+// Each block of a compressed log is a complete gzip member, so a block
+// can be decoded as soon as it is on disk.  A torn block at the end of
+// a file that is no longer being written (e.g. after a crash) is decoded
+// as far as possible and reported.
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+static const size_t kChunkSize = 64 * 1024;
+
+// Copy "in" to stdout, inflating gzip members as they complete.
+// Returns false on a read or decompression error.
+static bool Cat(FILE* in, const char* name, bool follow) {
+  unsigned char inbuf[kChunkSize];
+  unsigned char outbuf[kChunkSize];
+
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  // 15 + 32: accept gzip (or zlib) headers, detected automatically.
+  if (inflateInit2(&stream, 15 + 32) != Z_OK) return false;
+
+  bool first = true;
+  bool compressed = false;
+  bool ok = true;
+  while (true) {
+    size_t n = fread(inbuf, 1, sizeof(inbuf), in);
+    if (n == 0) {
+      if (ferror(in)) {
+        perror(name);
+        ok = false;
+        break;
+      }
+      if (!follow) break;
+      clearerr(in);
+      fflush(stdout);
+      sleep(1);
+      continue;
+    }
+    if (first) {
+      compressed = n >= 2 && inbuf[0] == 0x1f && inbuf[1] == 0x8b;
+      first = false;
+    }
+    if (!compressed) {
+      fwrite(inbuf, 1, n, stdout);
+      continue;
+    }
+
+    stream.next_in = inbuf;
+    stream.avail_in = n;
+    while (stream.avail_in > 0) {
+      stream.next_out = outbuf;
+      stream.avail_out = sizeof(outbuf);
+      int ret = inflate(&stream, Z_NO_FLUSH);
+      fwrite(outbuf, 1, sizeof(outbuf) - stream.avail_out, stdout);
+      if (ret == Z_STREAM_END) {
+        // End of one block; the next byte starts a new gzip member.
+        inflateReset(&stream);
+      } else if (ret == Z_BUF_ERROR) {
+        break;  // needs more input
+      } else if (ret != Z_OK) {
+        fprintf(stderr, "%s: corrupt block: %s\n", name,
+                stream.msg ? stream.msg : "inflate error");
+        ok = false;
+        break;
+      }
+    }
+    if (!ok) break;
+  }
+  if (ok && compressed && stream.total_in > 0) {
+    fprintf(stderr, "%s: last block is incomplete (%lu bytes read)\n",
+            name, static_cast<unsigned long>(stream.total_in));
+  }
+  inflateEnd(&stream);
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  bool follow = false;
+  int first_file = 1;
+  if (argc > 1 && strcmp(argv[1], "-f") == 0) {
+    follow = true;
+    first_file = 2;
+  }
+  if (first_file >= argc) {
+    fprintf(stderr, "Usage: %s [-f] file...\n", argv[0]);
+    return 2;
+  }
+
+  int status = 0;
+  for (int i = first_file; i < argc; ++i) {
+    FILE* in = fopen(argv[i], "rb");
+    if (in == NULL) {
+      perror(argv[i]);
+      status = 1;
+      continue;
+    }
+    if (!Cat(in, argv[i], follow && i == argc - 1)) status = 1;
+    fclose(in);
+  }
+  return status;
+}
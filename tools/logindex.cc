@@ -0,0 +1,182 @@
+/*
+ * logindex.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+// Uses the sparse index of a log file (--log_index_interval_kb) to get
+// to the interesting part of a large log without reading all of it.
+//
+// Usage: logindex dump <log file>
+//        logindex errors <log file>
+//        logindex find <log file> <yyyy/mm/dd-hh:mm:ss>
+//        logindex build <log file> [interval KiB]
+//
+//   dump    Print every index entry.
+//   errors  Print the entries whose interval has ERROR or FATAL lines.
+//   find    Print the log from the first interval that ends at or after
+//           the given local time; pipe it to less or head.
+//   build   (Re)create <log file>.idx by scanning the log, e.g. for logs
+//           written without --log_index_interval_kb.
+//
+// dump, errors and find build the index in memory if <log file>.idx is
+// missing.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zlib.h>
+#include <string>
+#include <vector>
+#include "LogIndex.h"
+
+using std::string;
+using std::vector;
+using namespace GOOGLE_NAMESPACE;
+
+static const uint32 kDefaultIntervalKb = 1024;
+
+static void Usage(const char* argv0) {
+  fprintf(stderr,
+          "Usage: %s dump <log file>\n"
+          "       %s errors <log file>\n"
+          "       %s find <log file> <yyyy/mm/dd-hh:mm:ss>\n"
+          "       %s build <log file> [interval KiB]\n",
+          argv0, argv0, argv0, argv0);
+}
+
+static bool LoadIndex(const string& log_filename,
+                      vector<LogIndexEntry>* entries) {
+  if (ReadLogIndex(log_filename + ".idx", entries)) {
+    return true;
+  }
+  return BuildLogIndex(log_filename, kDefaultIntervalKb * 1024, entries);
+}
+
+static void PrintEntry(const LogIndexEntry& entry) {
+  char first[32], last[32];
+  struct tm tm_time;
+  time_t t = entry.first_time;
+  strftime(first, sizeof(first), "%Y/%m/%d-%H:%M:%S",
+           localtime_r(&t, &tm_time));
+  t = entry.last_time;
+  strftime(last, sizeof(last), "%Y/%m/%d-%H:%M:%S",
+           localtime_r(&t, &tm_time));
+  printf("%12llu  %s  %s", static_cast<unsigned long long>(entry.offset),
+         first, last);
+  for (int i = 0; i < NUM_SEVERITIES; ++i) {
+    printf("  %c:%u", LogSeverityNames[i][0], entry.counts[i]);
+  }
+  printf("\n");
+}
+
+// Copy the log from "offset" to stdout, decompressing it if need be.
+// The offset of a compressed log is always the start of a gzip block.
+static bool PrintFrom(const string& log_filename, uint64 offset) {
+  FILE* in = fopen(log_filename.c_str(), "rb");
+  if (in == NULL || fseeko(in, offset, SEEK_SET) != 0) {
+    perror(log_filename.c_str());
+    if (in != NULL) fclose(in);
+    return false;
+  }
+  unsigned char magic[2];
+  const bool compressed = fread(magic, 1, 2, in) == 2 &&
+                          magic[0] == 0x1f && magic[1] == 0x8b;
+  fseeko(in, offset, SEEK_SET);
+
+  unsigned char inbuf[64 * 1024];
+  unsigned char outbuf[64 * 1024];
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (compressed && inflateInit2(&stream, 15 + 32) != Z_OK) {
+    fclose(in);
+    return false;
+  }
+  bool ok = true;
+  size_t n;
+  while (ok && (n = fread(inbuf, 1, sizeof(inbuf), in)) > 0) {
+    if (!compressed) {
+      fwrite(inbuf, 1, n, stdout);
+      continue;
+    }
+    stream.next_in = inbuf;
+    stream.avail_in = n;
+    while (stream.avail_in > 0) {
+      stream.next_out = outbuf;
+      stream.avail_out = sizeof(outbuf);
+      int ret = inflate(&stream, Z_NO_FLUSH);
+      fwrite(outbuf, 1, sizeof(outbuf) - stream.avail_out, stdout);
+      if (ret == Z_STREAM_END) {
+        inflateReset(&stream);
+      } else if (ret == Z_BUF_ERROR) {
+        break;
+      } else if (ret != Z_OK) {
+        fprintf(stderr, "%s: corrupt block\n", log_filename.c_str());
+        ok = false;
+        break;
+      }
+    }
+  }
+  if (compressed) inflateEnd(&stream);
+  fclose(in);
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    Usage(argv[0]);
+    return 2;
+  }
+  const string command = argv[1];
+  const string log_filename = argv[2];
+  vector<LogIndexEntry> entries;
+
+  if (command == "build") {
+    const uint32 interval_kb =
+        argc > 3 ? strtoul(argv[3], NULL, 10) : kDefaultIntervalKb;
+    if (interval_kb == 0 ||
+        !BuildLogIndex(log_filename, interval_kb * 1024, &entries) ||
+        !WriteLogIndex(log_filename + ".idx", entries)) {
+      perror(log_filename.c_str());
+      return 1;
+    }
+    printf("%s.idx: %lu entries\n", log_filename.c_str(),
+           static_cast<unsigned long>(entries.size()));
+    return 0;
+  }
+
+  if (!LoadIndex(log_filename, &entries)) {
+    perror(log_filename.c_str());
+    return 1;
+  }
+  if (command == "dump" || command == "errors") {
+    for (size_t i = 0; i < entries.size(); ++i) {
+      if (command == "errors" &&
+          entries[i].counts[GLOG_ERROR] == 0 &&
+          entries[i].counts[GLOG_FATAL] == 0) {
+        continue;
+      }
+      PrintEntry(entries[i]);
+    }
+    return 0;
+  }
+  if (command == "find" && argc > 3) {
+    struct tm tm_time;
+    memset(&tm_time, 0, sizeof(tm_time));
+    if (strptime(argv[3], "%Y/%m/%d-%H:%M:%S", &tm_time) == NULL) {
+      Usage(argv[0]);
+      return 2;
+    }
+    tm_time.tm_isdst = -1;
+    const size_t i = FindLogIndexEntry(entries, mktime(&tm_time));
+    // Past the last complete interval: the answer, if any, is in the
+    // unindexed tail of the log.
+    const uint64 offset = i < entries.size() ? entries[i].offset :
+        (entries.empty() ? 0 : entries.back().offset);
+    return PrintFrom(log_filename, offset) ? 0 : 1;
+  }
+  Usage(argv[0]);
+  return 2;
+}
@@ -0,0 +1,71 @@
+/*
+ * logring.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+// Prints ring log files (--log_ring_size_mb), oldest record first.
+//
+// Usage: logring [-s] file...
+//
+//   -s  Print the ring header (capacity, head, tail, generation) and the
+//       number of records instead of the records.
+//
+// The ring can be read while it is being written; records that the
+// writer overwrites before they are copied out are reported as lost.
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "RingLogFile.h"
+
+using std::string;
+using namespace GOOGLE_NAMESPACE;
+
+static bool Print(const char* filename, bool summary) {
+  RingLogReader reader;
+  if (!reader.Open(filename)) {
+    fprintf(stderr, "%s: not a ring log file\n", filename);
+    return false;
+  }
+  string record;
+  uint64 records = 0;
+  while (reader.Next(&record)) {
+    if (!summary) fwrite(record.data(), 1, record.size(), stdout);
+    ++records;
+  }
+  const RingLogFile::Header& header = reader.header();
+  if (summary) {
+    printf("%s: capacity %llu, head %llu, tail %llu, generation %llu, "
+           "%llu records\n", filename,
+           static_cast<unsigned long long>(header.capacity),
+           static_cast<unsigned long long>(header.head),
+           static_cast<unsigned long long>(header.tail),
+           static_cast<unsigned long long>(header.generation),
+           static_cast<unsigned long long>(records));
+  }
+  if (reader.lost_bytes() > 0) {
+    fprintf(stderr, "%s: %llu bytes were overwritten while reading\n",
+            filename, static_cast<unsigned long long>(reader.lost_bytes()));
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  bool summary = false;
+  int first_file = 1;
+  if (argc > 1 && strcmp(argv[1], "-s") == 0) {
+    summary = true;
+    first_file = 2;
+  }
+  if (first_file >= argc) {
+    fprintf(stderr, "Usage: %s [-s] file...\n", argv[0]);
+    return 2;
+  }
+  int status = 0;
+  for (int i = first_file; i < argc; ++i) {
+    if (!Print(argv[i], summary)) status = 1;
+  }
+  return status;
+}
@@ -0,0 +1,156 @@
+/*
+ * logsymbolize.cc
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: changqwa
+ */
+
+// Symbolizes the stack traces of a log written with --symbolize_offline,
+// which have raw pcs and a table of the modules they are in.
+//
+// Usage: logsymbolize [-d dir]... [log file]...
+//
+//   -d  Also look for the binaries in "dir", first as
+//       dir/.build-id/xx/yyyy.debug (like gdb's debug-file-directory),
+//       then by their base name.  Use it for binaries that were
+//       stripped, or moved since.
+//
+// Reads stdin if no log file is given, and writes the log to stdout with
+// "@ <pc>" lines followed by their symbol, as if the process had
+// symbolized them.  A binary is only used if its build-id is the one
+// that was logged.
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "ModuleMap.h"
+#include "SymbolCache.h"
+
+using std::string;
+using std::vector;
+using namespace GOOGLE_NAMESPACE;
+
+struct LoadedModule {
+  ModuleMap::Module module;
+  string binary;       // where the symbols are; "" if not found
+  bool looked_up;
+};
+
+static vector<string> search_dirs;
+
+static void Usage(const char* argv0) {
+  fprintf(stderr, "Usage: %s [-d dir]... [log file]...\n", argv0);
+}
+
+static bool Matches(const string& path, const string& build_id) {
+  if (access(path.c_str(), R_OK) != 0) return false;
+  if (build_id.empty()) return true;
+  string found;
+  return ModuleMap::ReadBuildId(path.c_str(), &found) && found == build_id;
+}
+
+// Find a binary for "module", or return "".
+static string FindBinary(const ModuleMap::Module& module) {
+  const char* slash = strrchr(module.path.c_str(), '/');
+  const string basename = slash != NULL ? slash + 1 : module.path;
+  for (size_t i = 0; i < search_dirs.size(); ++i) {
+    if (module.build_id.size() > 2) {
+      const string debug_file = search_dirs[i] + "/.build-id/" +
+          module.build_id.substr(0, 2) + "/" + module.build_id.substr(2) +
+          ".debug";
+      if (Matches(debug_file, module.build_id)) return debug_file;
+    }
+    const string file = search_dirs[i] + "/" + basename;
+    if (Matches(file, module.build_id)) return file;
+  }
+  if (Matches(module.path, module.build_id)) return module.path;
+  fprintf(stderr, "no binary with build-id %s for %s\n",
+          module.build_id.empty() ? "-" : module.build_id.c_str(),
+          module.path.c_str());
+  return "";
+}
+
+// The symbol of "pc", or NULL if it is unknown.
+static const char* SymbolizePc(vector<LoadedModule>* modules,
+                               unsigned long long pc,
+                               char* out, int out_size) {
+  // Return addresses: the call is the byte before.
+  --pc;
+  for (size_t i = 0; i < modules->size(); ++i) {
+    LoadedModule& loaded = (*modules)[i];
+    if (pc < loaded.module.start || pc >= loaded.module.end) continue;
+    if (!loaded.looked_up) {
+      loaded.binary = FindBinary(loaded.module);
+      loaded.looked_up = true;
+    }
+    if (loaded.binary.empty() ||
+        !SymbolCache::SymbolizeFile(loaded.binary.c_str(),
+                                    pc - loaded.module.bias, out, out_size)) {
+      return NULL;
+    }
+    return out;
+  }
+  return NULL;
+}
+
+static void Symbolize(FILE* in) {
+  vector<LoadedModule> modules;
+  bool in_table = false;
+  char line[4096];
+  char symbol[1024];
+  while (fgets(line, sizeof(line), in) != NULL) {
+    LoadedModule loaded;
+    if (ModuleMap::ParseLine(line, &loaded.module)) {
+      // A new table starts each stack trace.
+      if (!in_table) modules.clear();
+      in_table = true;
+      loaded.looked_up = false;
+      modules.push_back(loaded);
+      fputs(line, stdout);
+      continue;
+    }
+    in_table = false;
+
+    const char* p = line;
+    while (*p == ' ' || *p == '\t') ++p;
+    unsigned long long pc;
+    const size_t len = strlen(line);
+    if (modules.empty() || sscanf(p, "@ %llx", &pc) != 1 ||
+        len == 0 || line[len - 1] != '\n') {
+      fputs(line, stdout);
+      continue;
+    }
+    const char* name = SymbolizePc(&modules, pc, symbol, sizeof(symbol));
+    line[len - 1] = '\0';
+    printf("%s  %s\n", line, name != NULL ? name : "(unknown)");
+  }
+}
+
+int main(int argc, char** argv) {
+  int opt;
+  while ((opt = getopt(argc, argv, "d:")) != -1) {
+    if (opt != 'd') {
+      Usage(argv[0]);
+      return 2;
+    }
+    search_dirs.push_back(optarg);
+  }
+  if (optind == argc) {
+    Symbolize(stdin);
+    return 0;
+  }
+  int status = 0;
+  for (int i = optind; i < argc; ++i) {
+    FILE* in = fopen(argv[i], "r");
+    if (in == NULL) {
+      perror(argv[i]);
+      status = 1;
+      continue;
+    }
+    Symbolize(in);
+    fclose(in);
+  }
+  return status;
+}
@@ -11,20 +11,41 @@
 #include <sys/utsname.h>  // For uname.
 #include <time.h>
 #include "logging.h"
+#include "raw_logging.h"
+#include "ThreadContext.h"
 
 using std::string;
 
 // The following APIs are all internal.
 #ifdef HAVE_STACKTRACE
 
+#include "LoadedModules.h"
+#include "StackBounds.h"
+#include "StackTraceTable.h"
 #include "stacktrace.h"
 #include "symbolize.h"
+#include "ModuleMap.h"
+#include "SymbolCache.h"
 
 using namespace GOOGLE_NAMESPACE;
 
 DEFINE_bool(symbolize_stacktrace, true,
             "Symbolize the stack trace in the tombstone");
 
+DEFINE_bool(symbolize_cache, true,
+            "Symbolize the stack traces of DumpStackTraceToString() (and so "
+            "of --log_backtrace_at) through a cache of the symbol tables");
+
+DEFINE_bool(symbolize_offline, false,
+            "Instead of symbolizing stack traces, log their raw pcs and the "
+            "path, load address and build-id of the modules they are in, "
+            "for tools/logsymbolize");
+
+DEFINE_bool(intern_stacktraces, false,
+            "Write each distinct stack trace of DumpStackTraceToString() "
+            "(and so of --log_backtrace_at) in full once, as trace#<id>, "
+            "and only its id after that");
+
 _START_GOOGLE_NAMESPACE_
 
 static const char *g_program_invocation_short_name = NULL;
@@ -50,13 +71,15 @@ static void DebugWriteToString(const char* data, void *arg) {
 #ifdef HAVE_SYMBOLIZE
 // Print a program counter and its symbol name.
 static void DumpPCAndSymbol(DebugWriter *writerfn, void *arg, void *pc,
-                            const char * const prefix) {
+                            const char * const prefix, bool cached) {
   char tmp[1024];
   const char *symbol = "(unknown)";
   // Symbolizes the previous address of pc because pc may be in the
   // next function.  The overrun happens when the function ends with
   // a call to a function annotated noreturn (e.g. CHECK).
-  if (Symbolize(reinterpret_cast<char *>(pc) - 1, tmp, sizeof(tmp))) {
+  char *previous = reinterpret_cast<char *>(pc) - 1;
+  if (cached ? SymbolCache::Symbolize(previous, tmp, sizeof(tmp))
+             : Symbolize(previous, tmp, sizeof(tmp))) {
       symbol = tmp;
   }
   char buf[1024];
@@ -74,15 +97,22 @@ static void DumpPC(DebugWriter *writerfn, void *arg, void *pc,
   writerfn(buf, arg);
 }
 
-// Dump current stack trace as directed by writerfn
-static void DumpStackTrace(int skip_count, DebugWriter *writerfn, void *arg) { //changqwa
-  // Print stack trace
-  void* stack[32];
-  int depth = GetStackTrace(stack, ARRAYSIZE(stack), skip_count+1);
+// Dump the stack trace stack[0, depth) as directed by writerfn.  "cached"
+// selects SymbolCache over Symbolize(), which is not safe when crashing.
+static void DumpPCs(void* const* stack, int depth, DebugWriter *writerfn,
+                    void *arg, bool cached) {
+  if (FLAGS_symbolize_offline) {
+    // The module table first, so logsymbolize can do one pass.
+    ModuleMap::Dump(stack, depth, writerfn, arg);
+    for (int i = 0; i < depth; i++) {
+      DumpPC(writerfn, arg, stack[i], "    ");
+    }
+    return;
+  }
   for (int i = 0; i < depth; i++) {
 #if defined(HAVE_SYMBOLIZE)
     if (FLAGS_symbolize_stacktrace) {
-      DumpPCAndSymbol(writerfn, arg, stack[i], "    ");
+      DumpPCAndSymbol(writerfn, arg, stack[i], "    ", cached);
     } else {
       DumpPC(writerfn, arg, stack[i], "    ");
     }
@@ -92,13 +122,24 @@ static void DumpStackTrace(int skip_count, DebugWriter *writerfn, void *arg) { /
   }
 }
 
+// Dump current stack trace as directed by writerfn.  Not inlined, so that
+// "skip_count" (which counts this frame) means the same at any -O.
+static ATTRIBUTE_NOINLINE void DumpStackTrace(int skip_count,
+                                              DebugWriter *writerfn, void *arg,
+                                              bool cached) { //changqwa
+  // Print stack trace
+  void* stack[32];
+  int depth = GetStackTrace(stack, ARRAYSIZE(stack), skip_count+1);
+  DumpPCs(stack, depth, writerfn, arg, cached);
+}
+
 static void DumpStackTraceAndExit() {
   const char* message = "*** Check failure stack trace: ***\n";
   if (write(STDERR_FILENO, message, strlen(message)) < 0) {
     // Ignore errors.
   }
 
-  DumpStackTrace(1, DebugWriteToStderr, NULL);
+  DumpStackTrace(1, DebugWriteToStderr, NULL, false);
 
   // Set the default signal handler for SIGABRT, to avoid invoking our
   // own signal handler installed by InstallFailedSignalHandler().
@@ -119,8 +160,35 @@ _START_GOOGLE_NAMESPACE_
 namespace glog_internal_namespace_ {
 
 #ifdef HAVE_STACKTRACE
-void DumpStackTraceToString(string* stacktrace) {
-  DumpStackTrace(1, DebugWriteToString, stacktrace);
+void DumpStackTraceToString(string* stacktrace, LogSeverity severity,
+                            int* full_trace_id) {
+  *full_trace_id = 0;
+  // Not a crash path: pick up modules dlopen()ed since the last trace.
+  LoadedModules::Refresh();
+  StackBounds::Learn();
+  if (!FLAGS_intern_stacktraces) {
+    DumpStackTrace(1, DebugWriteToString, stacktrace, FLAGS_symbolize_cache);
+    // Not a tail call, which would take this frame away from the skip.
+    __asm__ volatile("");
+    return;
+  }
+  void* stack[32];
+  const int depth = GetStackTrace(stack, ARRAYSIZE(stack), 1);
+  bool added;
+  const int id = StackTraceTable::Intern(stack, depth, &added);
+  const bool full = id == 0 || !StackTraceTable::Emitted(id, severity);
+  char buf[32];
+  if (id != 0) {
+    snprintf(buf, sizeof(buf), full ? "trace#%d:\n" : "trace#%d\n", id);
+    stacktrace->append(buf);
+  }
+  // Symbolized once per distinct trace and log file (or always, when the
+  // table is full).
+  if (full) {
+    *full_trace_id = id;
+    DumpPCs(stack, depth, DebugWriteToString, stacktrace,
+            FLAGS_symbolize_cache);
+  }
 }
 #endif
 
@@ -182,9 +250,16 @@ void InitGoogleLoggingUtilities(const char *argv0) {
   //use to initial the execution
   g_program_invocation_short_name = slash ? slash + 1 :argv0;
   g_main_thread_id = pthread_self();
+  // RAW_LOG() can't look up the time zone itself.
+  const time_t now = time(NULL);
+  struct ::tm tm_now;
+  localtime_r(&now, &tm_now);
+  RawLog__SetLastTime(tm_now, 0);
 
 #ifdef HAVE_STACKTRACE
   InstallFailureFunction(&DumpStackTraceAndExit);
+  LoadedModules::Refresh();
+  StackBounds::Learn();
 #endif
 }
 
@@ -229,6 +304,12 @@ int64 CycleClock_Now() {
   return static_cast<int64>(tv.tv_sec)*1000000 + tv.tv_usec;
 }
 
+int64 MonotonicNanos() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
 WallTime WallTime_Now() {
   return CycleClock_Now() * 0.000001;
 }
@@ -239,7 +320,7 @@ const char *const_basename(const char *filepath) {
 }
 
 pid_t GetTID() {
-  return getpid();
+  return ThreadContext::tid();
 }
 
 static int32 g_main_thread_pid = getpid();
@@ -58,6 +58,8 @@ const std::string& MyUserName();
 int32 GetMainThreadPid();
 bool PidHasChanged();
 int64 CycleClock_Now();
+// Nanoseconds from CLOCK_MONOTONIC, for measuring short intervals.
+int64 MonotonicNanos();
 typedef double WallTime;
 WallTime WallTime_Now();
 
@@ -70,7 +72,13 @@ inline T CompareAndSwap(T *ptr, T old_val, T new_val) {
   return ret;
 }
 
-void DumpStackTraceToString(std::string* stacktrace);
+// Append the current stack trace, for a message of "severity".  With
+// --intern_stacktraces, a trace that StackTraceTable::Emitted() is written
+// as its id only.  "*full_trace_id" is set to the id of a trace written
+// in full, else 0: pass it to StackTraceTable::MarkEmitted() once the
+// message is written.
+void DumpStackTraceToString(std::string* stacktrace, LogSeverity severity,
+                            int* full_trace_id);
 
 struct CrashReason {
   CrashReason() : filename(0), line_number(0), message(0), depth(0) {}